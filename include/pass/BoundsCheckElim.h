@@ -0,0 +1,63 @@
+//========================================================================
+// FILE:
+//    BoundsCheckElim.h
+//
+// DESCRIPTION:
+//    Declares the BoundsCheckElim Pass (run mem2reg first)
+//    A bounds check is a conditional branch on an icmp whose failing
+//    successor is a trap block (a noreturn call followed by unreachable).
+//    The sparse interval analysis removes the checks that always pass;
+//    a check that stays but only reads loop-invariant values is moved to
+//    the loop preheader, so it runs once instead of once per iteration.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_BOUNDSCHECKELIM_H
+#define TUTORIALPASS_BOUNDSCHECKELIM_H
+
+#include <vector>
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include "pass/SparseIntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    class BoundsCheckElim : public FunctionPass {
+        struct BoundsCheck {
+            BranchInst *branch;
+            ICmpInst *cond;
+            unsigned passSucc;      // index of the successor taken when the check passes
+        };
+
+        unsigned numRemoved = 0;
+        unsigned numHoisted = 0;
+        unsigned numKept = 0;
+
+    public:
+        static char ID;
+
+        BoundsCheckElim() : FunctionPass(ID) {}
+
+        void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+        bool runOnFunction(Function &F) override;
+
+        void printBoundsCheckResult(Function &F);
+
+    private:
+        void collectBoundsChecks(Function &F, std::vector<BoundsCheck> &checks);
+        bool isAlwaysPassing(const BoundsCheck &check, const SparseIntervalSolver &solver);
+
+        // Loop whose preheader the check can be moved to, nullptr if there is none
+        Loop *getHoistTarget(const BoundsCheck &check, LoopInfo &LI, DominatorTree &DT);
+
+        void removeCheck(const BoundsCheck &check, DominatorTree &DT);
+        void hoistCheck(const BoundsCheck &check, Loop *L, LoopInfo &LI, DominatorTree &DT);
+    };
+}
+
+#endif //TUTORIALPASS_BOUNDSCHECKELIM_H
@@ -0,0 +1,76 @@
+//========================================================================
+// FILE:
+//    CongruenceDomain.h
+//
+// DESCRIPTION:
+//    Congruence abstract domain: the values r + k * m for every integer k
+//    (m = 0 for the single value r, m = 1 for any value), and its reduced
+//    product with the intervals, the strided intervals, such as "a
+//    multiple of 16 in [0, 4096]". The power of two part of a congruence
+//    is the alignment the values are known to have.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_CONGRUENCEDOMAIN_H
+#define TUTORIALPASS_CONGRUENCEDOMAIN_H
+
+#include "pass/IntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    struct Congruence {
+        // Larger moduli are cut down to their power of two part, which keeps the alignment
+        static const uint64_t MaxModulus = uint64_t(1) << 62;
+
+        uint64_t modulus = 1;
+        int64_t residue = 0;    // in [0, modulus) unless modulus is 0
+        bool bot = false;
+
+        Congruence() = default;
+        Congruence(uint64_t m, int64_t r);
+
+        static Congruence constant(int64_t c) { return Congruence(0, c); }
+        static Congruence top() { return Congruence(); }
+        static Congruence bottom();
+
+        bool isBot() const { return bot; }
+        bool isTop() const { return !bot && modulus == 1; }
+        bool isConstant() const { return !bot && modulus == 0; }
+        bool contains(int64_t v) const;
+        bool operator==(const Congruence &rhs) const;
+
+        // Largest power of two dividing every value, MaxModulus for the constant 0
+        uint64_t getAlignment() const;
+
+        // The values as bits-wide integers: only the part of the modulus dividing 2^bits is kept
+        Congruence truncate(unsigned bits) const;
+
+        string toStr() const;
+    };
+
+    Congruence joinCongruence(const Congruence &a, const Congruence &b);
+    Congruence addCongruence(const Congruence &a, const Congruence &b);
+    Congruence subCongruence(const Congruence &a, const Congruence &b);
+    Congruence mulCongruence(const Congruence &a, const Congruence &b);
+    Congruence andCongruence(const Congruence &a, const Congruence &b);
+    Congruence orCongruence(const Congruence &a, const Congruence &b);
+
+    // Reduced product of an interval and a congruence
+    // Reducing moves the bounds to the closest values of the congruence, and turns a single
+    // value on either side into a constant on both
+    struct StridedInterval {
+        Interval range;
+        Congruence cong;
+
+        StridedInterval(Interval range, Congruence cong);
+
+        bool isBot() const { return range.isBot() || cong.isBot(); }
+        void reduce();
+
+        // [lo,hi] step m, the bounds being values of the congruence
+        string toStr(unsigned bits = 64) const;
+    };
+}
+
+#endif //TUTORIALPASS_CONGRUENCEDOMAIN_H
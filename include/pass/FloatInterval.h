@@ -0,0 +1,74 @@
+//========================================================================
+// FILE:
+//    FloatInterval.h
+//
+// DESCRIPTION:
+//    Floating-point interval domain: bounds on the numbers a float or a
+//    double can hold, the infinities being the bounds -inf and inf, and
+//    whether it may be NaN.
+//    The operations are evaluated in the precision of the type with the
+//    default rounding, which is monotone, so the bounds of an operation
+//    on the bounds are the bounds of the rounded results. The libm
+//    functions that are not correctly rounded are widened by one ulp.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_FLOATINTERVAL_H
+#define TUTORIALPASS_FLOATINTERVAL_H
+
+#include <limits>
+#include "pass/IntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    struct FloatInterval {
+        double lo = std::numeric_limits<double>::infinity();
+        double hi = -std::numeric_limits<double>::infinity(); // lo > hi: no number
+        bool mayBeNaN = false;
+
+        FloatInterval() = default; // bottom
+        FloatInterval(double l, double h, bool nan = false) : lo(l), hi(h), mayBeNaN(nan) {}
+
+        static FloatInterval top();
+        static FloatInterval constant(double c);
+
+        bool isBot() const { return !hasNumbers() && !mayBeNaN; }
+        bool hasNumbers() const { return lo <= hi; }
+        bool mayBeInf() const;
+        bool contains(double v) const { return lo <= v && v <= hi; }
+        bool operator==(const FloatInterval &rhs) const;
+
+        string toStr() const;
+    };
+
+    // single: the values are floats, otherwise doubles
+    FloatInterval joinFloat(const FloatInterval &a, const FloatInterval &b);
+    // A growing bound moves to the next of 0, +-1, +-max, then to the infinity
+    FloatInterval widenFloat(const FloatInterval &oldV, const FloatInterval &newV, bool single);
+
+    FloatInterval addFloat(const FloatInterval &a, const FloatInterval &b, bool single);
+    FloatInterval subFloat(const FloatInterval &a, const FloatInterval &b, bool single);
+    FloatInterval mulFloat(const FloatInterval &a, const FloatInterval &b, bool single);
+    FloatInterval divFloat(const FloatInterval &a, const FloatInterval &b, bool single);
+    FloatInterval remFloat(const FloatInterval &a, const FloatInterval &b);
+    FloatInterval negFloat(const FloatInterval &a);
+
+    // fptrunc and fpext
+    FloatInterval convertFloat(const FloatInterval &a, bool single);
+    // sitofp and uitofp of a bits-wide integer
+    FloatInterval intToFloat(Interval a, bool isSigned, unsigned bits, bool single);
+
+    // libm functions and intrinsics
+    FloatInterval sqrtFloat(const FloatInterval &a, bool single);
+    FloatInterval fabsFloat(const FloatInterval &a);
+    FloatInterval expFloat(const FloatInterval &a, bool single);
+    FloatInterval logFloat(const FloatInterval &a, bool single);
+    FloatInterval sinCosFloat(const FloatInterval &a);
+    // floor, ceil, trunc, round: monotone and exact
+    FloatInterval roundFloat(const FloatInterval &a, double (*fn)(double));
+    FloatInterval minNumFloat(const FloatInterval &a, const FloatInterval &b);
+    FloatInterval maxNumFloat(const FloatInterval &a, const FloatInterval &b);
+}
+
+#endif //TUTORIALPASS_FLOATINTERVAL_H
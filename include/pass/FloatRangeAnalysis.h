@@ -0,0 +1,80 @@
+//========================================================================
+// FILE:
+//    FloatRangeAnalysis.h
+//
+// DESCRIPTION:
+//    Declares the FloatRangeAnalysis Pass (run mem2reg first)
+//    Floating-point interval analysis on SSA form: the float and double
+//    values are propagated to the fixed point through fadd, fsub, fmul,
+//    fdiv, frem, fneg, the conversions (with the sparse integer ranges
+//    for sitofp and uitofp) and the common libm functions, widening the
+//    phis of the loop headers. With -float-range-flags, the operations
+//    whose operands and result are proven never NaN get nnan, and never
+//    infinite get ninf, which lets later passes reassociate and vectorize
+//    them without enabling fast-math for the whole program.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_FLOATRANGEANALYSIS_H
+#define TUTORIALPASS_FLOATRANGEANALYSIS_H
+
+#include <vector>
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include "pass/FloatInterval.h"
+#include "pass/SparseIntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    class FloatRangeSolver {
+        Function &func;
+        const SparseIntervalSolver &intRanges;
+        std::vector<Instruction *> insts;                    // float and double instructions, reverse post order
+        DenseMap<const Value *, FloatInterval> ranges;       // instruction -> range, bot until reached
+        DenseSet<const PHINode *> wideningPoints;            // phis with an incoming back edge
+
+    public:
+        unsigned iterNum = 0;
+
+        // intRanges must have been solved
+        FloatRangeSolver(Function &F, const SparseIntervalSolver &intRanges);
+
+        void solve();
+
+        // Range of a float or double value, top for any other floating-point type
+        FloatInterval getRange(const Value *v) const;
+
+        void dump() const;
+
+    private:
+        FloatInterval evaluate(const Instruction *inst) const;
+        FloatInterval evaluateCall(const CallInst *callInst) const;
+    };
+
+    class FloatRangeAnalysis : public FunctionPass {
+        unsigned numOperations = 0;
+        unsigned numNoNaN = 0;
+        unsigned numNoInf = 0;
+
+    public:
+        static char ID;
+
+        FloatRangeAnalysis() : FunctionPass(ID) {}
+
+        void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+        bool runOnFunction(Function &F) override;
+
+        void printFloatRangeResult(Function &F, const FloatRangeSolver &solver);
+
+    private:
+        // Set nnan and ninf on an operation, as far as the ranges prove them
+        bool attachFlags(Instruction *inst, const FloatRangeSolver &solver);
+    };
+}
+
+#endif //TUTORIALPASS_FLOATRANGEANALYSIS_H
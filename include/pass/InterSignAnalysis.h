@@ -5,40 +5,177 @@
 #ifndef LLVM_PASS_INTERSIGNANALYSIS_H
 #define LLVM_PASS_INTERSIGNANALYSIS_H
 
+#include <atomic>
+#include <list>
 #include <string>
 #include <map>
-#include <queue>
+#include <mutex>
+#include <vector>
 #include "llvm/PassAnalysisSupport.h"
+#include "llvm/Analysis/CallGraph.h"
 #include "llvm/IR/Module.h"
+#include "llvm/IR/Instructions.h"
 #include "llvm/Pass.h"
 #include "llvm/Passes/PassBuilder.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
 #include "llvm/IR/PassManager.h"
 
 using namespace llvm;
 using namespace std;
 
+//sign lattice: the set of signs a value may have, one bit each
+typedef uint8_t Sign;
+const Sign SignBot = 0;
+const Sign SignNeg = 1;
+const Sign SignZero = 2;
+const Sign SignPos = 4;
+const Sign SignTop = SignNeg | SignZero | SignPos;
+
+string signToStr(Sign sign);
+
+//binary operation on signs, looked up by the two operand sets
+struct SignTable {
+    Sign result[8][8];
+
+    //single[i][j]: the signs of a op b, for a of the i-th sign and b of the j-th sign (-, 0, +)
+    explicit SignTable(const Sign single[3][3]);
+
+    Sign apply(Sign a, Sign b) const { return result[a & SignTop][b & SignTop]; }
+};
+
+//signs of all the values of a function, 4 bits per value id, so a join is an or of the words
+class SignState {
+    vector<uint64_t> words;
+
+public:
+    static const unsigned SignsPerWord = 16;
+
+    SignState() = default;  //empty: no state yet
+    explicit SignState(unsigned numValues) : words((numValues + SignsPerWord - 1) / SignsPerWord, 0) {}
+
+    bool empty() const { return words.empty(); }
+
+    Sign get(unsigned id) const {
+        return Sign(words[id / SignsPerWord] >> (id % SignsPerWord * 4)) & 0xF;
+    }
+
+    void set(unsigned id, Sign sign) {
+        unsigned shift = id % SignsPerWord * 4;
+        uint64_t &word = words[id / SignsPerWord];
+        word = (word & ~(uint64_t(0xF) << shift)) | (uint64_t(sign) << shift);
+    }
+
+    void join(const SignState &other);
+
+    bool operator==(const SignState &rhs) const { return words == rhs.words; }
+
+    size_t memorySize() const { return sizeof(*this) + words.capacity() * sizeof(uint64_t); }
+};
+
+//dense ids of the arguments and instructions of a function
+struct FunctionValues {
+    DenseMap<const Value*, unsigned> ids;
+    vector<const Value*> values;    //id -> value
+    vector<unsigned> variables;     //allocas and parameters (the reported ones), sorted by name
+    DenseSet<const Value*> trackedAllocas;  //allocas only accessed by plain loads and stores
+
+    //-1u for a value that has no id (constants, globals)
+    unsigned getId(const Value* v) const {
+        auto it = ids.find(v);
+        return it == ids.end() ? -1u : it->second;
+    }
+};
+
+//a call analyzed in the context sensitive mode: the callee and the signs of the arguments
+typedef pair<Function*, vector<Sign>> SummaryKey;
+
+//result of a callee in one context
+struct SignSummary {
+    Sign returnSign = SignBot;
+    bool inProgress = false;    //being analyzed: a recursive call reads the return sign so far
+    bool readInProgress = false;
+    unsigned firstComputed = 0; //summaries computed from this index of computedOrder on may depend on it
+};
+
+//interned call strings: the last k call sites of a context, oldest first; id 0 is the empty string,
+//id 1 the calls from outside the module, a null call site
+class CallStringTable {
+    unsigned depth = 0;
+    vector<vector<const CallBase*>> strings;
+    map<vector<const CallBase*>, unsigned> ids;
+
+public:
+    static const unsigned UnknownCaller = 1;
+
+    CallStringTable() { reset(0); }
+
+    void reset(unsigned k);
+    //the context of a callee called at site from `context`
+    unsigned extend(unsigned context, const CallBase* site);
+    const vector<const CallBase*>& get(unsigned context) const { return strings[context]; }
+    unsigned size() const { return strings.size(); }
+};
+
+//a function analyzed in one call string context
+typedef pair<Function*, unsigned> ContextKey;
+
+struct ContextState {
+    vector<Sign> entry;         //join of the arguments of the calls in this context
+    Sign returnSign = SignBot;
+    set<ContextKey> callers;    //the contexts whose calls read returnSign
+};
+
+//block states of the last analysis of each context, to start its next analysis from;
+//the least recently used ones are dropped beyond the capacity
+class ContextStateCache {
+    typedef list<pair<ContextKey, DenseMap<BasicBlock*, SignState>>> EntryList;
+    EntryList entries;  //most recently used first
+    map<ContextKey, EntryList::iterator> index;
+    size_t capacity = 0, bytes = 0;
+    mutex cacheMutex;
+
+    static size_t getMemorySize(const DenseMap<BasicBlock*, SignState>& blockStates);
+
+public:
+    unsigned numHits = 0, numMisses = 0, numEvictions = 0;
+
+    void reset(size_t capacityBytes);
+    //move the cached states of key into blockStates, false if there are none
+    bool take(const ContextKey& key, DenseMap<BasicBlock*, SignState>& blockStates);
+    void put(const ContextKey& key, DenseMap<BasicBlock*, SignState>&& blockStates);
+};
+
 class InterSignAnalysis : public ModulePass {
 public:
     static char ID;
     bool isSensitive; //true if path&context sensitive, otherwise false
-    map<Function*, set<string>> varSetMap;
-    map<Function*, set<string>> branchVarSetMap;  //store the branch variable
-    map<Function*, set<string>> allVarSetMap; //include tmp variables
+    map<Function*, FunctionValues> valueMap;
 
     vector<Function*> entryFunction;
+    vector<Function*> rootFunction;     //entries, and the ones callable from outside: analyzed for unknown callers too
     set<Function*> allFuncSet;
     map<Function*, set<Function*>> callerInfo;
 
-    queue<Function*> funcQueue;
-    map<Function*, bool> functionFixedPointFlag;  //whether the function reached fixed point
-    map<Function*, bool> functionAnalyzedFlag;  //whether the function is analyzed
+    //call string mode: the SCCs of the call graph, bottom-up, by level; the SCCs of a level do not call each other
+    vector<vector<vector<Function*>>> sccLevels;
+    set<ContextKey> pendingContexts;  //to analyze (again), in this sweep over the levels or the next one
+    mutex scheduleMutex;              //guards pendingContexts, contextStates and callStrings
+    atomic<unsigned> numAnalyses{0};
 
-    map<Function*, vector<string>> entryState; //the sign state of function parameters
-    map<Function*, map<BasicBlock*, map<string, string>>> branchCondMap;    //the branch condition of basic block
-    map<Function*, map<BasicBlock*, map<string, string>>> signResult;
+    CallStringTable callStrings;
+    map<Function*, map<unsigned, ContextState>> contextStates;
+    ContextStateCache stateCache;
+
+    //the state at the end of each block, joined over the contexts
+    map<Function*, DenseMap<BasicBlock*, SignState>> signResult;
+
+    map<SummaryKey, SignSummary> summaryCache;  //context sensitive mode: one summary per context
+    vector<SummaryKey> computedOrder;           //keys of summaryCache in the order they were computed
+    unsigned numSummaryHits = 0;
+    unsigned numSummaryMisses = 0;
 
 
 public:
@@ -51,33 +188,50 @@ public:
     void generateCallerList(Module& M);
     void generateTopFunctionList();
     void extractVars(Function* func);
+    void generateSCCLevels(CallGraph& CG);
 
-    //lattice
-    string getConstantIntSign(ConstantInt* var);
-    string addTwoSigns(string op1, string op2);
-    string subTwoSigns(string op1, string op2);
+    //scheduler of the call string mode
+    void analyzeBottomUp();
+    void analyzeComponent(const vector<Function*>& component);
+    void analyzeContext(Function* func, unsigned context);
+    vector<unsigned> takePending(Function* func);
 
-    void analyzeFunction(Function* func); // your code goes here
-    void intraBBAnalyze(BasicBlock* bb, map<BasicBlock*, map<string, string>>& funcState); // your code goes here
-    string getFunctionTerminatorState(Function* func);
-    string joinState(string state1, string state2);
-    map<string, string> joinMapState(map<string, string> state1, map<string, string> state2);
-    bool isFunctionFixedPoint(map<string, string>& s1, map<string, string>& s2);
+    //lattice
+    Sign getConstantIntSign(ConstantInt* var);
+    Sign addTwoSigns(Sign op1, Sign op2);
+    Sign subTwoSigns(Sign op1, Sign op2);
+    Sign getSign(const Value* v, const FunctionValues& values, const SignState& state);
+    //Sign of v at all its uses, joined over the contexts; top if its block was never analyzed
+    Sign getValueSign(const Value* v);
+
+    //Analyze func in one context, from the states in funcState (empty for a first analysis),
+    //and return its return sign
+    Sign analyzeFunction(Function* func, unsigned context, DenseMap<BasicBlock*, SignState>& funcState);
+    //Update the state at the end of bb from its predecessors, false if it did not change
+    bool intraBBAnalyze(BasicBlock* bb, DenseMap<BasicBlock*, SignState>& funcState, unsigned context);
+    Sign getFunctionTerminatorState(Function* func, const DenseMap<BasicBlock*, SignState>& funcState);
+    //Return sign of callee for these argument signs, from the cache or analyzed once
+    Sign getCalleeSummary(Function* callee, const vector<Sign>& args);
+    //Return sign of callee in the context of this call, which is analyzed (again) if its entry state grows
+    Sign getCalleeContext(Function* callee, CallBase* callBase, unsigned context, const vector<Sign>& args);
+    Sign joinState(Sign state1, Sign state2);
+
+    //Refine the state at the end of from with the branch condition on the edge to `to`,
+    //false if the edge is never taken
+    bool applyBranchCondition(BasicBlock* from, BasicBlock* to, const FunctionValues& values, SignState& state);
 
     //Process each instruction
-    void handleCallInst(CallInst* callInst, map<BasicBlock*, map<string, string>>& funcState);
-    void handleLoadInst(LoadInst* loadInst, map<BasicBlock*, map<string, string>>& funcState);
-    void handleStoreInst(StoreInst* storeInst, map<BasicBlock*, map<string, string>>& funcState);
-    void handleBranchInst(BranchInst* branchInst, map<BasicBlock*, map<string, string>>& funcState);
-    void handleBinaryOperator(BinaryOperator* binaryInst, map<BasicBlock*, map<string, string>>& funcState);
+    void handleCallBase(CallBase* callBase, const FunctionValues& values, SignState& state, unsigned context);
+    void handleLoadInst(LoadInst* loadInst, const FunctionValues& values, SignState& state);
+    void handleStoreInst(StoreInst* storeInst, const FunctionValues& values, SignState& state);
+    void handleBinaryOperator(BinaryOperator* binaryInst, const FunctionValues& values, SignState& state);
+    void handleCastInst(CastInst* castInst, const FunctionValues& values, SignState& state);
 
     void reportResult(Module &M); // your code goes here
 
     //for debug use
-    void printStrStrMap(map<string, string> state);
+    void printSignState(Function* func, const SignState& state);
 };
 
 
 #endif //LLVM_PASS_INTERSIGNANALYSIS_H
-
-//Remark: Flow sensitive: consider path condition(flag), flag > 0 in one block and flag <= 0 in the other
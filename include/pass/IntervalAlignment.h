@@ -0,0 +1,51 @@
+//========================================================================
+// FILE:
+//    IntervalAlignment.h
+//
+// DESCRIPTION:
+//    Declares the IntervalAlignment Pass (run mem2reg first)
+//    The strided interval analysis proves the alignment of the addresses
+//    of the loads and stores, through the GEP offsets and the index
+//    arithmetic, e.g. a[16 * i + 4] in an array aligned to 64 is at a
+//    multiple of 16 for 32-bit elements. A proven alignment larger than
+//    the one on the instruction replaces it, so the backend can use
+//    aligned vector accesses.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_INTERVALALIGNMENT_H
+#define TUTORIALPASS_INTERVALALIGNMENT_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include "pass/StridedIntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    class IntervalAlignment : public FunctionPass {
+        unsigned numAccesses = 0;
+        unsigned numRaised = 0;
+
+    public:
+        static char ID;
+
+        // Largest alignment an instruction can carry
+        static const uint64_t MaxAlignment = uint64_t(1) << 29;
+
+        IntervalAlignment() : FunctionPass(ID) {}
+
+        void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+        bool runOnFunction(Function &F) override;
+
+        void printAlignmentResult(Function &F);
+
+    private:
+        // Raise the alignment of a load or a store, false if it is already as large
+        bool raiseAlignment(Instruction *inst, const StridedIntervalSolver &solver);
+    };
+}
+
+#endif //TUTORIALPASS_INTERVALALIGNMENT_H
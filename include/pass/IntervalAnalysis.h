@@ -18,8 +18,12 @@
 #include <llvm/Support/SourceMgr.h>
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/CallSite.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/Optional.h>
 #include <llvm/ADT/BitVector.h>
 #include <llvm/ADT/DenseMap.h>
+#include <llvm/ADT/DenseSet.h>
+#include <llvm/ADT/STLExtras.h>
 #include <llvm/IR/BasicBlock.h>
 #include <llvm/IR/CFG.h>
 #include <llvm/IR/Instruction.h>
@@ -27,7 +31,11 @@
 #include <llvm/IR/ValueMap.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/raw_ostream.h>
+#include <atomic>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <unordered_map>
 #include <stdint.h>
@@ -42,11 +50,13 @@ static LLVMContext &getGlobalContext() { return *GlobalContext; }
 
 namespace IntervalNameSpace{
 
+    // Range of the signed values of an integer of at most 64 bits
+    // The bounds of a bits-wide value always lie in [-2^(bits-1), 2^(bits-1)-1], which is its top
     struct Interval {
-        int lo;
-        int hi;
+        int64_t lo;
+        int64_t hi;
 
-        Interval(int l, int h) : lo(l), hi(h) {}
+        Interval(int64_t l, int64_t h) : lo(l), hi(h) {}
 
         Interval() {
             lo = 0;
@@ -54,22 +64,82 @@ namespace IntervalNameSpace{
         }
 
         bool operator==(const Interval &rhs) const;
+        bool isBot() const { return lo > hi; }
+
+        // The full signed range of a bits-wide integer
+        static Interval top(unsigned bits);
 
         Interval joinInt(Interval a, Interval b);
-        Interval wideningInt(Interval oldV, Interval newV);
-        Interval addInt(Interval a, Interval b);
-        Interval subInt(Interval a, Interval b);
+        Interval meetInt(Interval a, Interval b);
+        Interval wideningInt(Interval oldV, Interval newV, unsigned bits = 64, ArrayRef<int64_t> thresholds = None);
 
         Interval refineLt(Interval a, Interval b);
         Interval refineLe(Interval a, Interval b);
         Interval refineGe(Interval a, Interval b);
         Interval refineGt(Interval a, Interval b);
 
-        string toStr() const;
+        // Bounds equal to the limits of a bits-wide integer are printed as infinite
+        string toStr(unsigned bits = 64) const;
     };
 
-    Interval botInt = {0, -1}; // lo >= hi ==> empty set
-    Interval topInt = {INT32_MIN, INT32_MAX}; // INT32_MIN means minus infinity, INT32_MAX means plus infinity
+    const Interval botInt = {0, -1}; // lo > hi ==> empty set
+    const Interval topInt = {INT64_MIN, INT64_MAX}; // top of a 64-bit value
+
+    // Width of the integer held by v, or stored in v if v is an alloca (64 for anything else)
+    unsigned getIntervalBits(const Value *v);
+
+    // Interval of a constant, top if it is wider than 64 bits
+    Interval getConstantInterval(const ConstantInt *c);
+
+    // Bounds where the widening stops before the limits of the type, sorted: the constants
+    // compared with and the array sizes of F, and their neighbours
+    std::vector<int64_t> collectWideningThresholds(Function &F);
+
+    // Transfer functions on bits-wide two's complement values (IntervalArithmetic.cpp)
+    // A result that may wrap around is top, unless the instruction promises not to wrap
+    // (nsw, or undefined behavior as for sdiv overflow), then the range saturates
+    Interval addInterval(Interval a, Interval b, unsigned bits, bool noSignedWrap);
+    Interval subInterval(Interval a, Interval b, unsigned bits, bool noSignedWrap);
+    Interval mulInterval(Interval a, Interval b, unsigned bits, bool noSignedWrap);
+    Interval sdivInterval(Interval a, Interval b, unsigned bits);
+    Interval udivInterval(Interval a, Interval b, unsigned bits);
+    Interval sremInterval(Interval a, Interval b, unsigned bits);
+    Interval uremInterval(Interval a, Interval b, unsigned bits);
+    Interval shlInterval(Interval a, Interval b, unsigned bits, bool noSignedWrap);
+    Interval lshrInterval(Interval a, Interval b, unsigned bits);
+    Interval ashrInterval(Interval a, Interval b, unsigned bits);
+    Interval andInterval(Interval a, Interval b, unsigned bits);
+    Interval orInterval(Interval a, Interval b, unsigned bits);
+    Interval xorInterval(Interval a, Interval b, unsigned bits);
+    Interval zextInterval(Interval a, unsigned srcBits, unsigned dstBits);
+    Interval truncInterval(Interval a, unsigned dstBits);
+
+    // Dispatch on the opcode, top for the instructions that are not modeled
+    Interval evaluateBinaryOperator(const BinaryOperator *inst, Interval a, Interval b);
+    Interval evaluateCastInst(const CastInst *inst, Interval a);
+
+    // Whether "a op b" (Add or Sub) provably stays in the signed / unsigned range of the type
+    bool isSignedOverflowFree(Instruction::BinaryOps opcode, Interval a, Interval b, unsigned bits);
+    bool isUnsignedOverflowFree(Instruction::BinaryOps opcode, Interval a, Interval b, unsigned bits);
+
+    // Value of "a pred b" for every pair of values in a and b, None if it depends on them
+    Optional<bool> evaluateICmp(CmpInst::Predicate pred, Interval a, Interval b, unsigned bits);
+
+    // Refine a with the relation "a pred b" between bits-wide values, for every predicate
+    // bot if no value of a can satisfy it
+    Interval refineByPredicate(CmpInst::Predicate pred, Interval a, Interval b, unsigned bits);
+
+    // Ranges of the integer arguments of a function, in the order of the arguments
+    typedef std::vector<Interval> ArgumentRanges;
+
+    // Interprocedural summaries (IntervalSummary.h)
+    struct FunctionSummary;
+    class SummaryCache;
+    class SummaryResolver;
+
+    // Engines of the SSA modes (SparseIntervalAnalysis.h, ZoneIntervalAnalysis.h)
+    class SparseIntervalSolver;
+    class ZoneIntervalSolver;
 
     typedef std::unordered_map<Value *, Interval> NumState;
 
@@ -77,44 +147,171 @@ namespace IntervalNameSpace{
     // what is the range for llvm values?
     typedef std::unordered_map<Instruction *, NumState> AbstractState;
 
+    // Program points of the reachable instructions of a function, numbered in reverse post order
+    // The neighbours are stored in CSR form: the predecessors of point p are
+    // preds[predBegin[p]] .. preds[predBegin[p+1]-1], and the same for the successors
+    struct ProgramPointGraph {
+        std::vector<Instruction *> points;
+        DenseMap<const Instruction *, unsigned> pointId;
+        std::vector<unsigned> predBegin, succBegin;
+        std::vector<Instruction *> preds, succs;
 
-    //IntAnalysis Pass
-    class IntAnalysis: public ModulePass {
-        std::set<Value *> caredValues; // all variable appeared in absState
-        std::set<Value *> formalArgs;  // all formal arguments in absState
-        std::map<Value*, NumState> branchState;
+        void build(Function &F);
+        unsigned size() const { return points.size(); }
+        ArrayRef<Instruction *> getPreds(const Instruction *inst) const;
+        ArrayRef<Instruction *> getSuccs(const Instruction *inst) const;
+    };
+
+
+    // What the condition of a branch says about the values flowing along one of its edges
+    struct EdgeFacts {
+        NumState refined;           // values narrowed by the condition
+        bool infeasible = false;    // the condition never holds on this edge
+
+        bool operator==(const EdgeFacts &rhs) const {
+            return infeasible == rhs.infeasible && refined == rhs.refined;
+        }
+    };
+
+    // Dense analysis of one function in one calling context
+    // It owns all the state of the analysis, so the functions of a module can be analyzed
+    // concurrently, each with its own DenseIntervalAnalysis
+    class DenseIntervalAnalysis {
+        Function &func;
+        SummaryResolver *resolver = nullptr; // summaries of the callees, set while compute runs
+        std::map<Value *, Interval> formalArgs; // integer arguments -> range in this context
+        DenseSet<const Value *> modeledSlots; // stack slots and integer globals whose address does not escape
+        std::vector<GlobalVariable *> modeledGlobals; // the globals among them, any value on entry
+        // (branch, first instruction of a successor) -> facts of that edge
+        DenseMap<std::pair<const Instruction *, const Instruction *>, EdgeFacts> edgeFacts;
         AbstractState absState;
+        ProgramPointGraph pointGraph;
+        BitVector wideningPoints; // indexed by program point, first instructions of the loop heads
+        std::vector<int64_t> thresholds;
 
     public:
-        static char ID;
+        unsigned iterNum = 0;
+        unsigned narrowingPasses = 3;   // maximum number of decreasing passes after the widening
 
-        IntAnalysis() : ModulePass(ID) {};
+        explicit DenseIntervalAnalysis(Function &F) : func(F) {}
 
-        virtual bool runOnModule(Module &M);
-        void getAnalysisUsage(llvm::AnalysisUsage &AU) const;
+        // Worklist algorithm to the fixed point, then the narrowing passes
+        void compute(const ArgumentRanges &args, SummaryResolver &summaries);
+
+        // Interval of an operand v read by inst, or of inst itself after it runs
+        Interval getIntervalAt(Value *v, Instruction *inst) const;
+
+        void dumpAbstractState() const;
+        void printSingleState(Instruction *inst) const;
 
-        void initArgToTop(Function &F);
-        void collectCaredValues();
+    private:
+        void initArgs(const ArgumentRanges &args);
+        void collectModeledSlots();
+        void collectWideningPoints();
+        // In a narrowing pass, the new state is met with the old one instead of widened
+        bool updateProgramPoint(Instruction *inst, bool narrowing = false);
 
         void AbstractTransfer(Instruction *inst);
-        Interval getJoinIntervalFromPredInst(Instruction* inst, Value* src);
+        Interval getJoinIntervalFromPredInst(Instruction* inst, Value* src) const;
         void mergeIntervalFromPredInst(Instruction* inst, Value* dest);
 
         void handleOtherInsts(Instruction* inst);
+        void handleCallInst(CallInst* callInst);
+        // The modeled globals after a call with these side effects
+        void applyCallEffects(Instruction *inst, const FunctionSummary &effects);
         void handleAllocaInst(AllocaInst* allocaInst);
         void handleLoadInst(LoadInst* loadInst);
         void handleStoreInst(StoreInst* storeInst);
         void handleBranchInst(BranchInst* branchInst);
+        void addEdgeFact(EdgeFacts &facts, BranchInst *branchInst, Value *v, Interval range);
+        // Facts of the edge from -> to, nullptr if from is not a conditional branch
+        const EdgeFacts *getEdgeFacts(Instruction *from, Instruction *to) const;
         void handleBinaryOperator(BinaryOperator *binaryInst);
+        void handleCastInst(CastInst *castInst);
+        void handleSelectInst(SelectInst *selectInst);
+        void handlePHINode(PHINode *phiNode);
 
+        // Helper function
+        ArrayRef<Instruction*> findPrecedingProgramPoints(Instruction *inst) const;
+        ArrayRef<Instruction*> findSucceedingProgramPoints(Instruction *inst) const;
+    };
 
-        void dumpAbstractState(Function &F);
-        void printSingleState(Instruction* inst);
-        void compute(Function &F);
+    // Final result of one function, kept by the engine that computed it
+    // Only one of the engines is set, depending on the mode of the analysis
+    struct FunctionIntervals {
+        Function *func = nullptr;
+        std::unique_ptr<DenseIntervalAnalysis> dense;
+        std::unique_ptr<SparseIntervalSolver> sparse;
+        std::unique_ptr<ZoneIntervalSolver> zone;
 
-        // Helper function
-        std::vector<Instruction*> findPrecedingProgramPoints(Instruction *inst);
+        FunctionIntervals();
+        ~FunctionIntervals();
+        FunctionIntervals &operator=(FunctionIntervals &&other);
+
+        // Interval of an operand v read by inst, or of inst itself after it runs
+        Interval getIntervalAt(Value *v, Instruction *inst) const;
+        void dump() const;
+    };
+
+    // Per-function results of a module
+    // The slot layout is fixed before the analysis starts, each worker only writes the slot of
+    // the function it analyzes and publishes it with a release store, so lookups never take a lock
+    class IntervalResultTable {
+        struct Slot {
+            FunctionIntervals result;
+            std::atomic<bool> ready{false};
+        };
+
+        DenseMap<const Function *, unsigned> slotIndex;
+        std::vector<Function *> slotFunc;
+        std::unique_ptr<Slot[]> slots;
+
+    public:
+        // Assign a slot to every defined function of the module
+        void reset(Module &M);
+        unsigned size() const { return slotFunc.size(); }
+        Function *getFunction(unsigned i) const { return slotFunc[i]; }
+
+        // Slot of F, to be filled by the worker that analyzes F
+        FunctionIntervals &getSlot(const Function *F);
+        void publish(const Function *F);
+
+        // nullptr if F has no published result yet
+        const FunctionIntervals *lookup(const Function *F) const;
+    };
+
+
+    //IntAnalysis Pass
+    //The functions are analyzed concurrently, one level of the call graph at a time, with
+    //a DenseIntervalAnalysis per function; the summaries are shared through a locked cache
+    class IntAnalysis: public ModulePass {
+        std::unique_ptr<SummaryCache> summaryCache;
+        IntervalResultTable results;
+        std::mutex callSiteMutex; // guards callSiteRanges
+        std::map<Function *, ArgumentRanges> callSiteRanges; // join of the arguments at the analyzed call sites
+
+    public:
+        static char ID;
+
+        IntAnalysis();
+        ~IntAnalysis();
+
+        virtual bool runOnModule(Module &M);
+        void getAnalysisUsage(llvm::AnalysisUsage &AU) const;
+
+        // Interprocedural analysis
+        // Analyze F with the given argument ranges, the callees are summarized by resolver
+        // If result is set, the analysis is final and its engine is kept there
+        FunctionSummary analyzeFunction(Function &F, const ArgumentRanges &args, SummaryResolver &resolver,
+                                        FunctionIntervals *result);
+        void recordCallSites(Function &F, function_ref<Interval(Value *, Instruction *)> query);
+        // Ranges of the arguments of F at the start of its final analysis
+        ArgumentRanges getEntryArguments(Function &F, const DenseSet<Function *> &recursive);
+
+        bool annotate(Function &F, function_ref<Interval(Value *, Instruction *)> query);
 
+        // nullptr if F is not defined in the module
+        const FunctionIntervals *getFunctionIntervals(const Function *F) const;
     };
 }
 
@@ -0,0 +1,50 @@
+//========================================================================
+// FILE:
+//    IntervalAnnotation.h
+//
+// DESCRIPTION:
+//    Writes the ranges proven by IntAnalysis back into the IR
+//    (-interval-annotate): !range metadata on integer loads and calls,
+//    nsw/nuw on the adds and subs that cannot overflow, and a constant in
+//    place of the comparisons whose result is already known. The
+//    annotator does not depend on the engine, it reads the ranges through
+//    a query callback, so both the dense and the sparse results can be used.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_INTERVALANNOTATION_H
+#define TUTORIALPASS_INTERVALANNOTATION_H
+
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "pass/IntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    class IntervalAnnotator {
+    public:
+        // Interval of v at inst: of an operand v when inst reads it, of inst itself after it runs
+        // bot if inst is unreachable
+        typedef function_ref<Interval(Value *v, Instruction *inst)> RangeQuery;
+
+        explicit IntervalAnnotator(RangeQuery query) : query(query) {}
+
+        // Return true if F has been changed
+        bool annotate(Function &F);
+
+        unsigned numRanges = 0;
+        unsigned numFlags = 0;
+        unsigned numFolded = 0;
+
+    private:
+        RangeQuery query;
+
+        bool annotateRange(Instruction *inst);
+        bool annotateNoWrap(BinaryOperator *binaryInst);
+        bool foldICmp(ICmpInst *icmpInst);
+    };
+}
+
+#endif //TUTORIALPASS_INTERVALANNOTATION_H
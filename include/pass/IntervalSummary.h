@@ -0,0 +1,113 @@
+//========================================================================
+// FILE:
+//    IntervalSummary.h
+//
+// DESCRIPTION:
+//    Function summaries of the interprocedural interval analysis
+//    A summary maps the ranges of the integer arguments of a function
+//    to the range of its return value and to the ranges it may store in
+//    integer globals, itself or through its callees. The summaries are
+//    cached by argument ranges, so a helper called again in a context
+//    already seen is not analyzed again. The cache is shared by the
+//    worker threads, each thread resolves the calls of its analyses with
+//    its own SummaryResolver.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_INTERVALSUMMARY_H
+#define TUTORIALPASS_INTERVALSUMMARY_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "llvm/IR/Function.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "pass/IntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    // Top for every integer argument of F
+    ArgumentRanges getTopArguments(const Function &F);
+
+    struct FunctionSummary {
+        Interval ret;                                           // bot if the function never returns a value
+        std::map<const GlobalVariable *, Interval> globalStores; // integers stored to each global
+        bool clobbersMemory = false;                             // may call an unknown function
+
+        // Summary of a function that is not analyzed
+        static FunctionSummary unknown(const Function *F);
+
+        // Add the side effects of a callee
+        void joinSideEffects(const FunctionSummary &callee);
+
+        void print(raw_ostream &os, const Function &F) const;
+    };
+
+    // Safe to use from several threads: a summary is never replaced once inserted, so the
+    // returned references stay valid and can be read without the lock
+    class SummaryCache {
+        struct KeyLess {
+            bool operator()(const std::pair<const Function *, ArgumentRanges> &a,
+                            const std::pair<const Function *, ArgumentRanges> &b) const;
+        };
+        std::map<std::pair<const Function *, ArgumentRanges>, FunctionSummary, KeyLess> summaries;
+        mutable std::mutex mutex;
+
+    public:
+        std::atomic<unsigned> numHits{0};
+        std::atomic<unsigned> numMisses{0};
+
+        // nullptr if F has not been analyzed with these argument ranges
+        const FunctionSummary *lookup(const Function *F, const ArgumentRanges &args);
+        // Keep the summary already there if another thread has inserted the same context
+        const FunctionSummary &insert(const Function *F, const ArgumentRanges &args, FunctionSummary summary);
+
+        unsigned size() const;
+        void clear();
+    };
+
+    // Summaries of the callees for the analyses run by one thread
+    // The resolver keeps the chain of the functions the thread is analyzing. A call that is
+    // recursive or nested too deep falls back on the general summary of the callee, so a
+    // summary computed below such a call depends on the chain and is not cached; the
+    // cached summaries do not depend on which thread computed them first. Such a summary is
+    // only kept by the resolver, for the chain it was computed under, until the root returns
+    class SummaryResolver {
+    public:
+        // Analysis of F with the given argument ranges, returning its summary
+        typedef std::function<FunctionSummary(Function &, const ArgumentRanges &, SummaryResolver &)> Analyzer;
+
+    private:
+        SummaryCache &cache;
+        Analyzer analyze;
+        unsigned maxDepth;
+        std::vector<Function *> activeFunctions; // functions being analyzed, outermost first
+        std::map<std::vector<Function *>, SummaryCache> chainSummaries; // chain -> summaries below it
+        unsigned numFallbacks = 0;
+
+    public:
+        SummaryResolver(SummaryCache &cache, Analyzer analyze, unsigned maxDepth);
+
+        // Summary of F in a context, from the cache or from a nested analysis
+        FunctionSummary getSummary(Function &F, const ArgumentRanges &args);
+        // Run analyzeRoot on F at the root of the chain, its summary is always cached
+        FunctionSummary analyzeRoot(Function &F, const ArgumentRanges &args, const Analyzer &analyzeRoot);
+
+        // Summary of the callee of a call, rangeOf gives the ranges of the arguments at the call
+        FunctionSummary getCallSummary(CallInst *callInst, function_ref<Interval(Value *)> rangeOf);
+        // Range of the result of a call
+        Interval evaluateCall(CallInst *callInst, function_ref<Interval(Value *)> rangeOf);
+        // The return range, and the side effects of F and of its callees
+        FunctionSummary buildSummary(Function &F, function_ref<Interval(Value *, Instruction *)> query);
+    };
+
+    // Ranges of the integer arguments of a call to callee, false if the call is not reached
+    bool getCallArguments(CallInst *callInst, Function *callee, function_ref<Interval(Value *)> rangeOf,
+                          ArgumentRanges &args);
+}
+
+#endif //TUTORIALPASS_INTERVALSUMMARY_H
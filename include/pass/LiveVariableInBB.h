@@ -5,15 +5,15 @@
 #ifndef TUTORIALPASS_LIVEVARIABLEINBB_H
 #define TUTORIALPASS_LIVEVARIABLEINBB_H
 
-#include "llvm/Analysis/LoopInfo.h"
-#include "llvm/PassAnalysisSupport.h"
-#include "llvm/ADT/StringMap.h"
+#include <map>
+#include "llvm/ADT/BitVector.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/PassManager.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/Pass.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "util/Liveness.h"
 
 using namespace std;
 
@@ -22,22 +22,18 @@ using namespace std;
 //------------------------------------------------------------------------------
 
 namespace {
-    typedef std::vector<string> BitVectorBase;
-    typedef std::map<string, int> BitVectorMap;
-    typedef std::stack<BitVectorMap> BitVectorList;
-
+    //Live variables at the entry of each source line
+    //The block-level analysis runs to the fixed point first, then every line is projected
+    //once from the converged value at the exit of its block
     struct LiveVariableInBB : public llvm::FunctionPass {
         static char ID;
-        BitVectorBase vectorBase;
-        BitVectorList LiveInfo;
-        stack<unsigned> LocInfo;
+        PassUtilSpace::FunctionLiveness liveness;
+        map<unsigned, llvm::BitVector> lineInfo;   //line -> live variables, indexed as in liveness
 
         LiveVariableInBB() : llvm::FunctionPass(ID) {}
         void getAnalysisUsage(llvm::AnalysisUsage &AU) const;
         bool runOnFunction(llvm::Function &F) override;
 
-        BitVectorMap generateEmptyBitVector();
-        BitVectorMap transferFunction(BitVectorMap bv, BitVectorBase KillBase, BitVectorBase GenBase);
         void printLiveVariableInBBResult(llvm::StringRef FuncName);
     };
 }
@@ -0,0 +1,45 @@
+//========================================================================
+// FILE:
+//    LiveVariableModule.h
+//
+// DESCRIPTION:
+//    Declares the LiveVariableModule Pass
+//    Module-level driver of the live variable analysis: the functions of
+//    the module are analyzed concurrently, each with its own state, and the
+//    results are stored in a table keyed by function
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_LIVEVARIABLEMODULE_H
+#define TUTORIALPASS_LIVEVARIABLEMODULE_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include "util/Liveness.h"
+#include "util/ResultSink.h"
+
+using namespace llvm;
+using namespace PassUtilSpace;
+
+struct LiveVariableModule : public llvm::ModulePass {
+    static char ID;
+    LivenessResultTable results;
+    ResultSink sink;
+
+    LiveVariableModule() : llvm::ModulePass(ID) {}
+    void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+    bool runOnModule(llvm::Module &M) override;
+
+    //Query the liveness of a function, nullptr if it has not been analyzed
+    const FunctionLiveness* getFunctionLiveness(const Function* F) const;
+
+    //Print the result
+    void printLiveVariableModuleResult(const FunctionLiveness &liveness);
+
+    //Result record of a function, written by the worker that analyzed it
+    json::Value getLivenessRecord(const Module &M, const FunctionLiveness &liveness) const;
+};
+
+#endif //TUTORIALPASS_LIVEVARIABLEMODULE_H
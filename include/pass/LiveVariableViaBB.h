@@ -22,6 +22,7 @@
 #include "llvm/Pass.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "util/ResultSink.h"
 
 using namespace std;
 using namespace llvm;
@@ -85,11 +86,15 @@ namespace {
         BitVectorBase vectorBase;
         map<BasicBlock*, SingleBasicBlockLivenessInfo> BasicBlockLivenessInfo;
         map<int, BitVectorMap> lineInfo;
+        PassUtilSpace::ResultSink results;
+        string moduleId;
 
 
         LiveVariableViaBB() : llvm::FunctionPass(ID) {}
         void getAnalysisUsage(AnalysisUsage &AU) const;
+        bool doInitialization(Module &M) override;
         bool runOnFunction(Function &F) override;
+        bool doFinalization(Module &M) override;
 
         //Judege the equal relation of two bit vector
         bool isEqualBitVector(BitVectorMap &bv1, BitVectorMap &bv2);
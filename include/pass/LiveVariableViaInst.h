@@ -23,6 +23,7 @@
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "util/WorkList.h"
+#include "util/ResultSink.h"
 
 using namespace std;
 using namespace llvm;
@@ -39,10 +40,14 @@ namespace {
         map<int, BitVector> lineInfo;
 //        WorkList<Instruction> LVAWorkList;
         InstWorkList LVAWorkList;
+        ResultSink results;
+        string moduleId;
 
         LiveVariableViaInst() : llvm::FunctionPass(ID) {}
 
+        bool doInitialization(Module &M) override;
         bool runOnFunction(Function &F);
+        bool doFinalization(Module &M) override;
         void getAnalysisUsage(AnalysisUsage &AU);
 
         //Core instantiations
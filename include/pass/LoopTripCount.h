@@ -0,0 +1,83 @@
+//========================================================================
+// FILE:
+//    LoopTripCount.h
+//
+// DESCRIPTION:
+//    Declares the LoopTripCount Pass (run mem2reg and loop-simplify first)
+//    Bounds on the number of iterations of each loop of LoopInfo, from the
+//    sparse interval analysis: an induction variable that steps by a
+//    constant without wrapping takes a new value in each iteration, so
+//    the size of its range bounds the iterations from above, and the
+//    ranges of its start and of the bound of the exit test bound them
+//    from below. Other passes require this pass and query the bounds of
+//    their loops; with -trip-count-metadata the bounds are also written
+//    into the llvm.loop metadata of each loop, as
+//    !{!"interval.trip_count.min", i64 N} and "interval.trip_count.max".
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_LOOPTRIPCOUNT_H
+#define TUTORIALPASS_LOOPTRIPCOUNT_H
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include "pass/SparseIntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    // Number of times the header of a loop runs each time the loop is entered
+    struct TripCount {
+        uint64_t min = 1;
+        uint64_t max = 0;     // 0: no bound
+
+        bool hasMax() const { return max != 0; }
+        string toStr() const;
+    };
+
+    class LoopTripCount : public FunctionPass {
+        // i = phi [start, preheader], [i + step, latch]
+        struct InductionVariable {
+            PHINode *phi;
+            Value *start;
+            Instruction *next;
+            int64_t step;
+        };
+
+        DenseMap<const Loop *, TripCount> tripCounts;   // loops of the last function
+
+    public:
+        static char ID;
+
+        LoopTripCount() : FunctionPass(ID) {}
+
+        void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+        bool runOnFunction(Function &F) override;
+
+        // Bounds of a loop of the last function run, {1, no bound} if nothing is known
+        TripCount getTripCount(const Loop *L) const;
+
+        void printTripCountResult(Function &F, LoopInfo &LI);
+
+    private:
+        TripCount computeTripCount(Loop *L, const SparseIntervalSolver &solver);
+        bool getInductionVariable(Loop *L, PHINode *phi, InductionVariable &iv);
+
+        // Whether i + step may wrap around; nsw only rules it out with trustFlags
+        bool mayWrap(const InductionVariable &iv, const SparseIntervalSolver &solver, bool trustFlags = true);
+        // Whether iv is compared by the exit test, which runs in every iteration
+        bool controlsExit(Loop *L, const InductionVariable &iv);
+        // Bounds from the exit test on iv, {1, no bound} if the loop does not leave through one
+        TripCount getExitTestBounds(Loop *L, const InductionVariable &iv, const SparseIntervalSolver &solver);
+        // At most the number of values of iv, 0 if it may wrap
+        uint64_t getRangeBound(Loop *L, const InductionVariable &iv, const SparseIntervalSolver &solver);
+
+        void attachMetadata(Loop *L, const TripCount &count);
+    };
+}
+
+#endif //TUTORIALPASS_LOOPTRIPCOUNT_H
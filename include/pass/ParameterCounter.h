@@ -23,18 +23,20 @@
 #include "llvm/Pass.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/raw_ostream.h"
+#include "util/ResultSink.h"
 
 struct ParameterCounter : public llvm::ModulePass {
     static char ID;
     std::map<llvm::StringRef, int> paraNum;
     std::map<llvm::StringRef, int> floatParaNum;
+    PassUtilSpace::ResultSink results;
 
     ParameterCounter() : llvm::ModulePass(ID) {}
     void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
     bool parseFunctionPara(llvm::Function &F);
     bool runOnModule(llvm::Module &M) override;
 
-    void printParameterCounterResult();
+    void printParameterCounterResult(llvm::Module &M);
 };
 
 #endif //TUTORIALPASS_PARAMETERCOUNTER_H
@@ -0,0 +1,104 @@
+//========================================================================
+// FILE:
+//    RegisterPressure.h
+//
+// DESCRIPTION:
+//    Declares the RegisterPressure Pass
+//    Estimate the maximum number of simultaneously live SSA values in each
+//    basic block and loop, weight them by loop depth and rank the functions
+//    and loops which are most likely to spill
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_REGISTERPRESSURE_H
+#define TUTORIALPASS_REGISTERPRESSURE_H
+
+#include <map>
+#include <string>
+#include <vector>
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/PassAnalysisSupport.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include "util/Dataflow.h"
+
+using namespace std;
+using namespace llvm;
+
+namespace {
+    //Register class of a live value
+    enum RegClass {
+        GPR,    //integer and pointer values
+        FPR,    //floating-point and vector values
+        NumRegClasses
+    };
+
+    //Liveness of SSA values, solved backward by the generic DataFlow framework
+    struct SSALiveness : public DataFlow<BitVector> {
+        DenseMap<const Value*, unsigned> valueIndex;
+        vector<const Value*> indexValue;
+        BitVector classMask[NumRegClasses];   //values of each register class
+        BitVector scratch;
+
+        SSALiveness() : DataFlow<BitVector>(false) {}
+        ~SSALiveness();
+
+        //Number the values which occupy a register, and record the phi uses of each predecessor
+        void collectValues(Function &F);
+        bool isTracked(const Value* v) const;
+        unsigned getIndex(const Value* v) const;
+
+        //Add the tracked operands of inst to live
+        void addUses(const Instruction* inst, BitVector &live) const;
+
+    protected:
+        void setBoundaryCondition(BitVector *bv) override;
+        void meetOp(BitVector *lhs, const BitVector *rhs) override;
+        BitVector *initFlowValue(BasicBlock &b, SetType setType) override;
+        BitVector *transferFunc(BasicBlock &b) override;
+    };
+
+    //Pressure summary of a single basic block
+    struct BlockPressure {
+        unsigned maxLive[NumRegClasses] = {0, 0};
+        unsigned loopDepth = 0;
+        double spillScore = 0;   //register excess weighted by loop depth
+    };
+
+    //An entry of the ranked report: a whole function or one of its loops
+    struct PressureHotSpot {
+        string funcName;
+        string loopHeader;       //empty for the function itself
+        unsigned line = 0;
+        unsigned loopDepth = 0;
+        unsigned maxLive[NumRegClasses] = {0, 0};
+        double spillScore = 0;
+        double weightedPressure = 0;
+    };
+
+    struct RegisterPressure : public llvm::FunctionPass {
+        static char ID;
+        map<const BasicBlock*, BlockPressure> blockPressure;
+        vector<PressureHotSpot> hotSpots;   //accumulated over the module, ranked in doFinalization
+
+        RegisterPressure() : llvm::FunctionPass(ID) {}
+        void getAnalysisUsage(llvm::AnalysisUsage &AU) const override;
+        bool runOnFunction(llvm::Function &F) override;
+        bool doFinalization(llvm::Module &M) override;
+
+        //Walk a block backward from its live-out set and record the maximum live set of each class
+        BlockPressure computeBlockPressure(BasicBlock &BB, SSALiveness &liveness, unsigned loopDepth);
+        double getDepthWeight(unsigned loopDepth);
+        PressureHotSpot summarize(Function &F, Loop *L);
+
+        void printRegisterPressureResult(Function &F, LoopInfo &LI);
+        void printHotSpotRanking();
+    };
+}
+
+#endif //TUTORIALPASS_REGISTERPRESSURE_H
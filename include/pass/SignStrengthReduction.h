@@ -0,0 +1,51 @@
+//========================================================================
+// FILE:
+//    SignStrengthReduction.h
+//
+// DESCRIPTION:
+//    Declares the SignStrengthReduction Pass
+//    Once InterSignAnalysis proves the operands of a signed instruction
+//    non-negative, its unsigned form computes the same value, and is
+//    cheaper: sdiv becomes udiv (lshr by a power of two), srem becomes
+//    urem (and with a mask), sext becomes zext, and a signed icmp becomes
+//    an unsigned one, which instcombine can fold with other checks.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_SIGNSTRENGTHREDUCTION_H
+#define TUTORIALPASS_SIGNSTRENGTHREDUCTION_H
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/raw_ostream.h"
+#include "pass/InterSignAnalysis.h"
+
+class SignStrengthReduction : public ModulePass {
+    struct RewriteCounts {
+        unsigned numDiv = 0;
+        unsigned numRem = 0;
+        unsigned numExt = 0;
+        unsigned numCmp = 0;
+    };
+
+    InterSignAnalysis *signs = nullptr;
+
+public:
+    static char ID;
+
+    SignStrengthReduction() : ModulePass(ID) {}
+
+    void getAnalysisUsage(AnalysisUsage &AU) const override;
+    bool runOnModule(Module &M) override;
+
+    void printRewriteResult(Function &F, const RewriteCounts &counts);
+
+private:
+    bool isNonNegative(const Value *v);
+    // The unsigned instruction computing the same value as inst, nullptr if the signs do not allow one
+    Instruction *getReplacement(Instruction *inst, RewriteCounts &counts);
+};
+
+#endif //TUTORIALPASS_SIGNSTRENGTHREDUCTION_H
@@ -0,0 +1,86 @@
+//========================================================================
+// FILE:
+//    SparseIntervalAnalysis.h
+//
+// DESCRIPTION:
+//    Sparse interval analysis on SSA form (run mem2reg first)
+//    Every integer SSA value has exactly one interval, kept in a dense
+//    array indexed by value number. Branch conditions are not copied into
+//    any state: the refinement of a value on an edge is applied where the
+//    value is used, at phis of the edge target and in the blocks dominated
+//    by the edge, which is what a pi-node would hold.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_SPARSEINTERVALANALYSIS_H
+#define TUTORIALPASS_SPARSEINTERVALANALYSIS_H
+
+#include <functional>
+#include <vector>
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/Function.h"
+#include "pass/IntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    class SparseIntervalSolver {
+        Function &func;
+        DominatorTree domTree;
+        DenseMap<const Value *, unsigned> valueIndex;   // integer argument or instruction -> value number
+        std::vector<Value *> values;                    // value number -> value
+        std::vector<Interval> ranges;                   // value number -> interval
+        DenseSet<const BasicBlock *> wideningBlocks;    // phis of these blocks are widened
+        std::vector<int64_t> thresholds;                // where the widening stops
+
+    public:
+        // Range of the result of a call, rangeOf gives the ranges of the arguments at the call
+        typedef std::function<Interval(CallInst *callInst, function_ref<Interval(Value *)> rangeOf)> CallEvaluator;
+
+    private:
+        ArgumentRanges argRanges;       // empty if the arguments are top
+        CallEvaluator callEvaluator;    // the calls are top without it
+
+    public:
+        unsigned iterNum = 0;
+        unsigned narrowingPasses = 3;   // maximum number of decreasing passes after the widening
+
+        explicit SparseIntervalSolver(Function &F, ArgumentRanges args = ArgumentRanges(),
+                                      CallEvaluator evaluateCall = nullptr);
+
+        // Solve the intervals of all the integer values to the fixed point
+        void solve();
+
+        // Interval of v over its whole live range
+        Interval getRange(const Value *v) const;
+
+        // Interval of v in bb, refined by the branch conditions on the edges dominating bb
+        Interval getRangeAt(const Value *v, const BasicBlock *bb) const;
+
+        // Whether "a pred b" holds whenever bb runs, either by the ranges of a and b at bb,
+        // or by the condition of an edge dominating bb that relates a to the same bound b
+        // (e.g. the loop test i < n, for a check i <u n in the loop body)
+        bool provesRelation(CmpInst::Predicate pred, const Value *a, const Value *b, const BasicBlock *bb) const;
+
+        // False if bb is unreachable, or the condition of an edge dominating bb never holds
+        bool isFeasible(const BasicBlock *bb) const;
+
+        void dump() const;
+
+    private:
+        void numberValues();
+        void collectWideningBlocks();
+        Interval evaluate(Instruction *inst) const;
+        Interval applyEdgeFact(const Value *v, const BasicBlock *from, const BasicBlock *to, Interval range) const;
+
+        // The phi incoming values are looked through phiDepth times
+        bool provesRelation(CmpInst::Predicate pred, const Value *a, const Value *b, const BasicBlock *bb,
+                            unsigned phiDepth) const;
+        bool edgeImpliesRelation(const BasicBlock *from, const BasicBlock *to, CmpInst::Predicate goal,
+                                 const Value *a, const Value *b, const BasicBlock *bb) const;
+    };
+}
+
+#endif //TUTORIALPASS_SPARSEINTERVALANALYSIS_H
@@ -0,0 +1,64 @@
+//========================================================================
+// FILE:
+//    StridedIntervalAnalysis.h
+//
+// DESCRIPTION:
+//    Strided interval analysis on SSA form (run mem2reg first)
+//    The congruences of the integer values are propagated to the fixed
+//    point and reduced with the ranges of the sparse interval analysis
+//    at each definition, so a value in [16,16] is the constant 16 and a
+//    multiple of 16 in [0,4095] is in [0,4080]. The congruences of the
+//    pointers are the congruences of their addresses, from the alignment
+//    of the base object and the offsets of the GEPs on the way.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_STRIDEDINTERVALANALYSIS_H
+#define TUTORIALPASS_STRIDEDINTERVALANALYSIS_H
+
+#include <vector>
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "pass/CongruenceDomain.h"
+#include "pass/SparseIntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    class StridedIntervalSolver {
+        Function &func;
+        const DataLayout &DL;
+        const SparseIntervalSolver &ranges;
+        std::vector<Instruction *> insts;                 // integer and pointer instructions, reverse post order
+        DenseMap<const Value *, Congruence> congruences;  // instruction -> congruence, bot until reached
+
+    public:
+        unsigned iterNum = 0;
+
+        // ranges must have been solved
+        StridedIntervalSolver(Function &F, const SparseIntervalSolver &ranges);
+
+        void solve();
+
+        // Congruence of an integer value, or of the address held by a pointer
+        Congruence getCongruence(const Value *v) const;
+
+        // Reduced product with the range of an integer value
+        StridedInterval getStridedInterval(const Value *v) const;
+
+        // Largest power of two the address held by ptr is a multiple of, 1 if unknown
+        uint64_t getAlignment(const Value *ptr) const;
+
+        void dump() const;
+
+    private:
+        Congruence evaluate(const Instruction *inst) const;
+        Congruence evaluateGEP(const GetElementPtrInst *gepInst) const;
+        // The alignment of an object whose address is not computed in the function
+        Congruence getBaseCongruence(const Value *ptr) const;
+    };
+}
+
+#endif //TUTORIALPASS_STRIDEDINTERVALANALYSIS_H
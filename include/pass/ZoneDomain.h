@@ -0,0 +1,97 @@
+//========================================================================
+// FILE:
+//    ZoneDomain.h
+//
+// DESCRIPTION:
+//    Zone abstract domain: constraints vj - vi <= c stored in a
+//    difference-bound matrix (DBM), variable 0 being the constant 0, so
+//    the intervals are the constraints against variable 0.
+//    Only the variables that are ever related share a matrix: the
+//    variables are split into packs beforehand, and a state holds one DBM
+//    per pack, so the cubic closure runs on small matrices.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_ZONEDOMAIN_H
+#define TUTORIALPASS_ZONEDOMAIN_H
+
+#include <vector>
+#include "pass/IntervalAnalysis.h"
+
+namespace IntervalNameSpace {
+
+    class DBM {
+    public:
+        // No bound. Finite bounds are kept in [-INF, INF), so that the sum of two bounds never overflows
+        static const int64_t INF = int64_t(1) << 61;
+        // Rows are padded to whole cache lines
+        static const unsigned RowAlign = 8;
+        // Tile size of the blocked closure, a tile of 32 x 32 bounds is 8 KB
+        static const unsigned Tile = 32;
+
+        explicit DBM(unsigned numVars = 0);
+
+        unsigned getNumVars() const { return dim - 1; }
+        bool isBottom() const { return bottom; }
+        bool isClosed() const { return closed; }
+
+        // Bound on vj - vi
+        int64_t get(unsigned i, unsigned j) const { return m[i * stride + j]; }
+
+        // Add vj - vi <= c to a closed matrix, and close it again in O(n^2)
+        void addConstraint(unsigned i, unsigned j, int64_t c);
+
+        // Remove every constraint on v
+        void forget(unsigned v);
+
+        // Shortest path closure by the blocked Floyd-Warshall algorithm
+        void close();
+
+        // Bounds of v, the matrix must be closed
+        Interval getInterval(unsigned v, unsigned bits) const;
+        void meetInterval(unsigned v, Interval range);
+
+        void joinWith(const DBM &other);
+        // The unstable bounds go up to the next threshold, or are dropped. The result is not
+        // closed, as closing it again could bring dropped bounds back and break termination
+        void widenWith(const DBM &newer, ArrayRef<int64_t> thresholds = None);
+
+        bool operator==(const DBM &rhs) const;
+
+    private:
+        unsigned dim;       // number of variables + 1
+        unsigned stride;    // dim rounded up to RowAlign
+        std::vector<int64_t> m;
+        bool closed = true;
+        bool bottom = false;
+
+        void setBottom();
+    };
+
+    // Partition of the variables 0..n-1 into packs of related variables
+    class VariablePacking {
+        std::vector<unsigned> parent;
+        std::vector<unsigned> packOf;       // variable -> pack
+        std::vector<unsigned> indexInPack;  // variable -> index in the DBM of its pack, from 1
+        std::vector<unsigned> packSize;
+
+        unsigned find(unsigned v);
+
+    public:
+        void reset(unsigned numVars);
+
+        // v and w appear in the same constraint
+        void unite(unsigned v, unsigned w);
+
+        // Number the packs, after the last unite
+        void finalize();
+
+        unsigned getNumPacks() const { return packSize.size(); }
+        unsigned getPackSize(unsigned pack) const { return packSize[pack]; }
+        unsigned getPack(unsigned v) const { return packOf[v]; }
+        unsigned getIndex(unsigned v) const { return indexInPack[v]; }
+    };
+}
+
+#endif //TUTORIALPASS_ZONEDOMAIN_H
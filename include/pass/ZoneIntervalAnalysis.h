@@ -0,0 +1,90 @@
+//========================================================================
+// FILE:
+//    ZoneIntervalAnalysis.h
+//
+// DESCRIPTION:
+//    Relational range analysis on SSA form with the zone domain
+//    (-interval-domain=zone, run mem2reg first)
+//    States are kept at block entries. Additions of a constant, copies,
+//    phis and comparisons of two values are kept as difference
+//    constraints, the other instructions go through the interval
+//    transfer functions, so the result is at least as precise as the
+//    intervals, and also knows i < n inside a loop on i < n.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_ZONEINTERVALANALYSIS_H
+#define TUTORIALPASS_ZONEINTERVALANALYSIS_H
+
+#include <vector>
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "pass/ZoneDomain.h"
+
+namespace IntervalNameSpace {
+
+    // One DBM per pack, an unreachable state has no DBM
+    struct ZoneState {
+        std::vector<DBM> packs;
+
+        bool isReachable() const { return !packs.empty(); }
+        void joinWith(const ZoneState &other);
+        void widenWith(const ZoneState &newer, ArrayRef<int64_t> thresholds = None);
+        bool operator==(const ZoneState &rhs) const;
+    };
+
+    class ZoneIntervalSolver {
+        Function &func;
+        DenseMap<const Value *, unsigned> valueIndex;   // integer argument or instruction -> variable
+        std::vector<Value *> values;                    // variable -> value
+        VariablePacking packing;
+        std::vector<BasicBlock *> blocks;               // reverse post order
+        DenseMap<const BasicBlock *, unsigned> blockIndex;
+        std::vector<ZoneState> blockIn;
+        BitVector wideningBlocks;
+        std::vector<Interval> ranges;                   // variable -> range after its definition
+        std::vector<int64_t> thresholds;                // where the widening of a bound stops
+
+    public:
+        unsigned iterNum = 0;
+        unsigned narrowingPasses = 3;   // maximum number of decreasing passes after the widening
+
+        explicit ZoneIntervalSolver(Function &F);
+
+        void solve();
+
+        // Interval of v over its whole live range
+        Interval getRange(const Value *v) const;
+
+        void dump() const;
+
+    private:
+        void numberValues();
+        void buildPacks();
+        void collectWideningBlocks();
+
+        ZoneState getEntryState() const;
+        bool transferBlock(unsigned b, ZoneState &state) const;
+        void narrow();
+        void transferInstruction(const Instruction *inst, ZoneState &state) const;
+        // Apply the branch condition and the phis of the edge, false if the edge cannot be taken
+        bool transferEdge(const BasicBlock *from, const BasicBlock *to, ZoneState &state) const;
+        bool refineByCondition(ICmpInst *icmpInst, bool taken, ZoneState &state) const;
+        void collectRanges();
+
+        // Operations on single variables, through the DBM of their pack
+        Interval getInterval(const ZoneState &state, const Value *v) const;
+        void assignInterval(ZoneState &state, const Value *v, Interval range) const;
+        void meetInterval(ZoneState &state, const Value *v, Interval range) const;
+        // x := y + c, false if x and y are not in the same pack
+        bool assignOffset(ZoneState &state, const Value *x, const Value *y, int64_t c) const;
+        // a - b <= c, false if a and b are not in the same pack
+        bool addDifference(ZoneState &state, const Value *a, const Value *b, int64_t c) const;
+        bool isSamePack(const Value *a, const Value *b) const;
+    };
+}
+
+#endif //TUTORIALPASS_ZONEINTERVALANALYSIS_H
@@ -16,6 +16,7 @@
 #include <llvm/Pass.h>
 #include <llvm/Support/raw_ostream.h>
 #include <list>
+#include "util/Log.h"
 
 using namespace llvm;
 using namespace std;
@@ -58,9 +59,7 @@ public:
         w.pop_front();
         (*visited)[curBlock] = true;
 
-#ifdef DEBUG
-        errs() << "===> Enter Baisc Block: " << curBlock->getName() << '\n';
-#endif
+        PASS_DEBUG(DataflowLog) << "===> Enter Basic Block: " << curBlock->getName() << '\n';
 
         int numPred = 0;
         pred_iterator PIT = pred_begin(curBlock), PIE = pred_end(curBlock);
@@ -98,9 +97,7 @@ public:
         w.pop_front();
         (*visited)[curBlock] = true;
 
-#ifdef DEBUG
-        errs() << "===> Enter Basic Block: " << curBlock->getName() << '\n';
-#endif
+        PASS_DEBUG(DataflowLog) << "===> Enter Basic Block: " << curBlock->getName() << '\n';
 
         // to check for the exit node
         int numSucc = 0;
@@ -0,0 +1,91 @@
+//========================================================================
+// FILE:
+//    Liveness.h
+//
+// DESCRIPTION:
+//    Block-level live variable analysis with isolated per-function state
+//    Variables are the stack slots (allocas) of a function, and the Gen/Kill
+//    model is the one of LiveVariableViaBB: a load generates its variable,
+//    a store kills it. All the state of one function lives in one
+//    FunctionLiveness, so functions can be analyzed concurrently.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_LIVENESS_H
+#define TUTORIALPASS_LIVENESS_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+
+using namespace llvm;
+using namespace std;
+
+namespace PassUtilSpace {
+
+    //Liveness result of a single function
+    struct FunctionLiveness {
+        const Function* func = nullptr;
+        vector<string> varNames;                        //variable index -> name
+        DenseMap<const Value*, unsigned> varIndex;      //alloca -> variable index
+        vector<const BasicBlock*> blocks;               //block index -> block
+        DenseMap<const BasicBlock*, unsigned> blockIndex;
+        vector<BitVector> liveIn, liveOut;              //indexed by block index
+        unsigned iterNum = 0;                           //number of processed blocks
+
+        //Solve the liveness of F to the fixed point
+        void compute(const Function &F);
+
+        //Backward transfer of a single instruction: live = (live - Kill) \cup Gen
+        void transferInstruction(const Instruction &inst, BitVector &live) const;
+
+        //Live variables at the entry of each source line, projected from the block results
+        //A line whose instructions are split over several blocks gets the union of its pieces
+        map<unsigned, BitVector> getLineLiveness() const;
+
+        const BitVector &getLiveIn(const BasicBlock* bb) const;
+        const BitVector &getLiveOut(const BasicBlock* bb) const;
+        vector<string> getVarNames(const BitVector &bv) const;
+
+    private:
+        void collectVariables(const Function &F);
+        bool isVariable(const Value* v) const;
+        void getKillGen(const Instruction &inst, int &kill, int &gen) const;
+    };
+
+    //Per-function liveness results of a module
+    //The slot layout is fixed before the analysis starts, each worker only writes the slot of
+    //its function and publishes it with a release store, so lookups never take a lock
+    class LivenessResultTable {
+        struct Slot {
+            FunctionLiveness result;
+            atomic<bool> ready{false};
+        };
+
+        DenseMap<const Function*, unsigned> slotIndex;
+        vector<const Function*> slotFunc;
+        unique_ptr<Slot[]> slots;
+
+    public:
+        //Assign a slot to every defined function of the module
+        void reset(Module &M);
+        unsigned size() const;
+        const Function* getFunction(unsigned i) const;
+
+        //Analyze the function of slot i and publish the result
+        void computeSlot(unsigned i);
+
+        //Return nullptr if F has no published result yet
+        const FunctionLiveness* lookup(const Function* F) const;
+    };
+}
+
+#endif //TUTORIALPASS_LIVENESS_H
@@ -0,0 +1,89 @@
+//========================================================================
+// FILE:
+//    Log.h
+//
+// DESCRIPTION:
+//    Logging facility of the analysis passes
+//    A statement is emitted only if its level is within the compile-time
+//    level TUTORIALPASS_LOG_LEVEL (set by CMake) and its category is enabled
+//    at runtime. Statements above the compile-time level are dead code, so
+//    neither the formatting nor the stderr write survives in the build.
+//
+//    Runtime categories are selected by the TUTORIALPASS_LOG environment
+//    variable, e.g. TUTORIALPASS_LOG=liveness,interval (default: all).
+//    An environment variable is used instead of a cl::opt, so that several
+//    pass plugins using this header can be loaded into the same opt.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_LOG_H
+#define TUTORIALPASS_LOG_H
+
+#include <cstdlib>
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+#define PASS_LOG_LEVEL_NONE  0
+#define PASS_LOG_LEVEL_ERROR 1
+#define PASS_LOG_LEVEL_INFO  2
+#define PASS_LOG_LEVEL_DEBUG 3  //once per block, function or iteration
+#define PASS_LOG_LEVEL_TRACE 4  //once per instruction or fact
+
+#ifndef TUTORIALPASS_LOG_LEVEL
+#define TUTORIALPASS_LOG_LEVEL PASS_LOG_LEVEL_INFO
+#endif
+
+namespace PassUtilSpace {
+
+    enum LogCategory : unsigned {
+        LivenessLog = 1u << 0,
+        IntervalLog = 1u << 1,
+        SignLog     = 1u << 2,
+        DataflowLog = 1u << 3,
+        AllLog      = ~0u
+    };
+
+    /*
+     * Parse a comma separated list of category names, nullptr enables all
+     */
+    inline unsigned parseLogCategories(const char* spec) {
+        if (spec == nullptr) {
+            return AllLog;
+        }
+        llvm::SmallVector<llvm::StringRef, 4> names;
+        llvm::StringRef(spec).split(names, ',', -1, false);
+
+        unsigned mask = 0;
+        for (llvm::StringRef name : names) {
+            name = name.trim();
+            if (name == "all") mask |= AllLog;
+            else if (name == "liveness") mask |= LivenessLog;
+            else if (name == "interval") mask |= IntervalLog;
+            else if (name == "sign") mask |= SignLog;
+            else if (name == "dataflow") mask |= DataflowLog;
+        }
+        return mask;
+    }
+
+    inline bool isLogEnabled(unsigned category) {
+        static const unsigned enabled = parseLogCategories(std::getenv("TUTORIALPASS_LOG"));
+        return (enabled & category) != 0;
+    }
+}
+
+#define PASS_LOG_ENABLED(LEVEL, CATEGORY) \
+    ((LEVEL) <= TUTORIALPASS_LOG_LEVEL && PassUtilSpace::isLogEnabled(PassUtilSpace::CATEGORY))
+
+// Usage: PASS_DEBUG(LivenessLog) << "message" << "\n";
+// The if/else form keeps the macro safe inside an unbraced if statement
+#define PASS_LOG(LEVEL, CATEGORY) \
+    if (!PASS_LOG_ENABLED(LEVEL, CATEGORY)) {} else llvm::errs()
+
+#define PASS_ERROR(CATEGORY) PASS_LOG(PASS_LOG_LEVEL_ERROR, CATEGORY)
+#define PASS_INFO(CATEGORY)  PASS_LOG(PASS_LOG_LEVEL_INFO, CATEGORY)
+#define PASS_DEBUG(CATEGORY) PASS_LOG(PASS_LOG_LEVEL_DEBUG, CATEGORY)
+#define PASS_TRACE(CATEGORY) PASS_LOG(PASS_LOG_LEVEL_TRACE, CATEGORY)
+
+#endif //TUTORIALPASS_LOG_H
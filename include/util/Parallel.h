@@ -0,0 +1,56 @@
+//========================================================================
+// FILE:
+//    Parallel.h
+//
+// DESCRIPTION:
+//    Minimal parallel-for used by the module-level drivers
+//    Work items are handed out through an atomic counter, so each worker
+//    only touches the items (and the result slots) it claimed
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_PARALLEL_H
+#define TUTORIALPASS_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace PassUtilSpace {
+
+    /*
+     * Run body(0), ..., body(count - 1) on up to `threads` worker threads
+     * threads: 0 for one worker per hardware thread, 1 for sequential execution
+     */
+    inline void parallelForEach(unsigned count, unsigned threads, const std::function<void(unsigned)> &body) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+        threads = std::max(1u, std::min(threads, count));
+
+        if (threads == 1) {
+            for (unsigned i = 0; i < count; i++) {
+                body(i);
+            }
+            return;
+        }
+
+        std::atomic<unsigned> next(0);
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&]() {
+                for (unsigned i = next++; i < count; i = next++) {
+                    body(i);
+                }
+            });
+        }
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+}
+
+#endif //TUTORIALPASS_PARALLEL_H
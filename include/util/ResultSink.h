@@ -0,0 +1,65 @@
+//========================================================================
+// FILE:
+//    ResultSink.h
+//
+// DESCRIPTION:
+//    Append-only result writer of the passes
+//    Records are JSON objects written one per line. Each thread buffers its
+//    records in its own writer, and flush() merges all the buffers and
+//    appends them to the result file with a single write, so concurrent
+//    threads and concurrent opt processes never clobber each other's output.
+//
+// License: MIT
+//========================================================================
+
+#ifndef TUTORIALPASS_RESULTSINK_H
+#define TUTORIALPASS_RESULTSINK_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/JSON.h"
+
+using namespace llvm;
+using namespace std;
+
+namespace PassUtilSpace {
+
+    class ResultSink {
+    public:
+        //Record buffer owned by a single thread
+        class Writer {
+            string buffer;
+            friend class ResultSink;
+        public:
+            void write(const json::Value &record);
+        };
+
+        ResultSink() = default;
+        ResultSink(const ResultSink &) = delete;
+        ResultSink &operator=(const ResultSink &) = delete;
+        ~ResultSink();
+
+        //Set the result file, an empty path disables the sink
+        void open(StringRef path);
+        bool isEnabled() const;
+
+        //Writer of the calling thread, fetch it once per task rather than once per record
+        Writer &getWriter();
+        void write(const json::Value &record);
+
+        //Append the buffered records to the result file, return false on I/O error
+        bool flush();
+
+    private:
+        string path;
+        mutex writersLock;
+        vector<pair<thread::id, unique_ptr<Writer>>> writers;
+    };
+}
+
+#endif //TUTORIALPASS_RESULTSINK_H
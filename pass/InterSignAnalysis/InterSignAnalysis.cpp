@@ -1,12 +1,19 @@
+//Remark: Flow sensitive: consider path condition(flag), flag > 0 in one block and flag <= 0 in the other
 //
 // Created by yzhanghw on 2020/5/10.
 //
 
 #include "pass/InterSignAnalysis.h"
+#include "util/Log.h"
+#include "util/Parallel.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SCCIterator.h"
 #include "llvm/IR/CFG.h"
 #include "llvm/IR/Instruction.h"
 #include "llvm/IR/Value.h"
-#include <queue>
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Transforms/Utils/PromoteMemToReg.h"
+#include <algorithm>
 
 /***
  * Register the pass. Modify this part only when necessary
@@ -21,354 +28,643 @@ static llvm::RegisterStandardPasses Y(
         [](const llvm::PassManagerBuilder &Builder,
            llvm::legacy::PassManagerBase &PM) { PM.add(new InterSignAnalysis()); });
 
+static cl::opt<bool> SensitiveMode("intersign-sensitive", cl::init(false),
+                                   cl::desc("Analyze each callee again for the signs of the arguments at each call"));
+static cl::opt<unsigned> SignThreads("intersign-threads", cl::init(0),
+                                     cl::desc("Workers for the independent SCCs of the call graph (0: one per hardware thread)"));
+static cl::opt<unsigned> ContextDepth("intersign-context-depth", cl::init(0),
+                                      cl::desc("Call sites kept in the context of a callee (0: one context per function)"));
+static cl::opt<unsigned> ContextCacheMB("intersign-context-cache-mb", cl::init(64),
+                                        cl::desc("Memory for the block states kept to restart the analysis of a context"));
 
-void InterSignAnalysis::extractVars(Function *func) {
-    for (auto &bb : *func) {
-        for (auto &inst: bb) {
-            // variable declaration
-            if (isa<AllocaInst>(inst)) {
-                auto allocaInst = &cast<AllocaInst>(inst);
-                // save the variable with an ID
-                varSetMap[func].insert(allocaInst->getName().str());
-                allVarSetMap[func].insert(allocaInst->getName().str());
-            } else if (isa<LoadInst>(inst)) {
-                auto loadInst = &cast<LoadInst>(inst);
-                allVarSetMap[func].insert(loadInst->getName().str());
-                allVarSetMap[func].insert(loadInst->op_begin()->get()->getName().str());
-            } else if (isa<StoreInst>(inst)) {
-                auto storeInst = &cast<StoreInst>(inst);
-                auto op = storeInst->op_begin();
-                allVarSetMap[func].insert(op->get()->getName().str());
-                op++;
-                allVarSetMap[func].insert(op->get()->getName().str());
-            } else if (isa<BinaryOperator>(inst)) {
-                auto binaryInst = &cast<BinaryOperator>(inst);
-                auto op = binaryInst->op_begin();
-                allVarSetMap[func].insert(binaryInst->getName().str());
-                allVarSetMap[func].insert(op->get()->getName().str());
-                op++;
-                allVarSetMap[func].insert(op->get()->getName().str());
+/***
+ * Sign lattice
+ */
+
+string signToStr(Sign sign) {
+    switch (sign & SignTop) {
+        case SignBot: return "bot";
+        case SignNeg: return "-";
+        case SignZero: return "0";
+        case SignPos: return "+";
+        case SignNeg | SignZero: return "<=0";
+        case SignZero | SignPos: return ">=0";
+        case SignNeg | SignPos: return "!=0";
+        default: return "top";
+    }
+}
+
+SignTable::SignTable(const Sign single[3][3]) {
+    for (unsigned a = 0; a < 8; a++) {
+        for (unsigned b = 0; b < 8; b++) {
+            Sign sign = SignBot;
+            for (unsigned i = 0; i < 3; i++) {
+                for (unsigned j = 0; j < 3; j++) {
+                    if ((a >> i & 1) && (b >> j & 1)) {
+                        sign |= single[i][j];
+                    }
+                }
             }
+            result[a][b] = sign;
         }
+    }
+}
 
-        //add function formal parameter
-        for (auto arg_it = func->arg_begin(); arg_it != func->arg_end(); arg_it++) {
-            varSetMap[func].insert(arg_it->getName().str());
-            allVarSetMap[func].insert(arg_it->getName().str());
-        }
+void SignState::join(const SignState &other) {
+    if (words.empty()) {
+        words = other.words;
+        return;
+    }
+    for (unsigned i = 0; i < other.words.size(); i++) {
+        words[i] |= other.words[i];
     }
 }
 
+/***
+ * Call string contexts
+ */
 
-void InterSignAnalysis::topologicalSort(Function *F, std::vector<BasicBlock *> *bbVector) {
-    // implement an algorithm to sort the basicblocks
-    // parent should always present before the child
-    // Assumption: the CFG is DAG
-
-    BasicBlock *entry = &F->getEntryBlock();
-    std::queue<BasicBlock *> bb_queue;
-    bb_queue.push(entry);
-
-    while (!bb_queue.empty()) {
-        BasicBlock *head = bb_queue.front();
-        bbVector->push_back(head);
-        for (auto it = succ_begin(head); it != succ_end(head); it++) {
-            BasicBlock *bb = *it;
-            bb_queue.push(bb);
-        }
-        bb_queue.pop();
+const unsigned CallStringTable::UnknownCaller;
+
+void CallStringTable::reset(unsigned k) {
+    depth = k;
+    strings.assign(1, vector<const CallBase*>());
+    strings.push_back(vector<const CallBase*>(1, nullptr));
+    ids.clear();
+    ids[strings[0]] = 0;
+    ids[strings[UnknownCaller]] = UnknownCaller;
+}
+
+unsigned CallStringTable::extend(unsigned context, const CallBase *site) {
+    if (depth == 0) {
+        return 0;
+    }
+    vector<const CallBase*> callString = strings[context];
+    callString.push_back(site);
+    if (callString.size() > depth) {
+        callString.erase(callString.begin());
+    }
+    auto found = ids.find(callString);
+    if (found != ids.end()) {
+        return found->second;
     }
+    ids[callString] = strings.size();
+    strings.push_back(std::move(callString));
+    return strings.size() - 1;
 }
 
-string InterSignAnalysis::joinState(string state1, string state2) {
-    string state = "top";
-    if (state1 == "bot") {
-        state = state2;
-    } else if (state2 == "bot") {
-        state = state1;
-    } else if (state1 == state2) {
-        state = state1;
+size_t ContextStateCache::getMemorySize(const DenseMap<BasicBlock *, SignState> &blockStates) {
+    size_t size = blockStates.getMemorySize();
+    for (auto &bbState : blockStates) {
+        size += bbState.second.memorySize() - sizeof(SignState);
     }
-    return state;
+    return size;
+}
+
+void ContextStateCache::reset(size_t capacityBytes) {
+    lock_guard<mutex> lock(cacheMutex);
+    entries.clear();
+    index.clear();
+    capacity = capacityBytes;
+    bytes = 0;
+    numHits = numMisses = numEvictions = 0;
 }
 
-map<string, string> InterSignAnalysis::joinMapState(map<string, string> state1, map<string, string> state2) {
-    if (state1.size() == 0)  return state2;
-    if (state2.size() == 0)  return state1;
+bool ContextStateCache::take(const ContextKey &key, DenseMap<BasicBlock *, SignState> &blockStates) {
+    lock_guard<mutex> lock(cacheMutex);
+    auto found = index.find(key);
+    if (found == index.end()) {
+        numMisses++;
+        return false;
+    }
+    numHits++;
+    bytes -= getMemorySize(found->second->second);
+    blockStates = std::move(found->second->second);
+    entries.erase(found->second);
+    index.erase(found);
+    return true;
+}
 
-    map<string, string> state;
-    for (auto &statePair : state1) {
-        state[statePair.first] = joinState(statePair.second, state2[statePair.first]);
+void ContextStateCache::put(const ContextKey &key, DenseMap<BasicBlock *, SignState> &&blockStates) {
+    size_t size = getMemorySize(blockStates);
+    lock_guard<mutex> lock(cacheMutex);
+    auto old = index.find(key);
+    if (old != index.end()) {
+        bytes -= getMemorySize(old->second->second);
+        entries.erase(old->second);
+        index.erase(old);
     }
-    for (auto &statePair : state2) {
-        state[statePair.first] = joinState(statePair.second, state1[statePair.first]);
+    entries.emplace_front(key, std::move(blockStates));
+    index[key] = entries.begin();
+    bytes += size;
+    while (bytes > capacity) {
+        bytes -= getMemorySize(entries.back().second);
+        index.erase(entries.back().first);
+        entries.pop_back();
+        numEvictions++;
     }
-    return state;
 }
 
-string InterSignAnalysis::getFunctionTerminatorState(Function *func) {
-    //string state = "testState";
-    string state = "bot";
+//                                 -        0         +
+static const Sign addSingle[3][3] = {{SignNeg, SignNeg, SignTop},     // -
+                                     {SignNeg, SignZero, SignPos},    // 0
+                                     {SignTop, SignPos, SignPos}};    // +
+static const Sign subSingle[3][3] = {{SignTop, SignNeg, SignNeg},
+                                     {SignPos, SignZero, SignNeg},
+                                     {SignPos, SignPos, SignTop}};
+//the results of a division by zero, and of a shift by a negative amount, are undefined
+static const Sign mulSingle[3][3] = {{SignPos, SignZero, SignNeg},
+                                     {SignZero, SignZero, SignZero},
+                                     {SignNeg, SignZero, SignPos}};
+static const Sign sdivSingle[3][3] = {{SignZero | SignPos, SignBot, SignNeg | SignZero},
+                                      {SignZero, SignBot, SignZero},
+                                      {SignNeg | SignZero, SignBot, SignZero | SignPos}};
+static const Sign sremSingle[3][3] = {{SignNeg | SignZero, SignBot, SignNeg | SignZero},
+                                      {SignZero, SignBot, SignZero},
+                                      {SignZero | SignPos, SignBot, SignZero | SignPos}};
+//a negative value is at least 2^(n-1) as an unsigned one
+static const Sign udivSingle[3][3] = {{SignZero | SignPos, SignBot, SignTop},
+                                      {SignZero, SignBot, SignZero},
+                                      {SignZero, SignBot, SignZero | SignPos}};
+static const Sign uremSingle[3][3] = {{SignTop, SignBot, SignZero | SignPos},
+                                      {SignZero, SignBot, SignZero},
+                                      {SignPos, SignBot, SignZero | SignPos}};
+static const Sign andSingle[3][3] = {{SignNeg, SignZero, SignZero | SignPos},
+                                     {SignZero, SignZero, SignZero},
+                                     {SignZero | SignPos, SignZero, SignZero | SignPos}};
+static const Sign shlSingle[3][3] = {{SignTop, SignNeg, SignNeg},     //nsw only
+                                     {SignTop, SignZero, SignZero},
+                                     {SignTop, SignPos, SignPos}};
+static const Sign lshrSingle[3][3] = {{SignTop, SignNeg, SignPos},
+                                      {SignTop, SignZero, SignZero},
+                                      {SignTop, SignPos, SignZero | SignPos}};
+static const Sign ashrSingle[3][3] = {{SignTop, SignNeg, SignNeg},
+                                      {SignTop, SignZero, SignZero},
+                                      {SignTop, SignPos, SignZero | SignPos}};
+static const SignTable addTable(addSingle);
+static const SignTable subTable(subSingle);
+static const SignTable mulTable(mulSingle);
+static const SignTable sdivTable(sdivSingle);
+static const SignTable sremTable(sremSingle);
+static const SignTable udivTable(udivSingle);
+static const SignTable uremTable(uremSingle);
+static const SignTable andTable(andSingle);
+static const SignTable shlTable(shlSingle);
+static const SignTable lshrTable(lshrSingle);
+static const SignTable ashrTable(ashrSingle);
+
+
+/*
+ * Number the arguments and the instructions with a value; the allocas and the arguments
+ * are the variables reported
+ */
+void InterSignAnalysis::extractVars(Function *func) {
+    FunctionValues &values = valueMap[func];
+    auto addValue = [&values](const Value *v) {
+        values.ids[v] = values.values.size();
+        values.values.push_back(v);
+    };
+    //add function formal parameter
+    for (auto arg_it = func->arg_begin(); arg_it != func->arg_end(); arg_it++) {
+        values.variables.push_back(values.values.size());
+        addValue(&*arg_it);
+    }
     for (auto &bb : *func) {
-        //Instruction *inst = bb.getTerminator();
-        for (auto &instruction : bb) {
-            Instruction* inst = &instruction;
-            if (auto* returnInst = dyn_cast<ReturnInst>(inst)) {
-                state = joinState(state, signResult[func][&bb][returnInst->getOperand(0)->getName().str()]);
+        for (auto &inst: bb) {
+            if (inst.getType()->isVoidTy()) {
+                continue;
             }
+            // variable declaration
+            if (auto* allocaInst = dyn_cast<AllocaInst>(&inst)) {
+                values.variables.push_back(values.values.size());
+                if (isAllocaPromotable(allocaInst)) {
+                    values.trackedAllocas.insert(allocaInst);
+                }
+            }
+            addValue(&inst);
         }
     }
-    return state;
+    std::sort(values.variables.begin(), values.variables.end(), [&values](unsigned a, unsigned b) {
+        return values.values[a]->getName() < values.values[b]->getName();
+    });
 }
 
-void InterSignAnalysis::handleCallInst(CallInst *callInst, map<BasicBlock*, map<string, string>>& funcState) {
-    string dest = callInst->getName().str();
-    BasicBlock* bb = callInst->getParent();
-    Function *calleeFunc = callInst->getCalledFunction();
 
-    // functions cannot be null
-    if (calleeFunc == nullptr) return;
-    if (calleeFunc->isIntrinsic() || calleeFunc->empty()) {
-        funcState[bb][dest] = "top";
-        return;
-    }
+/*
+ * Reverse post order of the blocks reachable from the entry: a block comes after all its
+ * predecessors but the ones reaching it through a back edge, and each block comes once
+ */
+void InterSignAnalysis::topologicalSort(Function *F, std::vector<BasicBlock *> *bbVector) {
+    ReversePostOrderTraversal<Function *> RPOT(F);
+    bbVector->assign(RPOT.begin(), RPOT.end());
+}
 
-    vector<string> actualParaList;
+Sign InterSignAnalysis::joinState(Sign state1, Sign state2) {
+    return state1 | state2;
+}
 
-    for (int i = 0; i < callInst->getNumArgOperands(); i++) {
-        auto* argOperand = callInst->getArgOperand(i);
-        if (auto *constValue = dyn_cast<ConstantInt>(argOperand)) {
-            actualParaList.push_back(getConstantIntSign(constValue));
-        } else {
-            actualParaList.push_back(funcState[callInst->getParent()][argOperand->getName()]);
-            //actualParaList.push_back("top");
+Sign InterSignAnalysis::getFunctionTerminatorState(Function *func, const DenseMap<BasicBlock*, SignState> &funcState) {
+    Sign state = SignBot;
+    const FunctionValues &values = valueMap[func];
+    for (auto &bb : *func) {
+        auto* returnInst = dyn_cast<ReturnInst>(bb.getTerminator());
+        auto bbState = funcState.find(&bb);
+        if (returnInst && returnInst->getReturnValue() && bbState != funcState.end()) {
+            state = joinState(state, getSign(returnInst->getReturnValue(), values, bbState->second));
         }
     }
+    return state;
+}
 
-    if (isSensitive) {
-        entryState[calleeFunc] = actualParaList;
-        analyzeFunction(calleeFunc);
-        funcState[bb][dest] = getFunctionTerminatorState(calleeFunc);
-    } else {
-        //update the entry state of callee
-        if (entryState.find(calleeFunc) == entryState.end()) {
-            entryState[calleeFunc] = actualParaList;
-        } else {
-            for (int i = 0; i < entryState[calleeFunc].size(); i++) {
-                entryState[calleeFunc][i] = joinState(entryState[calleeFunc][i], actualParaList[i]);
-            }
-        }
-
-        //add the callee to the worklist or retrieve the cache
-        if (!functionAnalyzedFlag[calleeFunc]) {
-            funcState[bb][dest] = "top";
-            if (!calleeFunc->isIntrinsic() && !calleeFunc->empty()) {
-                funcQueue.push(calleeFunc);
-            }
-        } else {
-            funcState[bb][dest] = getFunctionTerminatorState(calleeFunc);
-        }
+/*
+ * A constant has its own sign, a numbered value the one in state, anything else is top
+ */
+Sign InterSignAnalysis::getSign(const Value *v, const FunctionValues &values, const SignState &state) {
+    if (auto *constValue = dyn_cast<ConstantInt>(v)) {
+        return getConstantIntSign(const_cast<ConstantInt*>(constValue));
     }
+    unsigned id = values.getId(v);
+    return id == -1u || state.empty() ? SignTop : state.get(id);
 }
 
-void InterSignAnalysis::handleLoadInst(LoadInst* loadInst, map<BasicBlock*, map<string, string>>& funcState) {
-    string dest = loadInst->getName().str();
-    BasicBlock* bb = loadInst->getParent();
-    Value *operand = loadInst->getOperand(0);
-    funcState[bb][dest] = funcState[bb][operand->getName().str()];
+/*
+ * An argument keeps its sign from the entry block on, and an instruction from the end of its
+ * block on, so the state at the end of that block holds the sign at every use
+ */
+Sign InterSignAnalysis::getValueSign(const Value *v) {
+    if (auto *constValue = dyn_cast<ConstantInt>(v)) {
+        return getConstantIntSign(const_cast<ConstantInt*>(constValue));
+    }
+    const BasicBlock *bb = nullptr;
+    if (auto *arg = dyn_cast<Argument>(v)) {
+        bb = &arg->getParent()->getEntryBlock();
+    } else if (auto *inst = dyn_cast<Instruction>(v)) {
+        bb = inst->getParent();
+    }
+    if (bb == nullptr) {
+        return SignTop;
+    }
+    Function *func = const_cast<Function*>(bb->getParent());
+    auto result = signResult.find(func);
+    if (result == signResult.end()) {
+        return SignTop;
+    }
+    auto bbState = result->second.find(const_cast<BasicBlock*>(bb));
+    if (bbState == result->second.end()) {
+        return SignTop;
+    }
+    return getSign(v, valueMap[func], bbState->second);
 }
 
-void InterSignAnalysis::handleStoreInst(StoreInst* storeInst, map<BasicBlock*, map<string, string>>& funcState) {
-    Value *operand1 = storeInst->getOperand(0);
-    Value *operand2 = storeInst->getOperand(1);
-    BasicBlock* bb = storeInst->getParent();
+void InterSignAnalysis::handleCallBase(CallBase *callBase, const FunctionValues &values, SignState &state,
+                                       unsigned context) {
+    unsigned dest = values.getId(callBase);
+    Function *calleeFunc = callBase->getCalledFunction();
 
-    if (isa<Constant>(operand1)) {
-        if (auto *constValue = dyn_cast<ConstantInt>(operand1)) {
-            funcState[bb][operand2->getName().str()] = getConstantIntSign(constValue);
-        } else {
-            //memo: non-integer constant
-            funcState[bb][operand2->getName().str()] = "top";
-        }
+    // functions cannot be null
+    if (calleeFunc == nullptr || calleeFunc->isIntrinsic() || calleeFunc->empty()) {
+        if (dest != -1u) state.set(dest, SignTop);
+        return;
+    }
+
+    vector<Sign> actualParaList;
+    for (unsigned i = 0; i < callBase->arg_size(); i++) {
+        actualParaList.push_back(getSign(callBase->getArgOperand(i), values, state));
+    }
+
+    Sign result;
+    if (isSensitive) {
+        result = getCalleeSummary(calleeFunc, actualParaList);
     } else {
-        funcState[bb][operand2->getName().str()] = funcState[bb][operand1->getName().str()];
+        result = getCalleeContext(calleeFunc, callBase, context, actualParaList);
     }
+    if (dest != -1u) state.set(dest, result);
 }
 
-void InterSignAnalysis::handleBranchInst(BranchInst* branchInst, map<BasicBlock*, map<string, string>>& funcState) {
-    if (!branchInst->isConditional()) {
-        return;
+/*
+ * The context of the callee is the call string of the caller extended with this call, so with
+ * -intersign-context-depth=0 all the calls of a function share one context. A new context, or one
+ * whose entry state grows, is analyzed (again) later; until then the call reads the return sign
+ * computed so far, bot at first.
+ */
+Sign InterSignAnalysis::getCalleeContext(Function *callee, CallBase *callBase, unsigned context,
+                                         const vector<Sign> &args) {
+    lock_guard<mutex> lock(scheduleMutex);
+    unsigned calleeContext = callStrings.extend(context, callBase);
+    auto inserted = contextStates[callee].emplace(calleeContext, ContextState());
+    ContextState &calleeState = inserted.first->second;
+    bool grown = inserted.second;
+    if (grown) {
+        calleeState.entry.assign(callee->arg_size(), SignBot);
+    }
+    for (unsigned i = 0; i < calleeState.entry.size() && i < args.size(); i++) {
+        Sign joined = joinState(calleeState.entry[i], args[i]);
+        grown |= joined != calleeState.entry[i];
+        calleeState.entry[i] = joined;
+    }
+    if (grown) {
+        pendingContexts.insert(ContextKey(callee, calleeContext));
+    }
+    calleeState.callers.insert(ContextKey(callBase->getFunction(), context));
+    return calleeState.returnSign;
+}
+
+/*
+ * A recursive call in the same context reads the return sign computed so far (bot at first),
+ * and the callee is analyzed again until that sign no longer changes. The summaries computed
+ * meanwhile may have read an older sign, so they are dropped when it changes.
+ * analyzeFunction joins the block states into signResult, so a summary only keeps the return sign.
+ */
+Sign InterSignAnalysis::getCalleeSummary(Function *callee, const vector<Sign> &args) {
+    SummaryKey key(callee, args);
+    auto cached = summaryCache.find(key);
+    if (cached != summaryCache.end()) {
+        numSummaryHits++;
+        cached->second.readInProgress |= cached->second.inProgress;
+        return cached->second.returnSign;
     }
-    Function* f = branchInst->getParent()->getParent();
-    if (auto* icmpInst = dyn_cast<ICmpInst>(branchInst->getCondition())) {
-        //ICMP_SGT
-        if (icmpInst->getSignedPredicate() != CmpInst::ICMP_SGT) {
-            return;
+    numSummaryMisses++;
+
+    SignSummary &summary = summaryCache[key];
+    summary.inProgress = true;
+    summary.firstComputed = computedOrder.size();
+    DenseMap<BasicBlock*, SignState> blockStates;
+    while (true) {
+        summary.readInProgress = false;
+        contextStates[callee][0].entry = args;
+        blockStates.clear();
+        Sign returnSign = analyzeFunction(callee, 0, blockStates);
+        bool changed = returnSign != summary.returnSign;
+        summary.returnSign = returnSign;
+        if (!changed || !summary.readInProgress) {
+            break;
         }
-        if (auto* loadInst = dyn_cast<LoadInst>(icmpInst->getOperand(0))) {
-            string pathVarName = loadInst->getPointerOperand()->getName().str();
-            branchVarSetMap[f].insert(pathVarName);
-//            funcState[branchInst->getSuccessor(0)][pathVarName] = "+";
-//            funcState[branchInst->getSuccessor(1)][pathVarName] = "top";
-            branchCondMap[icmpInst->getParent()->getParent()][branchInst->getSuccessor(0)][pathVarName] = "+";
-            branchCondMap[icmpInst->getParent()->getParent()][branchInst->getSuccessor(1)][pathVarName] = "top";
+        PASS_DEBUG(SignLog) << callee->getName() << ": recursive return sign now " << signToStr(returnSign) << "\n";
+        for (unsigned i = summary.firstComputed; i < computedOrder.size(); i++) {
+            summaryCache.erase(computedOrder[i]);
         }
+        computedOrder.resize(summary.firstComputed);
     }
+    summary.inProgress = false;
+    computedOrder.push_back(key);
+    return summary.returnSign;
 }
 
-string InterSignAnalysis::addTwoSigns(string op1, string op2) {
-    if (op1 == "bot" || op1 == "top" || op2 == "bot" || op2 == "top")  return "top";
-
-    if (op1 == "0")  return op2;
-    if (op2 == "0")  return op1;
-
-    if (op1 == "+" && op2 == "+")  return "+";
-    if (op1 == "-" && op2 == "-")  return "-";
-    if (op1 == "+" && op2 == "-")  return "top";
-    if (op1 == "-" && op2 == "+")  return "top";
+//only the allocas whose address does not escape are followed through memory
+void InterSignAnalysis::handleLoadInst(LoadInst* loadInst, const FunctionValues &values, SignState &state) {
+    const Value *pointer = loadInst->getPointerOperand();
+    bool tracked = values.trackedAllocas.count(pointer);
+    state.set(values.getId(loadInst), tracked ? getSign(pointer, values, state) : SignTop);
 }
 
-string InterSignAnalysis::subTwoSigns(string op1, string op2) {
-    if (op1 == "bot" || op1 == "top" || op2 == "bot" || op2 == "top")  return "top";
+void InterSignAnalysis::handleStoreInst(StoreInst* storeInst, const FunctionValues &values, SignState &state) {
+    const Value *pointer = storeInst->getPointerOperand();
+    unsigned dest = values.getId(pointer);
+    if (dest != -1u && values.trackedAllocas.count(pointer)) {
+        //memo: non-integer values are top
+        state.set(dest, getSign(storeInst->getValueOperand(), values, state));
+    }
+}
 
-    if (op1 == "0" && op2 == "0")  return "0";
-    if (op1 == "0")  return (op2 == "+" ? "-" : "+");
-    if (op2 == "0")  return (op2 == "-" ? "+" : "-");
+/*
+ * Signs allowed by "v pred c"
+ */
+static Sign getSignsSatisfying(CmpInst::Predicate pred, const APInt &c) {
+    bool neg = c.isNegative(), zero = c.isNullValue(), pos = c.isStrictlyPositive();
+    bool minusOne = c.isAllOnesValue(), one = c.isOneValue();
+    switch (pred) {
+        case CmpInst::ICMP_SGT: return pos || zero ? SignPos : minusOne ? SignZero | SignPos : SignTop;
+        case CmpInst::ICMP_SGE: return pos ? SignPos : zero ? SignZero | SignPos : SignTop;
+        case CmpInst::ICMP_SLT: return neg || zero ? SignNeg : one ? SignNeg | SignZero : SignTop;
+        case CmpInst::ICMP_SLE: return neg ? SignNeg : zero ? SignNeg | SignZero : SignTop;
+        case CmpInst::ICMP_EQ: return neg ? SignNeg : zero ? SignZero : SignPos;
+        case CmpInst::ICMP_NE: return zero ? SignNeg | SignPos : SignTop;
+        default: return SignTop;
+    }
+}
 
-    if (op1 == "+" && op2 == "+")  return "top";
-    if (op1 == "-" && op2 == "-")  return "top";
-    if (op1 == "+" && op2 == "-")  return "+";
-    if (op1 == "-" && op2 == "+")  return "-";
+/*
+ * A branch on "load of a variable pred constant" refines the sign of the variable on both edges,
+ * if the variable still holds the loaded value at the branch: the load is in the same block,
+ * with no store to the variable and no call after it
+ */
+bool InterSignAnalysis::applyBranchCondition(BasicBlock *from, BasicBlock *to, const FunctionValues &values,
+                                             SignState &state) {
+    auto* branchInst = dyn_cast<BranchInst>(from->getTerminator());
+    if (!branchInst || !branchInst->isConditional() || branchInst->getSuccessor(0) == branchInst->getSuccessor(1)) {
+        return true;
+    }
+    auto* icmpInst = dyn_cast<ICmpInst>(branchInst->getCondition());
+    if (!icmpInst) {
+        return true;
+    }
+    CmpInst::Predicate pred = branchInst->getSuccessor(0) == to ? icmpInst->getPredicate()
+                                                                : icmpInst->getInversePredicate();
+    Value *lhs = icmpInst->getOperand(0), *rhs = icmpInst->getOperand(1);
+    if (isa<ConstantInt>(lhs)) {
+        std::swap(lhs, rhs);
+        pred = CmpInst::getSwappedPredicate(pred);
+    }
+    auto* loadInst = dyn_cast<LoadInst>(lhs);
+    auto* constValue = dyn_cast<ConstantInt>(rhs);
+    unsigned var = loadInst ? values.getId(loadInst->getPointerOperand()) : -1u;
+    if (!constValue || var == -1u || !values.trackedAllocas.count(loadInst->getPointerOperand()) ||
+        loadInst->getParent() != from) {
+        return true;
+    }
+    for (auto it = std::next(loadInst->getIterator()); &*it != branchInst; it++) {
+        auto* storeInst = dyn_cast<StoreInst>(&*it);
+        if (isa<CallBase>(*it) || (storeInst && storeInst->getPointerOperand() == loadInst->getPointerOperand())) {
+            return true;
+        }
+    }
+    Sign refined = state.get(var) & getSignsSatisfying(pred, constValue->getValue());
+    PASS_TRACE(SignLog) << to->getName() << ": " << values.values[var]->getName() << " refined to "
+                        << signToStr(refined) << "\n";
+    state.set(var, refined);
+    return refined != SignBot;
 }
 
-void InterSignAnalysis::handleBinaryOperator(BinaryOperator *binaryInst, map<BasicBlock*, map<string, string>>& funcState) {
-    BasicBlock* bb = binaryInst->getParent();
-    string sign1, sign2;
-    //arithmetic instruction
-    if (binaryInst->getOpcode() == Instruction::Add || binaryInst->getOpcode() == Instruction::Sub) {
-        Value *operand1 = binaryInst->getOperand(0);
-        Value *operand2 = binaryInst->getOperand(1);
+Sign InterSignAnalysis::addTwoSigns(Sign op1, Sign op2) {
+    return addTable.apply(op1, op2);
+}
 
-        //Get the signs of operands
-        if (auto *consop1 = dyn_cast<ConstantInt>(operand1)) {
-            sign1 = getConstantIntSign(consop1);
-        } else {
-            sign1 = funcState[bb][operand1->getName().str()];
-        }
+Sign InterSignAnalysis::subTwoSigns(Sign op1, Sign op2) {
+    return subTable.apply(op1, op2);
+}
 
-        if (auto *consop2 = dyn_cast<ConstantInt>(operand2)) {
-            sign2 = getConstantIntSign(consop2);
-        } else {
-            sign2 = funcState[bb][operand2->getName().str()];
-        }
+void InterSignAnalysis::handleBinaryOperator(BinaryOperator *binaryInst, const FunctionValues &values,
+                                             SignState &state) {
+    Sign sign1 = getSign(binaryInst->getOperand(0), values, state);
+    Sign sign2 = getSign(binaryInst->getOperand(1), values, state);
+
+    //Get the sign of the result; add, sub, mul and shl may wrap around to any sign without nsw
+    unsigned dest = values.getId(binaryInst);
+    bool noWrap = isa<OverflowingBinaryOperator>(binaryInst) && binaryInst->hasNoSignedWrap();
+    Sign result = SignTop;
+    switch (binaryInst->getOpcode()) {
+        case Instruction::Add: result = noWrap ? addTwoSigns(sign1, sign2) : SignTop; break;
+        case Instruction::Sub: result = noWrap ? subTwoSigns(sign1, sign2) : SignTop; break;
+        case Instruction::Mul: result = noWrap ? mulTable.apply(sign1, sign2) : SignTop; break;
+        case Instruction::Shl: result = noWrap ? shlTable.apply(sign1, sign2) : SignTop; break;
+        case Instruction::SDiv: result = sdivTable.apply(sign1, sign2); break;
+        case Instruction::SRem: result = sremTable.apply(sign1, sign2); break;
+        case Instruction::UDiv: result = udivTable.apply(sign1, sign2); break;
+        case Instruction::URem: result = uremTable.apply(sign1, sign2); break;
+        case Instruction::And: result = andTable.apply(sign1, sign2); break;
+        case Instruction::LShr: result = lshrTable.apply(sign1, sign2); break;
+        case Instruction::AShr: result = ashrTable.apply(sign1, sign2); break;
+        default: break;
     }
+    //no value comes out of an operation on no value
+    if (sign1 == SignBot || sign2 == SignBot) {
+        result = SignBot;
+    }
+    state.set(dest, result);
+}
 
-    //Get the sign of the result
-    string dest = binaryInst->getName().str();
-    if (binaryInst->getOpcode() == Instruction::Add) {
-        string str = addTwoSigns(sign1, sign2);
-        funcState[bb][dest] = str;
-        string str2 = funcState[bb][dest];
-    } else if (binaryInst->getOpcode() == Instruction::Sub) {
-        funcState[bb][dest] = subTwoSigns(sign1, sign2);
+void InterSignAnalysis::handleCastInst(CastInst *castInst, const FunctionValues &values, SignState &state) {
+    Sign sign = getSign(castInst->getOperand(0), values, state);
+    Sign result = sign == SignBot ? SignBot : SignTop;
+    switch (castInst->getOpcode()) {
+        case Instruction::SExt:
+            result = sign;
+            break;
+        case Instruction::ZExt:
+            //never negative, and zero only if the operand is
+            result = (sign & SignZero) | (sign & (SignNeg | SignPos) ? SignPos : SignBot);
+            break;
+        case Instruction::Trunc:
+            result = sign == SignZero ? SignZero : result;
+            break;
+        default:
+            break;
     }
+    state.set(values.getId(castInst), result);
 }
 
 
-void InterSignAnalysis::intraBBAnalyze(BasicBlock *bb, map<BasicBlock*, map<string, string>>& funcState) {
+bool InterSignAnalysis::intraBBAnalyze(BasicBlock *bb, DenseMap<BasicBlock*, SignState>& funcState,
+                                       unsigned context) {
     Function* f = bb->getParent();
+    const FunctionValues &values = valueMap[f];
+    SignState state(values.values.size());
     //initilize the state
     if (bb == &f->getEntryBlock()) {
-        //bb is the entry node
-        for (auto var : allVarSetMap[f]) {
-            funcState[bb][var] = "bot";
+        //bb is the entry node: the parameters take the entry state of the context
+        vector<Sign> entry;
+        {
+            lock_guard<mutex> lock(scheduleMutex);
+            entry = contextStates[f][context].entry;
         }
-        //initiliazed the parameter
-        for (int i = 0; i < entryState[f].size(); i++) {
-            string para = f->getArg(i)->getName().str();
-            funcState[bb][para] = entryState[f][i];
+        for (unsigned i = 0; i < f->arg_size(); i++) {
+            state.set(values.getId(f->getArg(i)), i < entry.size() ? entry[i] : SignTop);
         }
     } else {
-        //bb is not the entry node
-        map<string, string> joinState;
+        //bb is not the entry node: join the states of the predecessors, refined on each edge
         for (auto it = pred_begin(bb); it != pred_end(bb); it++) {
-            joinState = joinMapState(joinState, funcState[*it]);
-        }
-        funcState[bb] = joinState;
-
-        //update the branch condition var via branchCondMap
-        map<string, string> condMap = branchCondMap[bb->getParent()][bb];
-        for (auto & it : condMap) {
-            errs() << bb->getName().str() << "\n";
-            errs() << it.second << "\n";
-            funcState[bb][it.first] = it.second;
+            auto predState = funcState.find(*it);
+            if (predState == funcState.end()) {
+                continue;
+            }
+            SignState edgeState = predState->second;
+            if (applyBranchCondition(*it, bb, values, edgeState)) {
+                state.join(edgeState);
+            }
         }
     }
 
     for (auto &instruction : *bb) {
-        if (auto* callInst = dyn_cast<CallInst>(&instruction)) {
-            handleCallInst(callInst, funcState);
+        if (auto* callBase = dyn_cast<CallBase>(&instruction)) {
+            handleCallBase(callBase, values, state, context);
         } else if (auto* storeInst = dyn_cast<StoreInst>(&instruction)) {
-            handleStoreInst(storeInst, funcState);
+            handleStoreInst(storeInst, values, state);
         } else if (auto* loadInst = dyn_cast<LoadInst>(&instruction)) {
-            handleLoadInst(loadInst, funcState);
-        } else if (auto* branchInst = dyn_cast<BranchInst>(&instruction)) {
-            handleBranchInst(branchInst, funcState);
+            handleLoadInst(loadInst, values, state);
         } else if (auto* binaryInst = dyn_cast<BinaryOperator>(&instruction)) {
-            handleBinaryOperator(binaryInst, funcState);
+            handleBinaryOperator(binaryInst, values, state);
+        } else if (auto* castInst = dyn_cast<CastInst>(&instruction)) {
+            handleCastInst(castInst, values, state);
+        } else if (auto* phiNode = dyn_cast<PHINode>(&instruction)) {
+            //each incoming value as it is at the end of its block
+            Sign sign = SignBot;
+            for (unsigned i = 0; i < phiNode->getNumIncomingValues(); i++) {
+                auto predState = funcState.find(phiNode->getIncomingBlock(i));
+                if (predState != funcState.end()) {
+                    sign = joinState(sign, getSign(phiNode->getIncomingValue(i), values, predState->second));
+                }
+            }
+            state.set(values.getId(phiNode), sign);
+        } else if (auto* selectInst = dyn_cast<SelectInst>(&instruction)) {
+            state.set(values.getId(selectInst), joinState(getSign(selectInst->getTrueValue(), values, state),
+                                                          getSign(selectInst->getFalseValue(), values, state)));
+        } else if (isa<AllocaInst>(instruction)) {
+            //the content of an escaping alloca may change behind the loads
+            if (!values.trackedAllocas.count(&instruction)) {
+                state.set(values.getId(&instruction), SignTop);
+            }
+        } else if (!instruction.getType()->isVoidTy()) {
+            state.set(values.getId(&instruction), SignTop);
+        }
+    }
+
+    //the state of a block only grows, so with 3 bits per value it changes a bounded number of times
+    auto old = funcState.find(bb);
+    if (old != funcState.end()) {
+        state.join(old->second);
+        if (state == old->second) {
+            return false;
         }
     }
+    funcState[bb] = std::move(state);
+    return true;
 }
 
-string InterSignAnalysis::getConstantIntSign(ConstantInt *var) {
-    if (var->isNegative()) return "-";
-    if (var->isZero()) return "0";
-    return "+";
+Sign InterSignAnalysis::getConstantIntSign(ConstantInt *var) {
+    if (var->isNegative()) return SignNeg;
+    if (var->isZero()) return SignZero;
+    return SignPos;
 }
 
 /***
  * Analyze a function for signs
  * @param func
  */
-// you will need to modify the signature of this function
-void InterSignAnalysis::analyzeFunction(Function *func) {
-    // extract the variables
-    // we save the `id -> varname`
-    // you could assume we only have declarations in `main`
-    bool fixed = true;
-
-    // sort the basicblocks in `main`
-    auto mainBBVector = new std::vector<BasicBlock *>();
-
-    //the state of function: map basicblock to sign mapping
-    map<BasicBlock*, map<string, string>> fState;
-
-    //assume that there is no loop in each function
-    topologicalSort(func, mainBBVector);
-
-    // analyze each basicblock in `main`
-    for (auto &bb : *mainBBVector) {
-        // your code goes here
-        intraBBAnalyze(bb, fState);
-        if (!isFunctionFixedPoint(signResult[func][bb], fState[bb])) {
-            fixed = false;
-        }
-        signResult[func][bb] = fState[bb];
+// The worklist always takes the first pending block in reverse post order, so a loop body
+// is iterated to its fixed point before the blocks after the loop run.
+// The lattice is finite, so the join needs no widening.
+Sign InterSignAnalysis::analyzeFunction(Function *func, unsigned context, DenseMap<BasicBlock*, SignState> &fState) {
+    std::vector<BasicBlock *> bbVector;
+    DenseMap<BasicBlock*, unsigned> rpoIndex;
+    topologicalSort(func, &bbVector);
+    for (unsigned i = 0; i < bbVector.size(); i++) {
+        rpoIndex[bbVector[i]] = i;
     }
 
-    functionAnalyzedFlag[func] = true;
-    functionFixedPointFlag[func] = fixed;
-}
-
-bool InterSignAnalysis::isFunctionFixedPoint(map<string, string> &s1, map<string, string> &s2) {
-    for (auto &p: s2) {
-        if (s1.find(p.first) == s1.end()) {
-            return false;
-        } else if (s1[p.first] != p.second) {
-            return false;
+    set<unsigned> worklist;
+    for (unsigned i = 0; i < bbVector.size(); i++) {
+        worklist.insert(i);
+    }
+    unsigned visits = 0;
+    while (!worklist.empty()) {
+        BasicBlock *bb = bbVector[*worklist.begin()];
+        worklist.erase(worklist.begin());
+        visits++;
+        if (!intraBBAnalyze(bb, fState, context)) {
+            continue;
+        }
+        for (auto it = succ_begin(bb); it != succ_end(bb); it++) {
+            worklist.insert(rpoIndex[*it]);
         }
     }
-    return true;
+    PASS_TRACE(SignLog) << func->getName() << ": " << visits << " visits of " << bbVector.size() << " blocks\n";
+
+    //a call in func may have analyzed func again meanwhile, so the results are only joined now
+    DenseMap<BasicBlock*, SignState> &result = signResult[func];
+    for (auto &bbState : fState) {
+        result[bbState.first].join(bbState.second);
+    }
+    return getFunctionTerminatorState(func, fState);
 }
 
 void InterSignAnalysis::generateCallerList(Module &M) {
@@ -399,51 +695,153 @@ void InterSignAnalysis::generateCallerList(Module &M) {
 
 void InterSignAnalysis::generateTopFunctionList() {
     for (auto &it : allFuncSet) {
-        if (callerInfo.find(it) == callerInfo.end()) {
+        bool isEntry = callerInfo.find(it) == callerInfo.end();
+        if (isEntry) {
             entryFunction.push_back(it);
         }
+        //another module, or an indirect call, may pass any arguments
+        if (isEntry || !it->hasLocalLinkage() || it->hasAddressTaken()) {
+            rootFunction.push_back(it);
+        }
     }
 }
 
-bool InterSignAnalysis::runOnModule(Module &M) {
-    isSensitive = false;
-    generateCallerList(M);
+/*
+ * scc_iterator yields the SCCs callees first; the level of an SCC is one more than
+ * the highest level of the SCCs it calls
+ */
+void InterSignAnalysis::generateSCCLevels(CallGraph &CG) {
+    DenseMap<const Function*, unsigned> levelOf;
+    for (auto scc = scc_begin(&CG); !scc.isAtEnd(); ++scc) {
+        vector<Function*> component;
+        unsigned level = 0;
+        for (CallGraphNode *node : *scc) {
+            Function *func = node->getFunction();
+            if (func == nullptr || allFuncSet.find(func) == allFuncSet.end()) continue;
+            component.push_back(func);
+            for (auto &callRecord : *node) {
+                auto calleeLevel = levelOf.find(callRecord.second->getFunction());
+                if (calleeLevel != levelOf.end()) {
+                    level = std::max(level, calleeLevel->second + 1);
+                }
+            }
+        }
+        if (component.empty()) continue;
+        for (auto func : component) {
+            levelOf[func] = level;
+        }
+        if (sccLevels.size() <= level) {
+            sccLevels.resize(level + 1);
+        }
+        sccLevels[level].push_back(std::move(component));
+    }
+}
 
-    //extract variables in each function
-    for (auto &func : entryFunction) {
-        funcQueue.push(func);
+vector<unsigned> InterSignAnalysis::takePending(Function *func) {
+    lock_guard<mutex> lock(scheduleMutex);
+    vector<unsigned> contexts;
+    auto it = pendingContexts.lower_bound(ContextKey(func, 0));
+    while (it != pendingContexts.end() && it->first == func) {
+        contexts.push_back(it->second);
+        it = pendingContexts.erase(it);
     }
+    return contexts;
+}
 
-    for (auto &Func : M) {
-        Function *func = &Func;
-        if (func == nullptr) continue;
-        // remove llvm-inserted functions
-        if (func->isIntrinsic()) continue;
-        //remove lib function
-        if (func->empty()) continue;
+/*
+ * The states of the last analysis of the context, if still cached, are below its new fixed
+ * point, so the analysis restarts from them. Callers only read the return sign of a callee,
+ * so only a new return sign makes them pending again.
+ */
+void InterSignAnalysis::analyzeContext(Function *func, unsigned context) {
+    ContextKey key(func, context);
+    DenseMap<BasicBlock*, SignState> blockStates;
+    stateCache.take(key, blockStates);
+    Sign returnSign = analyzeFunction(func, context, blockStates);
+    numAnalyses++;
+    stateCache.put(key, std::move(blockStates));
+
+    lock_guard<mutex> lock(scheduleMutex);
+    ContextState &state = contextStates[func][context];
+    if (state.returnSign != returnSign) {
+        state.returnSign = returnSign;
+        pendingContexts.insert(state.callers.begin(), state.callers.end());
+    }
+}
+
+/*
+ * Analyze the pending contexts of the functions of an SCC until none is left
+ */
+void InterSignAnalysis::analyzeComponent(const vector<Function*> &component) {
+    bool analyzed = true;
+    while (analyzed) {
+        analyzed = false;
+        for (auto func : component) {
+            for (unsigned context : takePending(func)) {
+                analyzeContext(func, context);
+                analyzed = true;
+            }
+        }
+    }
+}
 
-        functionAnalyzedFlag[func] = false;
-        functionFixedPointFlag[func] = false;
+/*
+ * Bottom-up over the levels of SCCs, so a function is analyzed after the return signs of its
+ * callees are known; the SCCs of one level are independent and run concurrently. A call may
+ * still reach a new context of a callee, or widen the entry state of one analyzed before, which
+ * then runs again in the next sweep, and its callers after it if its return sign changes.
+ */
+void InterSignAnalysis::analyzeBottomUp() {
+    unsigned sweeps = 0;
+    while (!pendingContexts.empty()) {
+        sweeps++;
+        for (auto &level : sccLevels) {
+            PassUtilSpace::parallelForEach(level.size(), SignThreads, [&](unsigned i) {
+                analyzeComponent(level[i]);
+            });
+        }
     }
+    PASS_DEBUG(SignLog) << "analyses: " << numAnalyses << ", sweeps: " << sweeps << ", contexts: "
+                        << callStrings.size() << "\n";
+    PASS_DEBUG(SignLog) << "cached states: hits: " << stateCache.numHits << ", misses: " << stateCache.numMisses
+                        << ", evictions: " << stateCache.numEvictions << "\n";
+}
 
-    //initialize the variable set
+bool InterSignAnalysis::runOnModule(Module &M) {
+    isSensitive = SensitiveMode;
+    generateCallerList(M);
+
+    //initialize the variable set, and the maps the workers only look up
     for (auto &func : allFuncSet) {
         extractVars(func);
+        signResult[func];
+        contextStates[func];
     }
+    //the calls from outside the module pass unknown parameters to the root functions, in a context
+    //of their own, so the calls in the module still start from the arguments they pass
+    for (auto func : rootFunction) {
+        contextStates[func][CallStringTable::UnknownCaller].entry.assign(func->arg_size(), SignTop);
+    }
+    callStrings.reset(ContextDepth);
+    stateCache.reset(size_t(ContextCacheMB) << 20);
 
-    //Get the call graph and topological sort the functions
-    while (!funcQueue.empty()) {
-        Function *head = funcQueue.front();
-        analyzeFunction(head);
-        if (!functionFixedPointFlag[head]) {
-            //Add the caller of head to functions
-            for (auto caller : callerInfo[head]) {
-                funcQueue.push(caller);
-            }
+    if (isSensitive) {
+        //the callees are analyzed through the summaries, in the context of each call
+        for (auto func : rootFunction) {
+            //a summary may have analyzed func with other arguments meanwhile
+            contextStates[func][0].entry.assign(func->arg_size(), SignTop);
+            DenseMap<BasicBlock*, SignState> blockStates;
+            analyzeFunction(func, 0, blockStates);
+        }
+        PASS_DEBUG(SignLog) << "summaries: " << summaryCache.size() << ", hits: " << numSummaryHits
+                            << ", misses: " << numSummaryMisses << "\n";
+    } else {
+        generateSCCLevels(getAnalysis<CallGraphWrapperPass>().getCallGraph());
+        for (auto func : rootFunction) {
+            pendingContexts.insert(ContextKey(func, CallStringTable::UnknownCaller));
         }
-        funcQueue.pop();
+        analyzeBottomUp();
     }
-
     reportResult(M);
     return true;
 }
@@ -467,21 +865,16 @@ void InterSignAnalysis::reportResult(Module &M) {
     // your code goes here
 
     for (auto func : entryFunction) {
-        set<string> varSet = varSetMap[func];
         errs() << "--------------------------------------------" << "\n";
         errs() << "Function name: " << func->getName().str() << "\n";
         errs() << "--------------------------------------------" << "\n";
-        map<BasicBlock *, map<string, string>> function_state = signResult[func];
-        for (auto subit = function_state.begin(); subit != function_state.end(); subit++) {
-            BasicBlock *bb = subit->first;
-            map<string, string> bbstate = subit->second;
-            errs() << bb->getName().str() << ":" << "\n";
-            for (auto subsubit = bbstate.begin(); subsubit != bbstate.end(); subsubit++) {
-                string varName = subsubit->first;
-                if (varSet.find(varName) != varSet.end()) {
-                    errs() << varName << " " << subsubit->second << "\n";
-                }
+        for (auto &bb : *func) {
+            auto bbState = signResult[func].find(&bb);
+            if (bbState == signResult[func].end()) {
+                continue;
             }
+            errs() << bb.getName().str() << ":" << "\n";
+            printSignState(func, bbState->second);
             errs() << "\n";
         }
         errs() << "\n";
@@ -489,8 +882,9 @@ void InterSignAnalysis::reportResult(Module &M) {
 }
 
 //debug helper
-void InterSignAnalysis::printStrStrMap(map<string, string> state) {
-    for (auto it = state.begin(); it != state.end(); it++) {
-        errs() << it->first << " " << it->second << "\n";
+void InterSignAnalysis::printSignState(Function* func, const SignState& state) {
+    const FunctionValues &values = valueMap[func];
+    for (unsigned var : values.variables) {
+        errs() << values.values[var]->getName() << " " << signToStr(state.get(var)) << "\n";
     }
 }
@@ -0,0 +1,129 @@
+//========================================================================
+// FILE:
+//    SignStrengthReduction.cpp
+//
+// DESCRIPTION:
+//    Sign-driven strength reduction
+//    The replacements of a function are all chosen before the first one
+//    is made, so the signs are only looked up for the values analyzed.
+//    The exact flag of a division is kept; srem has no unsigned form
+//    with a negative divisor, so its divisor must be non-negative too.
+//
+// License: MIT
+//========================================================================
+
+#include <utility>
+#include <vector>
+#include "llvm/IR/Constants.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "pass/SignStrengthReduction.h"
+#include "util/Log.h"
+
+char SignStrengthReduction::ID = 0;
+
+//----------------------------------------------------------
+// Implementation of SignStrengthReduction
+//----------------------------------------------------------
+
+void SignStrengthReduction::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<InterSignAnalysis>();
+    AU.setPreservesCFG();
+}
+
+// bot: a value never computed, nothing is known about where it would be used
+bool SignStrengthReduction::isNonNegative(const Value *v) {
+    Sign sign = signs->getValueSign(v);
+    return sign != SignBot && !(sign & SignNeg);
+}
+
+Instruction *SignStrengthReduction::getReplacement(Instruction *inst, RewriteCounts &counts) {
+    if (inst->getNumOperands() == 0 || !inst->getOperand(0)->getType()->isIntegerTy()) {
+        return nullptr;
+    }
+    Value *lhs = inst->getOperand(0);
+
+    switch (inst->getOpcode()) {
+        case Instruction::SDiv:
+        case Instruction::SRem: {
+            Value *rhs = inst->getOperand(1);
+            if (!isNonNegative(lhs) || !isNonNegative(rhs)) {
+                return nullptr;
+            }
+            bool isDiv = inst->getOpcode() == Instruction::SDiv;
+            auto *divisor = dyn_cast<ConstantInt>(rhs);
+            BinaryOperator *replacement;
+            if (divisor && divisor->getValue().isPowerOf2()) {
+                const APInt &value = divisor->getValue();
+                replacement = isDiv ? BinaryOperator::CreateLShr(lhs, ConstantInt::get(inst->getType(), value.logBase2()))
+                                    : BinaryOperator::CreateAnd(lhs, ConstantInt::get(inst->getType(), value - 1));
+            } else {
+                replacement = BinaryOperator::Create(isDiv ? Instruction::UDiv : Instruction::URem, lhs, rhs);
+            }
+            if (isDiv) {
+                replacement->setIsExact(cast<BinaryOperator>(inst)->isExact());
+                counts.numDiv++;
+            } else {
+                counts.numRem++;
+            }
+            return replacement;
+        }
+        case Instruction::SExt:
+            if (!isNonNegative(lhs)) {
+                return nullptr;
+            }
+            counts.numExt++;
+            return new ZExtInst(lhs, inst->getType());
+        case Instruction::ICmp: {
+            auto *icmpInst = cast<ICmpInst>(inst);
+            Value *rhs = icmpInst->getOperand(1);
+            if (!icmpInst->isSigned() || !isNonNegative(lhs) || !isNonNegative(rhs)) {
+                return nullptr;
+            }
+            counts.numCmp++;
+            return new ICmpInst(icmpInst->getUnsignedPredicate(), lhs, rhs);
+        }
+        default:
+            return nullptr;
+    }
+}
+
+bool SignStrengthReduction::runOnModule(Module &M) {
+    signs = &getAnalysis<InterSignAnalysis>();
+
+    bool changed = false;
+    for (Function &F : M) {
+        if (F.isDeclaration()) {
+            continue;
+        }
+        RewriteCounts counts;
+        std::vector<std::pair<Instruction *, Instruction *>> replacements;
+        for (BasicBlock &bb : F) {
+            for (Instruction &inst : bb) {
+                if (Instruction *replacement = getReplacement(&inst, counts)) {
+                    replacements.emplace_back(&inst, replacement);
+                }
+            }
+        }
+        for (auto &replacement : replacements) {
+            PASS_DEBUG(SignLog) << *replacement.first << " -> " << *replacement.second << "\n";
+            ReplaceInstWithInst(replacement.first, replacement.second);
+        }
+        changed |= !replacements.empty();
+        printRewriteResult(F, counts);
+    }
+    return changed;
+}
+
+void SignStrengthReduction::printRewriteResult(Function &F, const RewriteCounts &counts) {
+    errs() << "=================================================" << "\n";
+    errs() << "LLVM-TUTOR: Sign strength reduction results for `" << F.getName() << "`\n";
+    errs() << "=================================================" << "\n";
+    errs() << "sdiv: " << counts.numDiv << ", srem: " << counts.numRem << ", sext: " << counts.numExt
+           << ", icmp: " << counts.numCmp << "\n";
+    errs() << "-------------------------------------------------" << "\n\n";
+}
+
+static RegisterPass<SignStrengthReduction> X("sign-strength-reduce", "Sign-driven Strength Reduction Pass",
+                                             true, // This pass doesn't modify the CFG => true
+                                             false // This pass is a transformation => false
+);
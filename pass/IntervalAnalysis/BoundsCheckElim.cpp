@@ -0,0 +1,243 @@
+//========================================================================
+// FILE:
+//    BoundsCheckElim.cpp
+//
+// DESCRIPTION:
+//    Interval-driven bounds check elimination
+//    All the checks are classified on the unchanged function first, the
+//    analysis is not used once the CFG starts to change. A check is moved
+//    out of its loop only if it runs in the first iteration whenever the
+//    loop is entered, and nothing observable happens in the loop before
+//    it, so a trap that would happen anyway only happens earlier. A trap
+//    block left without any check is deleted.
+//
+// License: MIT
+//========================================================================
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/DomTreeUpdater.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+#include "pass/BoundsCheckElim.h"
+#include "util/Log.h"
+
+using namespace IntervalNameSpace;
+
+char BoundsCheckElim::ID = 0;
+
+//----------------------------------------------------------
+// Implementation of BoundsCheckElim
+//----------------------------------------------------------
+
+void BoundsCheckElim::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
+    AU.addRequired<DominatorTreeWrapperPass>();
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.addPreserved<DominatorTreeWrapperPass>();
+    AU.addPreserved<LoopInfoWrapperPass>();
+}
+
+/*
+ * A trap block ends the program: it calls a noreturn function and ends with unreachable
+ */
+static bool isTrapBlock(const BasicBlock *bb) {
+    if (!isa<UnreachableInst>(bb->getTerminator())) {
+        return false;
+    }
+    for (const Instruction &inst : *bb) {
+        if (auto *callInst = dyn_cast<CallInst>(&inst)) {
+            if (callInst->doesNotReturn()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void BoundsCheckElim::collectBoundsChecks(Function &F, std::vector<BoundsCheck> &checks) {
+    for (BasicBlock &bb : F) {
+        auto *branchInst = dyn_cast<BranchInst>(bb.getTerminator());
+        if (!branchInst || !branchInst->isConditional()) {
+            continue;
+        }
+        auto *icmpInst = dyn_cast<ICmpInst>(branchInst->getCondition());
+        if (!icmpInst) {
+            continue;
+        }
+
+        bool trap0 = isTrapBlock(branchInst->getSuccessor(0));
+        bool trap1 = isTrapBlock(branchInst->getSuccessor(1));
+        if (trap0 != trap1) {
+            checks.push_back({branchInst, icmpInst, trap0 ? 1u : 0u});
+        }
+    }
+}
+
+bool BoundsCheckElim::isAlwaysPassing(const BoundsCheck &check, const SparseIntervalSolver &solver) {
+    CmpInst::Predicate pred = check.passSucc == 0 ? check.cond->getPredicate()
+                                                  : check.cond->getInversePredicate();
+    return solver.provesRelation(pred, check.cond->getOperand(0), check.cond->getOperand(1),
+                                 check.branch->getParent());
+}
+
+Loop *BoundsCheckElim::getHoistTarget(const BoundsCheck &check, LoopInfo &LI, DominatorTree &DT) {
+    BasicBlock *bb = check.branch->getParent();
+    Loop *L = LI.getLoopFor(bb);
+    if (!L || !L->getLoopPreheader()) {
+        return nullptr;
+    }
+
+    //the compared values must be available before the loop
+    for (Value *operand : check.cond->operands()) {
+        if (!L->isLoopInvariant(operand)) {
+            return nullptr;
+        }
+    }
+
+    //the preheader becomes a predecessor of the trap block, so the trap block
+    //cannot merge values and can only read values available in the preheader
+    BasicBlock *trapBB = check.branch->getSuccessor(1 - check.passSucc);
+    Instruction *hoistPoint = L->getLoopPreheader()->getTerminator();
+    if (isa<PHINode>(trapBB->front())) {
+        return nullptr;
+    }
+    for (Instruction &inst : *trapBB) {
+        for (Value *operand : inst.operands()) {
+            auto *operandInst = dyn_cast<Instruction>(operand);
+            if (operandInst && operandInst->getParent() != trapBB && !DT.dominates(operandInst, hoistPoint)) {
+                return nullptr;
+            }
+        }
+    }
+
+    //the check runs in the first iteration: no exit and no back edge before it
+    SmallVector<BasicBlock *, 4> exitingBlocks, latches;
+    L->getExitingBlocks(exitingBlocks);
+    L->getLoopLatches(latches);
+    for (BasicBlock *block : exitingBlocks) {
+        if (!DT.dominates(bb, block)) return nullptr;
+    }
+    for (BasicBlock *block : latches) {
+        if (!DT.dominates(bb, block)) return nullptr;
+    }
+
+    //and nothing observable happens in the loop before it
+    for (BasicBlock *block : L->blocks()) {
+        if (block != bb && DT.dominates(bb, block)) {
+            continue;
+        }
+        for (Instruction &inst : *block) {
+            if (&inst == check.branch) break;
+            if (inst.mayHaveSideEffects()) return nullptr;
+        }
+    }
+    return L;
+}
+
+/*
+ * Replace the check by a branch to its passing successor
+ */
+void BoundsCheckElim::removeCheck(const BoundsCheck &check, DominatorTree &DT) {
+    BasicBlock *bb = check.branch->getParent();
+    BasicBlock *passBB = check.branch->getSuccessor(check.passSucc);
+    BasicBlock *trapBB = check.branch->getSuccessor(1 - check.passSucc);
+
+    trapBB->removePredecessor(bb);
+    BranchInst::Create(passBB, check.branch);
+    check.branch->eraseFromParent();
+    DT.deleteEdge(bb, trapBB);
+}
+
+/*
+ * The preheader is split, its first half evaluates the check and branches to the trap block
+ * or to the second half, which is the new preheader
+ */
+void BoundsCheckElim::hoistCheck(const BoundsCheck &check, Loop *L, LoopInfo &LI, DominatorTree &DT) {
+    BasicBlock *guardBB = L->getLoopPreheader();
+    BasicBlock *trapBB = check.branch->getSuccessor(1 - check.passSucc);
+    BasicBlock *preheader = SplitBlock(guardBB, guardBB->getTerminator(), &DT, &LI);
+
+    Instruction *guardTerm = guardBB->getTerminator();
+    if (L->contains(check.cond)) {
+        check.cond->moveBefore(guardTerm);
+    }
+    if (check.passSucc == 0) {
+        BranchInst::Create(preheader, trapBB, check.cond, guardTerm);
+    } else {
+        BranchInst::Create(trapBB, preheader, check.cond, guardTerm);
+    }
+    guardTerm->eraseFromParent();
+    DT.insertEdge(guardBB, trapBB);
+
+    removeCheck(check, DT);
+}
+
+bool BoundsCheckElim::runOnFunction(Function &F) {
+    DominatorTree &DT = getAnalysis<DominatorTreeWrapperPass>().getDomTree();
+    LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    numRemoved = numHoisted = numKept = 0;
+
+    std::vector<BoundsCheck> checks;
+    collectBoundsChecks(F, checks);
+    if (checks.empty()) {
+        return false;
+    }
+
+    std::vector<bool> alwaysPassing;
+    {
+        SparseIntervalSolver solver(F);
+        solver.solve();
+        for (const BoundsCheck &check : checks) {
+            alwaysPassing.push_back(isAlwaysPassing(check, solver));
+        }
+    }
+
+    SmallPtrSet<ICmpInst *, 8> conds;
+    SmallPtrSet<BasicBlock *, 8> trapBlocks;
+    for (unsigned i = 0; i < checks.size(); i++) {
+        const BoundsCheck &check = checks[i];
+        conds.insert(check.cond);
+        trapBlocks.insert(check.branch->getSuccessor(1 - check.passSucc));
+        if (alwaysPassing[i]) {
+            PASS_DEBUG(IntervalLog) << "remove " << *check.cond << "\n";
+            removeCheck(check, DT);
+            numRemoved++;
+        } else if (Loop *L = getHoistTarget(check, LI, DT)) {
+            PASS_DEBUG(IntervalLog) << "hoist " << *check.cond << "\n";
+            hoistCheck(check, L, LI, DT);
+            numHoisted++;
+        } else {
+            numKept++;
+        }
+    }
+
+    //several checks may share a trap block, it is dead once all of them are gone
+    DomTreeUpdater DTU(DT, DomTreeUpdater::UpdateStrategy::Eager);
+    for (BasicBlock *trapBB : trapBlocks) {
+        if (pred_empty(trapBB)) {
+            LI.removeBlock(trapBB);
+            DeleteDeadBlock(trapBB, &DTU);
+        }
+    }
+
+    for (ICmpInst *cond : conds) {
+        if (cond->use_empty()) {
+            cond->eraseFromParent();
+        }
+    }
+
+    printBoundsCheckResult(F);
+    return numRemoved + numHoisted > 0;
+}
+
+void BoundsCheckElim::printBoundsCheckResult(Function &F) {
+    errs() << "=================================================" << "\n";
+    errs() << "LLVM-TUTOR: Bounds check results for `" << F.getName() << "`\n";
+    errs() << "=================================================" << "\n";
+    errs() << "removed: " << numRemoved << ", hoisted: " << numHoisted << ", kept: " << numKept << "\n";
+    errs() << "-------------------------------------------------" << "\n\n";
+}
+
+static RegisterPass<BoundsCheckElim> X("bounds-check-elim", "Interval Bounds Check Elimination Pass",
+                                       false, // This pass modifies the CFG => false
+                                       false  // This pass is a transformation => false
+);
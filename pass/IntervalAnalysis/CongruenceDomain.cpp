@@ -0,0 +1,249 @@
+//========================================================================
+// FILE:
+//    CongruenceDomain.cpp
+//
+// DESCRIPTION:
+//    Congruence abstract domain and strided intervals
+//    The operations compute the exact moduli on 128-bit integers, the
+//    wrap-around of the bits-wide values is applied by the caller with
+//    Congruence::truncate when the operation may overflow.
+//
+// License: MIT
+//========================================================================
+
+#include "pass/CongruenceDomain.h"
+
+using namespace IntervalNameSpace;
+
+typedef __int128 WideInt;
+
+const uint64_t Congruence::MaxModulus;
+
+static WideInt absWide(WideInt v) {
+    return v < 0 ? -v : v;
+}
+
+static WideInt gcdWide(WideInt a, WideInt b) {
+    a = absWide(a);
+    b = absWide(b);
+    while (b != 0) {
+        WideInt t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Largest power of two dividing v > 0
+static WideInt lowestBit(WideInt v) {
+    return v & -v;
+}
+
+// Residue of v modulo m > 0, in [0, m)
+static WideInt modWide(WideInt v, WideInt m) {
+    WideInt r = v % m;
+    return r < 0 ? r + m : r;
+}
+
+/*
+ * Congruence from an exact modulus and residue: a constant is wrapped to 64 bits, a modulus
+ * too large for 64 bits is cut down to its power of two part
+ */
+static Congruence makeCongruence(WideInt m, WideInt r) {
+    m = absWide(m);
+    if (m == 0) {
+        return Congruence::constant(int64_t(uint64_t(r)));
+    }
+    if (m > WideInt(Congruence::MaxModulus)) {
+        m = lowestBit(m);
+        if (m > WideInt(Congruence::MaxModulus)) {
+            m = Congruence::MaxModulus;
+        }
+    }
+    return Congruence(uint64_t(m), int64_t(modWide(r, m)));
+}
+
+//----------------------------------------------------------
+// Implementation of Congruence
+//----------------------------------------------------------
+
+Congruence::Congruence(uint64_t m, int64_t r) : modulus(m), residue(r) {
+    if (m > 0) {
+        residue = int64_t(modWide(r, m));
+    }
+}
+
+Congruence Congruence::bottom() {
+    Congruence c;
+    c.bot = true;
+    return c;
+}
+
+bool Congruence::contains(int64_t v) const {
+    if (bot) {
+        return false;
+    }
+    if (modulus == 0) {
+        return v == residue;
+    }
+    return modWide(WideInt(v) - residue, modulus) == 0;
+}
+
+bool Congruence::operator==(const Congruence &rhs) const {
+    if (bot || rhs.bot) {
+        return bot == rhs.bot;
+    }
+    return modulus == rhs.modulus && residue == rhs.residue;
+}
+
+uint64_t Congruence::getAlignment() const {
+    if (bot) {
+        return MaxModulus;
+    }
+    WideInt g = gcdWide(modulus, residue);
+    if (g == 0 || lowestBit(g) > WideInt(MaxModulus)) {
+        return MaxModulus;
+    }
+    return uint64_t(lowestBit(g));
+}
+
+/*
+ * A bits-wide value is only known modulo 2^bits, so the congruence keeps the largest
+ * power of two dividing both its modulus and 2^bits
+ */
+Congruence Congruence::truncate(unsigned bits) const {
+    if (bot || modulus == 1) {
+        return *this;
+    }
+    WideInt wrap = WideInt(1) << bits;
+    if (modulus == 0) {
+        WideInt v = modWide(residue, wrap);
+        if (v >= wrap / 2) {
+            v -= wrap;
+        }
+        return constant(int64_t(v));
+    }
+    WideInt m = lowestBit(WideInt(modulus));
+    return makeCongruence(m < wrap ? m : wrap, residue);
+}
+
+string Congruence::toStr() const {
+    if (bot) {
+        return "bot";
+    }
+    if (modulus == 0) {
+        return std::to_string(residue);
+    }
+    return std::to_string(residue) + " mod " + std::to_string(modulus);
+}
+
+Congruence IntervalNameSpace::joinCongruence(const Congruence &a, const Congruence &b) {
+    if (a.isBot()) return b;
+    if (b.isBot()) return a;
+    WideInt m = gcdWide(gcdWide(a.modulus, b.modulus), WideInt(a.residue) - b.residue);
+    return makeCongruence(m, a.residue);
+}
+
+Congruence IntervalNameSpace::addCongruence(const Congruence &a, const Congruence &b) {
+    if (a.isBot() || b.isBot()) return Congruence::bottom();
+    return makeCongruence(gcdWide(a.modulus, b.modulus), WideInt(a.residue) + b.residue);
+}
+
+Congruence IntervalNameSpace::subCongruence(const Congruence &a, const Congruence &b) {
+    if (a.isBot() || b.isBot()) return Congruence::bottom();
+    return makeCongruence(gcdWide(a.modulus, b.modulus), WideInt(a.residue) - b.residue);
+}
+
+/*
+ * (ra + i * ma) * (rb + j * mb) = ra * rb + i * ma * rb + j * mb * ra + i * j * ma * mb
+ */
+Congruence IntervalNameSpace::mulCongruence(const Congruence &a, const Congruence &b) {
+    if (a.isBot() || b.isBot()) return Congruence::bottom();
+    WideInt ma = a.modulus, mb = b.modulus;
+    WideInt m = gcdWide(gcdWide(ma * mb, ma * b.residue), mb * a.residue);
+    WideInt r = WideInt(a.residue) * b.residue;
+    return makeCongruence(m, m == 0 ? r : modWide(r, m));
+}
+
+/*
+ * The low bits that are zero in either operand are zero in the result
+ */
+Congruence IntervalNameSpace::andCongruence(const Congruence &a, const Congruence &b) {
+    if (a.isBot() || b.isBot()) return Congruence::bottom();
+    if (a.isConstant() && b.isConstant()) {
+        return Congruence::constant(a.residue & b.residue);
+    }
+    if ((a.isConstant() && a.residue == 0) || (b.isConstant() && b.residue == 0)) {
+        return Congruence::constant(0);
+    }
+    return Congruence(std::max(a.getAlignment(), b.getAlignment()), 0);
+}
+
+/*
+ * The low bits are zero in the result if they are zero in both operands; setting bits
+ * below the alignment of the other operand, as for a tagged pointer, gives them exactly
+ */
+Congruence IntervalNameSpace::orCongruence(const Congruence &a, const Congruence &b) {
+    if (a.isBot() || b.isBot()) return Congruence::bottom();
+    if (a.isConstant() && b.isConstant()) {
+        return Congruence::constant(a.residue | b.residue);
+    }
+    uint64_t alignA = a.getAlignment(), alignB = b.getAlignment();
+    if (b.isConstant() && b.residue >= 0 && uint64_t(b.residue) < alignA) {
+        return Congruence(alignA, b.residue);
+    }
+    if (a.isConstant() && a.residue >= 0 && uint64_t(a.residue) < alignB) {
+        return Congruence(alignB, a.residue);
+    }
+    return Congruence(std::min(alignA, alignB), 0);
+}
+
+//----------------------------------------------------------
+// Implementation of StridedInterval
+//----------------------------------------------------------
+
+StridedInterval::StridedInterval(Interval range, Congruence cong) : range(range), cong(cong) {
+    reduce();
+}
+
+void StridedInterval::reduce() {
+    if (range.isBot() || cong.isBot()) {
+        range = botInt;
+        cong = Congruence::bottom();
+        return;
+    }
+    if (cong.isConstant()) {
+        if (cong.residue < range.lo || cong.residue > range.hi) {
+            range = botInt;
+            cong = Congruence::bottom();
+        } else {
+            range = Interval(cong.residue, cong.residue);
+        }
+        return;
+    }
+    if (cong.modulus > 1) {
+        WideInt m = cong.modulus;
+        WideInt lo = WideInt(range.lo) + modWide(WideInt(cong.residue) - range.lo, m);
+        WideInt hi = WideInt(range.hi) - modWide(WideInt(range.hi) - cong.residue, m);
+        if (lo > hi) {
+            range = botInt;
+            cong = Congruence::bottom();
+            return;
+        }
+        range = Interval(int64_t(lo), int64_t(hi));
+    }
+    if (range.lo == range.hi) {
+        cong = Congruence::constant(range.lo);
+    }
+}
+
+string StridedInterval::toStr(unsigned bits) const {
+    if (isBot() || cong.modulus <= 1) {
+        return range.toStr(bits);
+    }
+    //a bound moved to a value of the congruence near the limit of the type is still infinite
+    Interval typeRange = Interval::top(bits), shown = range;
+    if (WideInt(shown.lo) - typeRange.lo < WideInt(cong.modulus)) shown.lo = typeRange.lo;
+    if (WideInt(typeRange.hi) - shown.hi < WideInt(cong.modulus)) shown.hi = typeRange.hi;
+    return shown.toStr(bits) + " step " + std::to_string(cong.modulus);
+}
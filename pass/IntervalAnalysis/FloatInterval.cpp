@@ -0,0 +1,311 @@
+//========================================================================
+// FILE:
+//    FloatInterval.cpp
+//
+// DESCRIPTION:
+//    Floating-point interval domain
+//    A corner of an operation that is NaN (inf - inf, 0 * inf, inf / inf)
+//    only adds NaN, the numbers come from the other corners.
+//
+// License: MIT
+//========================================================================
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "pass/FloatInterval.h"
+
+using namespace IntervalNameSpace;
+
+static const double Inf = std::numeric_limits<double>::infinity();
+
+// Round a double to the precision of the type. For +, -, *, / and sqrt of two floats, rounding the
+// double result again to float gives the float result, as 53 >= 2 * 24 + 2 bits
+static double roundTo(double v, bool single) {
+    return single ? double(float(v)) : v;
+}
+
+static double maxFinite(bool single) {
+    return single ? double(FLT_MAX) : DBL_MAX;
+}
+
+// One ulp of the type further from the bound, for the results that may be off by an ulp
+static double nextDown(double v, bool single) {
+    return single ? double(std::nextafter(float(v), -HUGE_VALF)) : std::nextafter(v, -Inf);
+}
+
+static double nextUp(double v, bool single) {
+    return single ? double(std::nextafter(float(v), HUGE_VALF)) : std::nextafter(v, Inf);
+}
+
+static FloatInterval nanOnly() {
+    FloatInterval result;
+    result.mayBeNaN = true;
+    return result;
+}
+
+//----------------------------------------------------------
+// Implementation of FloatInterval
+//----------------------------------------------------------
+
+FloatInterval FloatInterval::top() {
+    return FloatInterval(-Inf, Inf, true);
+}
+
+FloatInterval FloatInterval::constant(double c) {
+    return std::isnan(c) ? nanOnly() : FloatInterval(c, c);
+}
+
+bool FloatInterval::mayBeInf() const {
+    return hasNumbers() && (lo == -Inf || hi == Inf);
+}
+
+bool FloatInterval::operator==(const FloatInterval &rhs) const {
+    if (!hasNumbers() || !rhs.hasNumbers()) {
+        return hasNumbers() == rhs.hasNumbers() && mayBeNaN == rhs.mayBeNaN;
+    }
+    return lo == rhs.lo && hi == rhs.hi && mayBeNaN == rhs.mayBeNaN;
+}
+
+string FloatInterval::toStr() const {
+    if (isBot()) {
+        return "bot";
+    }
+    if (!hasNumbers()) {
+        return "nan";
+    }
+    auto bound = [](double v) {
+        if (std::isinf(v)) return std::string(v < 0 ? "-inf" : "inf");
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%g", v);
+        return std::string(buf);
+    };
+    return "[" + bound(lo) + "," + bound(hi) + "]" + (mayBeNaN ? " or nan" : "");
+}
+
+//----------------------------------------------------------
+// Lattice operations
+//----------------------------------------------------------
+
+FloatInterval IntervalNameSpace::joinFloat(const FloatInterval &a, const FloatInterval &b) {
+    FloatInterval result(std::min(a.lo, b.lo), std::max(a.hi, b.hi), a.mayBeNaN || b.mayBeNaN);
+    if (!a.hasNumbers()) {
+        result.lo = b.lo;
+        result.hi = b.hi;
+    } else if (!b.hasNumbers()) {
+        result.lo = a.lo;
+        result.hi = a.hi;
+    }
+    return result;
+}
+
+FloatInterval IntervalNameSpace::widenFloat(const FloatInterval &oldV, const FloatInterval &newV, bool single) {
+    if (!oldV.hasNumbers()) {
+        return newV;
+    }
+    double max = maxFinite(single);
+    const double thresholds[] = {-max, -1, 0, 1, max};
+    FloatInterval result = newV;
+    if (newV.lo < oldV.lo) {
+        auto below = std::upper_bound(std::begin(thresholds), std::end(thresholds), newV.lo);
+        result.lo = below == std::begin(thresholds) ? -Inf : *(below - 1);
+    }
+    if (newV.hi > oldV.hi) {
+        auto above = std::lower_bound(std::begin(thresholds), std::end(thresholds), newV.hi);
+        result.hi = above == std::end(thresholds) ? Inf : *above;
+    }
+    return result;
+}
+
+//----------------------------------------------------------
+// Arithmetic
+//----------------------------------------------------------
+
+FloatInterval IntervalNameSpace::addFloat(const FloatInterval &a, const FloatInterval &b, bool single) {
+    if (!a.hasNumbers() || !b.hasNumbers()) {
+        return (a.isBot() || b.isBot()) ? FloatInterval() : nanOnly();
+    }
+    bool nan = a.mayBeNaN || b.mayBeNaN || (a.contains(Inf) && b.contains(-Inf)) ||
+               (a.contains(-Inf) && b.contains(Inf));
+    double lo = roundTo(a.lo + b.lo, single), hi = roundTo(a.hi + b.hi, single);
+    return FloatInterval(std::isnan(lo) ? -Inf : lo, std::isnan(hi) ? Inf : hi, nan);
+}
+
+FloatInterval IntervalNameSpace::subFloat(const FloatInterval &a, const FloatInterval &b, bool single) {
+    return addFloat(a, negFloat(b), single);
+}
+
+/*
+ * Hull of the products (or quotients) of the bounds, leaving out the NaN ones
+ */
+static FloatInterval cornerHull(const FloatInterval &a, const FloatInterval &b, bool single, bool divide) {
+    FloatInterval result;
+    result.mayBeNaN = a.mayBeNaN || b.mayBeNaN;
+    for (double x : {a.lo, a.hi}) {
+        for (double y : {b.lo, b.hi}) {
+            double v = roundTo(divide ? x / y : x * y, single);
+            if (std::isnan(v)) {
+                result.mayBeNaN = true;
+                continue;
+            }
+            result.lo = std::min(result.lo, v);
+            result.hi = std::max(result.hi, v);
+        }
+    }
+    return result;
+}
+
+FloatInterval IntervalNameSpace::mulFloat(const FloatInterval &a, const FloatInterval &b, bool single) {
+    if (!a.hasNumbers() || !b.hasNumbers()) {
+        return (a.isBot() || b.isBot()) ? FloatInterval() : nanOnly();
+    }
+    FloatInterval result = cornerHull(a, b, single, false);
+    result.mayBeNaN |= (a.contains(0) && (b.contains(Inf) || b.contains(-Inf))) ||
+                       (b.contains(0) && (a.contains(Inf) || a.contains(-Inf)));
+    return result;
+}
+
+/*
+ * A divisor that may be zero gives any sign of infinity
+ */
+FloatInterval IntervalNameSpace::divFloat(const FloatInterval &a, const FloatInterval &b, bool single) {
+    if (!a.hasNumbers() || !b.hasNumbers()) {
+        return (a.isBot() || b.isBot()) ? FloatInterval() : nanOnly();
+    }
+    bool infinities = (a.contains(Inf) || a.contains(-Inf)) && (b.contains(Inf) || b.contains(-Inf));
+    if (b.contains(0)) {
+        return FloatInterval(-Inf, Inf, a.mayBeNaN || b.mayBeNaN || a.contains(0) || infinities);
+    }
+    FloatInterval result = cornerHull(a, b, single, true);
+    result.mayBeNaN |= infinities;
+    return result;
+}
+
+/*
+ * The remainder has the sign of a, and is smaller than both |a| and |b|
+ */
+FloatInterval IntervalNameSpace::remFloat(const FloatInterval &a, const FloatInterval &b) {
+    if (!a.hasNumbers() || !b.hasNumbers()) {
+        return (a.isBot() || b.isBot()) ? FloatInterval() : nanOnly();
+    }
+    bool nan = a.mayBeNaN || b.mayBeNaN || a.mayBeInf() || b.contains(0);
+    double bound = std::min(std::max(std::fabs(a.lo), std::fabs(a.hi)), std::max(std::fabs(b.lo), std::fabs(b.hi)));
+    return FloatInterval(a.lo < 0 ? -bound : 0, a.hi > 0 ? bound : 0, nan);
+}
+
+FloatInterval IntervalNameSpace::negFloat(const FloatInterval &a) {
+    FloatInterval result = a;
+    if (a.hasNumbers()) {
+        result.lo = -a.hi;
+        result.hi = -a.lo;
+    }
+    return result;
+}
+
+//----------------------------------------------------------
+// Conversions
+//----------------------------------------------------------
+
+FloatInterval IntervalNameSpace::convertFloat(const FloatInterval &a, bool single) {
+    FloatInterval result = a;
+    if (a.hasNumbers()) {
+        result.lo = roundTo(a.lo, single);
+        result.hi = roundTo(a.hi, single);
+    }
+    return result;
+}
+
+FloatInterval IntervalNameSpace::intToFloat(Interval a, bool isSigned, unsigned bits, bool single) {
+    if (a.isBot()) {
+        return FloatInterval();
+    }
+    if (!isSigned && a.lo < 0) {
+        //as unsigned, anything up to 2^bits - 1
+        double max = bits >= 64 ? double(UINT64_MAX) : double((uint64_t(1) << bits) - 1);
+        return FloatInterval(0, roundTo(max, single));
+    }
+    return FloatInterval(roundTo(double(a.lo), single), roundTo(double(a.hi), single));
+}
+
+//----------------------------------------------------------
+// libm functions
+//----------------------------------------------------------
+
+FloatInterval IntervalNameSpace::sqrtFloat(const FloatInterval &a, bool single) {
+    if (!a.hasNumbers() || a.hi < 0) {
+        return a.isBot() ? a : nanOnly();
+    }
+    //sqrt is correctly rounded, and sqrt(-0) = -0
+    double lo = a.lo < 0 ? 0 : a.lo;
+    return FloatInterval(roundTo(std::sqrt(lo), single), roundTo(std::sqrt(a.hi), single), a.mayBeNaN || a.lo < 0);
+}
+
+FloatInterval IntervalNameSpace::fabsFloat(const FloatInterval &a) {
+    FloatInterval result = a;
+    if (!a.hasNumbers() || a.lo >= 0) {
+        return result;
+    }
+    if (a.hi <= 0) {
+        return negFloat(a);
+    }
+    result.lo = 0;
+    result.hi = std::max(-a.lo, a.hi);
+    return result;
+}
+
+FloatInterval IntervalNameSpace::expFloat(const FloatInterval &a, bool single) {
+    FloatInterval result = a;
+    if (a.hasNumbers()) {
+        result.lo = std::max(0.0, nextDown(roundTo(std::exp(a.lo), single), single));
+        result.hi = nextUp(roundTo(std::exp(a.hi), single), single);
+    }
+    return result;
+}
+
+FloatInterval IntervalNameSpace::logFloat(const FloatInterval &a, bool single) {
+    if (!a.hasNumbers() || a.hi < 0) {
+        return a.isBot() ? a : nanOnly();
+    }
+    double lo = a.lo < 0 ? 0 : a.lo;
+    return FloatInterval(nextDown(roundTo(std::log(lo), single), single),
+                         nextUp(roundTo(std::log(a.hi), single), single), a.mayBeNaN || a.lo < 0);
+}
+
+FloatInterval IntervalNameSpace::sinCosFloat(const FloatInterval &a) {
+    if (!a.hasNumbers()) {
+        return a;
+    }
+    bool onlyInf = (a.lo == -Inf && a.hi == -Inf) || (a.lo == Inf && a.hi == Inf);
+    if (onlyInf) {
+        return nanOnly();
+    }
+    return FloatInterval(-1, 1, a.mayBeNaN || a.mayBeInf());
+}
+
+FloatInterval IntervalNameSpace::roundFloat(const FloatInterval &a, double (*fn)(double)) {
+    FloatInterval result = a;
+    if (a.hasNumbers()) {
+        result.lo = fn(a.lo);
+        result.hi = fn(a.hi);
+    }
+    return result;
+}
+
+/*
+ * minnum and maxnum return the other operand when one is NaN
+ */
+FloatInterval IntervalNameSpace::minNumFloat(const FloatInterval &a, const FloatInterval &b) {
+    FloatInterval result(std::min(a.lo, b.lo), std::min(a.hi, b.hi), a.mayBeNaN && b.mayBeNaN);
+    if (!a.hasNumbers() || !b.hasNumbers()) {
+        result = a.hasNumbers() ? a : b;
+        result.mayBeNaN = a.mayBeNaN && b.mayBeNaN;
+        return result;
+    }
+    if (a.mayBeNaN) result = joinFloat(result, FloatInterval(b.lo, b.hi));
+    if (b.mayBeNaN) result = joinFloat(result, FloatInterval(a.lo, a.hi));
+    return result;
+}
+
+FloatInterval IntervalNameSpace::maxNumFloat(const FloatInterval &a, const FloatInterval &b) {
+    return negFloat(minNumFloat(negFloat(a), negFloat(b)));
+}
@@ -0,0 +1,320 @@
+//========================================================================
+// FILE:
+//    FloatRangeAnalysis.cpp
+//
+// DESCRIPTION:
+//    Floating-point interval analysis on SSA form and the nnan/ninf flags
+//    The widening of a loop phi moves a growing bound through a few
+//    thresholds, up to the largest finite value before the infinity, so
+//    a sum that only saturates at the largest value stays finite.
+//    The flags only change on the instructions, so all the analyses are
+//    preserved.
+//
+// License: MIT
+//========================================================================
+
+#include <cmath>
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Support/CommandLine.h"
+#include "pass/FloatRangeAnalysis.h"
+#include "util/Log.h"
+
+using namespace IntervalNameSpace;
+
+static cl::opt<bool> FlagsMode("float-range-flags", cl::init(false),
+                               cl::desc("Set nnan and ninf on the floating-point operations proven safe"));
+
+static bool isTrackedType(const Type *type) {
+    return type->isFloatTy() || type->isDoubleTy();
+}
+
+static bool isSingle(const Value *v) {
+    return v->getType()->isFloatTy();
+}
+
+//----------------------------------------------------------
+// Implementation of FloatRangeSolver
+//----------------------------------------------------------
+
+FloatRangeSolver::FloatRangeSolver(Function &F, const SparseIntervalSolver &intRanges)
+        : func(F), intRanges(intRanges) {
+    ReversePostOrderTraversal<Function *> RPOT(&F);
+    DenseMap<const BasicBlock *, unsigned> rpoIndex;
+    for (BasicBlock *bb : RPOT) {
+        rpoIndex[bb] = rpoIndex.size();
+        for (Instruction &inst : *bb) {
+            if (isTrackedType(inst.getType())) {
+                insts.push_back(&inst);
+            }
+        }
+    }
+    //an incoming block not before the phi in reverse post order is a back edge
+    for (Instruction *inst : insts) {
+        auto *phi = dyn_cast<PHINode>(inst);
+        if (!phi) {
+            continue;
+        }
+        for (BasicBlock *incoming : phi->blocks()) {
+            auto index = rpoIndex.find(incoming);
+            if (index != rpoIndex.end() && index->second >= rpoIndex[phi->getParent()]) {
+                wideningPoints.insert(phi);
+                break;
+            }
+        }
+    }
+}
+
+/*
+ * Round robin in reverse post order, until no range changes
+ */
+void FloatRangeSolver::solve() {
+    ranges.clear();
+    iterNum = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (Instruction *inst : insts) {
+            iterNum++;
+            FloatInterval range = evaluate(inst);
+
+            auto old = ranges.find(inst);
+            if (old == ranges.end()) {
+                if (!range.isBot()) {
+                    ranges[inst] = range;
+                    changed = true;
+                }
+                continue;
+            }
+            range = joinFloat(old->second, range);
+            if (range == old->second) {
+                continue;
+            }
+            auto *phi = dyn_cast<PHINode>(inst);
+            if (phi && wideningPoints.count(phi)) {
+                range = widenFloat(old->second, range, isSingle(inst));
+            }
+            old->second = range;
+            changed = true;
+        }
+    }
+    PASS_DEBUG(IntervalLog) << func.getName() << ": " << iterNum << " float range transfers\n";
+}
+
+FloatInterval FloatRangeSolver::getRange(const Value *v) const {
+    if (!isTrackedType(v->getType())) {
+        return FloatInterval::top();
+    }
+    if (auto *c = dyn_cast<ConstantFP>(v)) {
+        const APFloat &value = c->getValueAPF();
+        return FloatInterval::constant(isSingle(c) ? double(value.convertToFloat()) : value.convertToDouble());
+    }
+    if (isa<Instruction>(v)) {
+        auto range = ranges.find(v);
+        return range == ranges.end() ? FloatInterval() : range->second;
+    }
+    //arguments, loads from globals, undef
+    return FloatInterval::top();
+}
+
+FloatInterval FloatRangeSolver::evaluate(const Instruction *inst) const {
+    bool single = isSingle(inst);
+
+    if (auto *phi = dyn_cast<PHINode>(inst)) {
+        FloatInterval result;
+        for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+            if (intRanges.isFeasible(phi->getIncomingBlock(i))) {
+                result = joinFloat(result, getRange(phi->getIncomingValue(i)));
+            }
+        }
+        return result;
+    }
+    if (auto *selectInst = dyn_cast<SelectInst>(inst)) {
+        return joinFloat(getRange(selectInst->getTrueValue()), getRange(selectInst->getFalseValue()));
+    }
+    if (auto *callInst = dyn_cast<CallInst>(inst)) {
+        return evaluateCall(callInst);
+    }
+    if (inst->getOpcode() == Instruction::FNeg) {
+        return negFloat(getRange(inst->getOperand(0)));
+    }
+
+    if (auto *binaryInst = dyn_cast<BinaryOperator>(inst)) {
+        FloatInterval a = getRange(binaryInst->getOperand(0));
+        FloatInterval b = getRange(binaryInst->getOperand(1));
+        switch (binaryInst->getOpcode()) {
+            case Instruction::FAdd: return addFloat(a, b, single);
+            case Instruction::FSub: return subFloat(a, b, single);
+            case Instruction::FMul: return mulFloat(a, b, single);
+            case Instruction::FDiv: return divFloat(a, b, single);
+            case Instruction::FRem: return remFloat(a, b);
+            default: return FloatInterval::top();
+        }
+    }
+
+    if (auto *castInst = dyn_cast<CastInst>(inst)) {
+        const Value *src = castInst->getOperand(0);
+        switch (castInst->getOpcode()) {
+            case Instruction::SIToFP:
+            case Instruction::UIToFP:
+                if (!src->getType()->isIntegerTy() || src->getType()->getIntegerBitWidth() > 64) {
+                    return FloatInterval::top();
+                }
+                return intToFloat(intRanges.getRange(src), castInst->getOpcode() == Instruction::SIToFP,
+                                  src->getType()->getIntegerBitWidth(), single);
+            case Instruction::FPTrunc:
+            case Instruction::FPExt:
+                return convertFloat(getRange(src), single);
+            default:
+                return FloatInterval::top();
+        }
+    }
+    return FloatInterval::top();
+}
+
+/*
+ * The math intrinsics, and the libm functions of the same name (the float ones with an f suffix)
+ */
+FloatInterval FloatRangeSolver::evaluateCall(const CallInst *callInst) const {
+    const Function *callee = callInst->getCalledFunction();
+    if (!callee || !callee->isDeclaration() || callInst->arg_size() == 0) {
+        return FloatInterval::top();
+    }
+    bool single = isSingle(callInst);
+    FloatInterval a = getRange(callInst->getArgOperand(0));
+    FloatInterval b = callInst->arg_size() > 1 ? getRange(callInst->getArgOperand(1)) : FloatInterval::top();
+
+    switch (callee->getIntrinsicID()) {
+        case Intrinsic::sqrt: return sqrtFloat(a, single);
+        case Intrinsic::fabs: return fabsFloat(a);
+        case Intrinsic::exp: return expFloat(a, single);
+        case Intrinsic::log: return logFloat(a, single);
+        case Intrinsic::sin:
+        case Intrinsic::cos: return sinCosFloat(a);
+        case Intrinsic::floor: return roundFloat(a, ::floor);
+        case Intrinsic::ceil: return roundFloat(a, ::ceil);
+        case Intrinsic::trunc: return roundFloat(a, ::trunc);
+        case Intrinsic::round: return roundFloat(a, ::round);
+        case Intrinsic::rint:
+        case Intrinsic::nearbyint: return roundFloat(a, ::nearbyint);
+        case Intrinsic::minnum: return minNumFloat(a, b);
+        case Intrinsic::maxnum: return maxNumFloat(a, b);
+        case Intrinsic::not_intrinsic: break;
+        default: return FloatInterval::top();
+    }
+
+    StringRef name = callee->getName();
+    if (single) {
+        if (!name.endswith("f")) {
+            return FloatInterval::top();
+        }
+        name = name.drop_back();
+    }
+    if (name == "sqrt") return sqrtFloat(a, single);
+    if (name == "fabs") return fabsFloat(a);
+    if (name == "exp") return expFloat(a, single);
+    if (name == "log") return logFloat(a, single);
+    if (name == "sin" || name == "cos") return sinCosFloat(a);
+    if (name == "floor") return roundFloat(a, ::floor);
+    if (name == "ceil") return roundFloat(a, ::ceil);
+    if (name == "trunc") return roundFloat(a, ::trunc);
+    if (name == "round") return roundFloat(a, ::round);
+    if (name == "fmin") return minNumFloat(a, b);
+    if (name == "fmax") return maxNumFloat(a, b);
+    return FloatInterval::top();
+}
+
+void FloatRangeSolver::dump() const {
+    for (Instruction *inst : insts) {
+        if (inst->hasName()) {
+            errs() << "  " << inst->getName() << ": " << getRange(inst).toStr() << "\n";
+        }
+    }
+}
+
+//----------------------------------------------------------
+// Implementation of FloatRangeAnalysis
+//----------------------------------------------------------
+
+char FloatRangeAnalysis::ID = 0;
+
+void FloatRangeAnalysis::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+}
+
+/*
+ * nnan and ninf speak about the operands and the result, so all of them must be proven
+ */
+bool FloatRangeAnalysis::attachFlags(Instruction *inst, const FloatRangeSolver &solver) {
+    bool noNaN = true, noInf = true;
+    auto check = [&](const Value *v) {
+        if (!isTrackedType(v->getType())) {
+            noNaN = noInf = false;
+            return;
+        }
+        FloatInterval range = solver.getRange(v);
+        noNaN &= !range.mayBeNaN;
+        noInf &= !range.mayBeInf();
+    };
+    if (!isa<FCmpInst>(inst)) {
+        check(inst);
+    }
+    unsigned numOperands = isa<CallInst>(inst) ? cast<CallInst>(inst)->arg_size() : inst->getNumOperands();
+    for (unsigned i = 0; i < numOperands; i++) {
+        const Value *operand = inst->getOperand(i);
+        if (operand->getType()->isFPOrFPVectorTy()) {
+            check(operand);
+        }
+    }
+
+    numNoNaN += noNaN;
+    numNoInf += noInf;
+    bool changed = (noNaN && !inst->hasNoNaNs()) || (noInf && !inst->hasNoInfs());
+    if (!FlagsMode || !changed) {
+        return false;
+    }
+    PASS_DEBUG(IntervalLog) << *inst << ":" << (noNaN ? " nnan" : "") << (noInf ? " ninf" : "") << "\n";
+    if (noNaN) inst->setHasNoNaNs(true);
+    if (noInf) inst->setHasNoInfs(true);
+    return true;
+}
+
+bool FloatRangeAnalysis::runOnFunction(Function &F) {
+    numOperations = numNoNaN = numNoInf = 0;
+
+    SparseIntervalSolver intRanges(F);
+    intRanges.solve();
+    FloatRangeSolver solver(F, intRanges);
+    solver.solve();
+
+    bool changed = false;
+    for (BasicBlock &bb : F) {
+        for (Instruction &inst : bb) {
+            //arithmetic, comparisons and math calls; phis and selects only pass values on
+            if (!isa<FPMathOperator>(inst) || isa<PHINode>(inst) || isa<SelectInst>(inst)) {
+                continue;
+            }
+            numOperations++;
+            changed |= attachFlags(&inst, solver);
+        }
+    }
+
+    printFloatRangeResult(F, solver);
+    return changed;
+}
+
+void FloatRangeAnalysis::printFloatRangeResult(Function &F, const FloatRangeSolver &solver) {
+    errs() << "=================================================" << "\n";
+    errs() << "LLVM-TUTOR: Float range results for `" << F.getName() << "`\n";
+    errs() << "=================================================" << "\n";
+    solver.dump();
+    errs() << "nnan: " << numNoNaN << ", ninf: " << numNoInf << " of " << numOperations
+           << " floating-point operations" << "\n";
+    errs() << "-------------------------------------------------" << "\n\n";
+}
+
+static RegisterPass<FloatRangeAnalysis> X("float-range", "Floating-point Range Analysis Pass",
+                                          true, // This pass doesn't modify the CFG => true
+                                          false // This pass is a transformation => false
+);
@@ -0,0 +1,86 @@
+//========================================================================
+// FILE:
+//    IntervalAlignment.cpp
+//
+// DESCRIPTION:
+//    Alignment of the loads and stores from the strided intervals
+//    Only the align of the instructions changes, so all the analyses
+//    are preserved.
+//
+// License: MIT
+//========================================================================
+
+#include "pass/IntervalAlignment.h"
+#include "util/Log.h"
+
+using namespace IntervalNameSpace;
+
+char IntervalAlignment::ID = 0;
+
+const uint64_t IntervalAlignment::MaxAlignment;
+
+//----------------------------------------------------------
+// Implementation of IntervalAlignment
+//----------------------------------------------------------
+
+void IntervalAlignment::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+}
+
+bool IntervalAlignment::raiseAlignment(Instruction *inst, const StridedIntervalSolver &solver) {
+    Value *ptr = getLoadStorePointerOperand(inst);
+    uint64_t align = std::min(solver.getAlignment(ptr), MaxAlignment);
+    uint64_t current = isa<LoadInst>(inst) ? cast<LoadInst>(inst)->getAlignment()
+                                           : cast<StoreInst>(inst)->getAlignment();
+    if (align <= current) {
+        return false;
+    }
+
+    PASS_DEBUG(IntervalLog) << *inst << ": align " << current << " -> " << align << "\n";
+    if (auto *loadInst = dyn_cast<LoadInst>(inst)) {
+        loadInst->setAlignment(Align(align));
+    } else {
+        cast<StoreInst>(inst)->setAlignment(Align(align));
+    }
+    return true;
+}
+
+bool IntervalAlignment::runOnFunction(Function &F) {
+    numAccesses = numRaised = 0;
+
+    SparseIntervalSolver ranges(F);
+    ranges.solve();
+    StridedIntervalSolver solver(F, ranges);
+    solver.solve();
+    if (PASS_LOG_ENABLED(PASS_LOG_LEVEL_DEBUG, IntervalLog)) {
+        solver.dump();
+    }
+
+    for (BasicBlock &bb : F) {
+        for (Instruction &inst : bb) {
+            if (!isa<LoadInst>(inst) && !isa<StoreInst>(inst)) {
+                continue;
+            }
+            numAccesses++;
+            if (raiseAlignment(&inst, solver)) {
+                numRaised++;
+            }
+        }
+    }
+
+    printAlignmentResult(F);
+    return numRaised > 0;
+}
+
+void IntervalAlignment::printAlignmentResult(Function &F) {
+    errs() << "=================================================" << "\n";
+    errs() << "LLVM-TUTOR: Alignment results for `" << F.getName() << "`\n";
+    errs() << "=================================================" << "\n";
+    errs() << "raised: " << numRaised << " of " << numAccesses << " loads and stores" << "\n";
+    errs() << "-------------------------------------------------" << "\n\n";
+}
+
+static RegisterPass<IntervalAlignment> X("interval-align", "Interval Alignment Pass",
+                                         true, // This pass doesn't modify the CFG => true
+                                         false // This pass is a transformation => false
+);
@@ -3,6 +3,15 @@
 //
 
 #include "pass/IntervalAnalysis.h"
+#include "pass/IntervalAnnotation.h"
+#include "pass/IntervalSummary.h"
+#include "pass/SparseIntervalAnalysis.h"
+#include "pass/ZoneIntervalAnalysis.h"
+#include "util/Log.h"
+#include "util/Parallel.h"
+#include <llvm/ADT/PostOrderIterator.h>
+#include <llvm/ADT/SCCIterator.h>
+#include <llvm/Analysis/CallGraph.h>
 #include <llvm/IR/AssemblyAnnotationWriter.h>
 #include <llvm/IR/DebugInfo.h>
 #include <llvm/IR/Function.h>
@@ -14,6 +23,7 @@
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/FormattedStream.h>
 #include <llvm/Support/SourceMgr.h>
+#include <llvm/Transforms/Utils/PromoteMemToReg.h>
 #include "llvm/IR/InstIterator.h"
 #include "llvm/IR/CallSite.h"
 #include <llvm/ADT/BitVector.h>
@@ -25,6 +35,8 @@
 #include <llvm/IR/ValueMap.h>
 #include <llvm/Pass.h>
 #include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <deque>
 #include <list>
 #include <set>
 #include <unordered_map>
@@ -35,105 +47,160 @@
 #include "llvm/IR/BasicBlock.h"
 
 using namespace IntervalNameSpace;
+using namespace PassUtilSpace;
+
+static cl::opt<bool> SparseMode("interval-sparse", cl::init(false),
+                                cl::desc("Run the sparse interval analysis on SSA values (run mem2reg first)"));
+enum IntervalDomainKind { IntervalKind, ZoneKind };
+static cl::opt<IntervalDomainKind> DomainKind("interval-domain", cl::init(IntervalKind),
+                                              cl::desc("Abstract domain of the interval analysis"),
+                                              cl::values(clEnumValN(IntervalKind, "interval", "Non-relational intervals"),
+                                                         clEnumValN(ZoneKind, "zone", "Zones on SSA values (run mem2reg first)")));
+static cl::opt<bool> AnnotateMode("interval-annotate", cl::init(false),
+                                  cl::desc("Write the proven ranges into the IR: !range, nsw/nuw and folded icmps"));
+static cl::opt<unsigned> NarrowingPasses("interval-narrowing", cl::init(3),
+                                         cl::desc("Maximum number of decreasing passes after the widening fixpoint"));
+static cl::opt<unsigned> ContextDepth("interval-context-depth", cl::init(4),
+                                      cl::desc("Nesting depth of the calls analyzed again for their own argument ranges"));
+static cl::opt<unsigned> IntervalThreads("interval-threads", cl::init(0),
+                                         cl::desc("Number of worker threads of intanalysis (0: one per hardware thread)"));
 
 //----------------------------------------------------------------------------//
 // The implementation of Interval //
 //----------------------------------------------------------------------------//
+Interval Interval::top(unsigned bits) {
+    if (bits >= 64)
+        return topInt;
+    return Interval(-(int64_t(1) << (bits - 1)), (int64_t(1) << (bits - 1)) - 1);
+}
+
 Interval Interval::joinInt(Interval a, Interval b) {
-    if (a == botInt)
+    if (a.isBot())
         return b;
-    if (b == botInt)
+    if (b.isBot())
         return a;
 
-    int lo = std::min(a.lo, b.lo), hi = std::max(a.hi, b.hi);
-    return Interval(lo,hi);
+    return Interval(std::min(a.lo, b.lo), std::max(a.hi, b.hi));
 }
 
-Interval Interval::wideningInt(Interval oldV, Interval newV) {
-    int lo = (oldV.lo > newV.lo) ? INT32_MIN : oldV.lo;
-    int hi = (oldV.hi < newV.hi) ? INT32_MAX : oldV.hi;
+Interval Interval::meetInt(Interval a, Interval b) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+
+    Interval meetResult (std::max(a.lo, b.lo), std::min(a.hi, b.hi));
+    return meetResult.isBot() ? botInt : meetResult;
+}
+
+// An unstable bound jumps to the next threshold past it, or to the limit of the type
+Interval Interval::wideningInt(Interval oldV, Interval newV, unsigned bits, ArrayRef<int64_t> thresholds) {
+    if (oldV.isBot())
+        return newV;
+    if (newV.isBot())
+        return oldV;
+
+    Interval typeRange = top(bits);
+    int64_t lo = oldV.lo;
+    if (oldV.lo > newV.lo) {
+        auto below = std::upper_bound(thresholds.begin(), thresholds.end(), newV.lo);
+        lo = (below != thresholds.begin() && *(below - 1) > typeRange.lo) ? *(below - 1) : typeRange.lo;
+    }
+    int64_t hi = oldV.hi;
+    if (oldV.hi < newV.hi) {
+        auto above = std::lower_bound(thresholds.begin(), thresholds.end(), newV.hi);
+        hi = (above != thresholds.end() && *above < typeRange.hi) ? *above : typeRange.hi;
+    }
     Interval wideningResult (lo, hi);
     return wideningResult;
 }
 
+// refine a using relation a < b
+Interval Interval::refineLt(Interval a, Interval b) {
+    if (a.isBot() || b.isBot())  return a;
+    if (b.hi == INT64_MIN)  return botInt;
 
-Interval Interval::addInt(Interval a, Interval b) {
-    int lo = a.lo + b.lo;
-    int hi = a.hi + b.hi;
-    Interval addResult (lo, hi);
-    return addResult;
+    return meetInt(a, Interval(INT64_MIN, b.hi - 1));
 }
 
+// refine a using relation a >= b
+Interval Interval::refineGe(Interval a, Interval b) {
+    if (a.isBot() || b.isBot())  return a;
 
-Interval Interval::subInt(Interval a, Interval b) {
-    int lo = a.lo - b.lo;
-    int hi = a.hi - b.hi;
-    Interval subResult (lo, hi);
-    return subResult;
+    return meetInt(a, Interval(b.lo, INT64_MAX));
 }
 
-// refina a using relation a < b
-Interval Interval::refineLt(Interval a, Interval b) {
-    if (a == botInt || b == botInt)  return a;
+// refine a using relation a <= b
+Interval Interval::refineLe(Interval a, Interval b) {
+    if (a.isBot() || b.isBot())  return a;
 
-    //when b is a constant
-    if (a.lo < b.hi) {
-        if (b.hi == INT32_MAX) { // we view it as plus infinity
-            return Interval(a.lo, b.hi);
-        } else {
-            return Interval(a.lo, b.hi-1);
-        }
-    } else {
-        return botInt;
-    }
+    return meetInt(a, Interval(INT64_MIN, b.hi));
 }
 
-// refina a using relation a >= b
-Interval Interval::refineGe(Interval a, Interval b) {
-    if (a == botInt || b == botInt)  return a;
-
-    //when b is a constant, i.e., b.lo = b.hi
-    if (a.lo <= b.hi) {
-        if (a.hi >= b.hi) {
-            return Interval(b.lo, a.hi);
-        } else {
-            return botInt;
-        }
-    }
+// refine a using relation a > b
+Interval Interval::refineGt(Interval a, Interval b) {
+    if (a.isBot() || b.isBot())  return a;
+    if (b.lo == INT64_MAX)  return botInt;
 
-    return a;
+    return meetInt(a, Interval(b.lo + 1, INT64_MAX));
 }
 
-// refina a using relation a <= b
-Interval Interval::refineLe(Interval a, Interval b) {
-    if (a == botInt || b == botInt)  return a;
 
-    //when b is a constant
-    if (a.lo <= b.lo) {
-        if (a.hi > b.lo) {
-            return Interval(a.lo, b.lo);
-        } else {
-            return a;
-        }
+unsigned IntervalNameSpace::getIntervalBits(const Value *v) {
+    Type *type = v->getType();
+    if (auto *allocaInst = dyn_cast<AllocaInst>(v)) {
+        type = allocaInst->getAllocatedType();
+    } else if (auto *global = dyn_cast<GlobalVariable>(v)) {
+        type = global->getValueType();
+    }
+    if (type->isIntegerTy() && type->getIntegerBitWidth() <= 64) {
+        return type->getIntegerBitWidth();
     }
+    return 64;
+}
+
 
-    return botInt;
+Interval IntervalNameSpace::getConstantInterval(const ConstantInt *c) {
+    if (c->getBitWidth() > 64) {
+        return topInt;
+    }
+    return Interval(c->getSExtValue(), c->getSExtValue());
 }
 
-// refina a using relation a > b
-Interval Interval::refineGt(Interval a, Interval b) {
-    if (a == botInt || b == botInt)  return a;
 
-    //when b is a constant
-    if (a.lo < b.lo) {
-        if (a.hi < b.lo) {  //we view it as negative infinity
-            return botInt;
-        } else {
-            return Interval(b.lo + 1, a.hi);
+std::vector<int64_t> IntervalNameSpace::collectWideningThresholds(Function &F) {
+    std::vector<int64_t> thresholds;
+    auto addWithNeighbours = [&thresholds](int64_t c) {
+        thresholds.push_back(c);
+        if (c > INT64_MIN) thresholds.push_back(c - 1);
+        if (c < INT64_MAX) thresholds.push_back(c + 1);
+    };
+
+    for (Instruction &inst : instructions(F)) {
+        Type *arrayType = nullptr;
+        if (auto *icmpInst = dyn_cast<ICmpInst>(&inst)) {
+            for (Value *operand : icmpInst->operands()) {
+                auto *c = dyn_cast<ConstantInt>(operand);
+                if (c && c->getBitWidth() <= 64) {
+                    addWithNeighbours(c->getSExtValue());
+                }
+            }
+        } else if (auto *allocaInst = dyn_cast<AllocaInst>(&inst)) {
+            arrayType = allocaInst->getAllocatedType();
+        } else if (auto *gepInst = dyn_cast<GetElementPtrInst>(&inst)) {
+            arrayType = gepInst->getSourceElementType();
+        }
+
+        //an index into an array of n elements stays in [0, n-1]
+        while (auto *type = dyn_cast_or_null<ArrayType>(arrayType)) {
+            if (type->getNumElements() <= uint64_t(INT64_MAX)) {
+                addWithNeighbours(int64_t(type->getNumElements()));
+            }
+            arrayType = type->getElementType();
         }
-    } else {
-        return a;
     }
+
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+    return thresholds;
 }
 
 
@@ -142,15 +209,19 @@ bool Interval::operator==(const Interval &rhs) const {
 }
 
 
-string Interval::toStr() const {
+string Interval::toStr(unsigned bits) const {
+    if (isBot())
+        return "bot";
+
+    Interval typeRange = top(bits);
     std::string res = "[";
-    if (lo == INT32_MIN)
+    if (lo <= typeRange.lo)
         res += "-inf";
     else
         res += std::to_string(lo);
 
     res += ",";
-    if (hi == INT32_MAX)
+    if (hi >= typeRange.hi)
         res += "inf";
     else
         res += std::to_string(hi);
@@ -161,36 +232,71 @@ string Interval::toStr() const {
 
 
 //----------------------------------------------------------------------------//
-// The implementation of IntAnalysis //
+// The implementation of DenseIntervalAnalysis //
 //----------------------------------------------------------------------------//
 
-char IntAnalysis::ID = 0;
-
-void IntAnalysis::initArgToTop(Function &F) {
-    for (auto iter=F.arg_begin(); iter != F.arg_end(); ++iter) {
+void DenseIntervalAnalysis::initArgs(const ArgumentRanges &args) {
+    unsigned numArgs = 0;
+    for (auto iter=func.arg_begin(); iter != func.arg_end(); ++iter) {
         Value *formalArg = &*iter;
 
         if (formalArg->getType()->isIntegerTy()) {
-            //absState[nullptr][formalArg] = topInt;
-            Instruction* inst = &F.getEntryBlock().front();
-            absState[inst][formalArg] = topInt;
+            Interval range = args[numArgs++];
+            formalArgs[formalArg] = range;
+            PASS_DEBUG(IntervalLog) << "Init argument " << formalArg->getName() << " to "
+                                    << range.toStr(getIntervalBits(formalArg)) << "\n";
+        }
+    }
+}
 
-            errs() << "Size of abstract state: " << absState.size() << "\n";
-            formalArgs.insert(formalArg);
 
-            errs() << "Init success" << "\n";
-            errs() << formalArg->getName().str() << "\n";
-            inst->print(errs());
-            errs() << "\n";
+/*
+ * An integer global whose address is only used by plain loads and stores of its type, in any
+ * function, cannot be written through a pointer, only by these stores and during calls
+ */
+static bool isGlobalModeled(const GlobalVariable *global) {
+    Type *valueType = global->getValueType();
+    if (!valueType->isIntegerTy()) {
+        return false;
+    }
+    for (const User *user : global->users()) {
+        if (auto *loadInst = dyn_cast<LoadInst>(user)) {
+            if (!loadInst->isSimple() || loadInst->getType() != valueType) {
+                return false;
+            }
+        } else if (auto *storeInst = dyn_cast<StoreInst>(user)) {
+            if (!storeInst->isSimple() || storeInst->getPointerOperand() != global
+                || storeInst->getValueOperand()->getType() != valueType) {
+                return false;
+            }
+        } else {
+            return false;
         }
     }
+    return true;
 }
 
 
-void IntAnalysis::collectCaredValues() {
-    for (auto &inst_m : absState) {
-        for (auto &val_itv : inst_m.second) {
-            caredValues.insert(val_itv.first);
+/*
+ * A slot whose address is only used by plain loads and stores cannot be written behind
+ * the back of the analysis, by a call or through another pointer
+ * A global used the same way is followed as well, through the summaries of the calls
+ */
+void DenseIntervalAnalysis::collectModeledSlots() {
+    for (Instruction &inst : func.getEntryBlock()) {
+        if (auto *allocaInst = dyn_cast<AllocaInst>(&inst)) {
+            if (isAllocaPromotable(allocaInst)) {
+                modeledSlots.insert(allocaInst);
+            }
+        }
+    }
+
+    DenseSet<const GlobalVariable *> seen;
+    for (Instruction &inst : instructions(func)) {
+        auto *global = dyn_cast_or_null<GlobalVariable>(getLoadStorePointerOperand(&inst));
+        if (global && seen.insert(global).second && isGlobalModeled(global)) {
+            modeledSlots.insert(global);
+            modeledGlobals.push_back(global);
         }
     }
 }
@@ -199,7 +305,7 @@ void IntAnalysis::collectCaredValues() {
 /*
  * This procedure should model absState's transfer function on llvm IR (only those appeared in test.bc)
  * */
-void IntAnalysis::AbstractTransfer(Instruction *inst) {
+void DenseIntervalAnalysis::AbstractTransfer(Instruction *inst) {
     if (auto* storeInst = dyn_cast<StoreInst>(inst)) {
         handleStoreInst(storeInst);
     } else if (auto* loadInst = dyn_cast<LoadInst>(inst)) {
@@ -208,256 +314,371 @@ void IntAnalysis::AbstractTransfer(Instruction *inst) {
         handleBranchInst(branchInst);
     } else if (auto* binaryInst = dyn_cast<BinaryOperator>(inst)) {
         handleBinaryOperator(binaryInst);
+    } else if (auto* castInst = dyn_cast<CastInst>(inst)) {
+        handleCastInst(castInst);
+    } else if (auto* selectInst = dyn_cast<SelectInst>(inst)) {
+        handleSelectInst(selectInst);
+    } else if (auto* phiNode = dyn_cast<PHINode>(inst)) {
+        handlePHINode(phiNode);
     } else if (auto* allocaInst = dyn_cast<AllocaInst>(inst)) {
         handleAllocaInst(allocaInst);
+    } else if (auto* callInst = dyn_cast<CallInst>(inst)) {
+        handleCallInst(callInst);
     } else {
         handleOtherInsts(inst);
     }
 }
 
 
-Interval IntAnalysis::getJoinIntervalFromPredInst(Instruction* inst, Value* src) {
-    vector<Instruction*> preds = findPrecedingProgramPoints(inst);
-    Interval srcInterval = botInt;
-    if (inst == &inst->getParent()->front()) {
-        if (branchState[inst].find(src) != branchState[inst].end()) {
-            errs() << "first inst" << "\n";
-            srcInterval = branchState[inst][src];
-        }
-    }
+static std::pair<const Instruction *, const Instruction *> getEdge(const Instruction *from, const Instruction *to) {
+    return std::make_pair(from, to);
+}
 
-    if (formalArgs.find(src) != formalArgs.end()) {
-        return topInt;
+
+/*
+ * A conditional branch refines the values flowing along each of its edges
+ */
+const EdgeFacts *DenseIntervalAnalysis::getEdgeFacts(Instruction *from, Instruction *to) const {
+    if (!from->isTerminator()) {
+        return nullptr;
     }
+    auto facts = edgeFacts.find(getEdge(from, to));
+    return facts == edgeFacts.end() ? nullptr : &facts->second;
+}
+
 
+Interval DenseIntervalAnalysis::getJoinIntervalFromPredInst(Instruction* inst, Value* src) const {
     if (auto *srcConst = dyn_cast<ConstantInt>(src)) {
-        Interval compactInterval(srcConst->getSExtValue(), srcConst->getSExtValue());
-        return compactInterval;
+        return getConstantInterval(srcConst);
+    }
+
+    if (isa<Constant>(src) && !modeledSlots.count(src)) {
+        return Interval::top(getIntervalBits(src));
     }
 
-    errs() << "join the interval from pred inst" << "\n";
-    errs() << srcInterval.toStr() << "\n";
+    ArrayRef<Instruction *> preds = findPrecedingProgramPoints(inst);
+    if (preds.empty()) {
+        if (isa<GlobalVariable>(src)) {
+            return Interval::top(getIntervalBits(src));
+        }
+        auto formalArg = formalArgs.find(src);
+        return formalArg != formalArgs.end() ? formalArg->second : botInt;
+    }
 
+    Interval srcInterval = botInt;
     for (Instruction* predInst : preds) {
-        if (predInst == nullptr) {
+        auto predState = absState.find(predInst);
+        if (predState == absState.end()) {
             continue;
         }
-        if (absState.find(predInst) == absState.end()) {
+        const EdgeFacts *facts = getEdgeFacts(predInst, inst);
+        if (facts && facts->infeasible) {
+            continue;
+        }
+        auto predSource = predState->second.find(src);
+        if (predSource == predState->second.end()) {
             continue;
         }
 
-        if (isa<BranchInst>(predInst)) {
-            srcInterval = srcInterval.joinInt(srcInterval, branchState[predInst][src]);
-        } else {
-            Interval predSourceInterval = absState[predInst][src];
-
-            predInst->print(errs());
-            errs() << "\n";
-            errs() << predSourceInterval.toStr() << "\n";
-
-            srcInterval = srcInterval.joinInt(srcInterval, predSourceInterval);
+        Interval range = predSource->second;
+        if (facts) {
+            auto fact = facts->refined.find(src);
+            if (fact != facts->refined.end()) {
+                range = fact->second;
+            }
         }
+        PASS_TRACE(IntervalLog) << "  pred " << *predInst << ": " << range.toStr() << "\n";
+        srcInterval = srcInterval.joinInt(srcInterval, range);
     }
-    errs() << srcInterval.toStr() << "\n";
+    PASS_TRACE(IntervalLog) << "  join of " << src->getName() << ": " << srcInterval.toStr() << "\n";
     return srcInterval;
 }
 
-//merge the interval of the values except src
-void IntAnalysis::mergeIntervalFromPredInst(Instruction* inst, Value* dest) {
-    vector<Instruction*> preds = findPrecedingProgramPoints(inst);
-    int flag = 0;
+//merge the interval of the values except dest
+//the arguments and the modeled globals enter the state at the entry point, and the facts of an edge replace
+//the values they refine
+void DenseIntervalAnalysis::mergeIntervalFromPredInst(Instruction* inst, Value* dest) {
+    NumState &state = absState[inst];
+
+    ArrayRef<Instruction *> preds = findPrecedingProgramPoints(inst);
+    if (preds.empty()) {
+        for (auto &arg_itv : formalArgs) {
+            state[arg_itv.first] = arg_itv.second;
+        }
+        for (GlobalVariable *global : modeledGlobals) {
+            state[global] = Interval::top(getIntervalBits(global));
+        }
+    }
 
     for (Instruction* predInst : preds) {
-        if (absState.find(predInst) == absState.end()) {
+        auto predState = absState.find(predInst);
+        if (predState == absState.end()) {
             continue;
         }
-        for (auto it : absState[predInst]) {
+        const EdgeFacts *facts = getEdgeFacts(predInst, inst);
+        if (facts && facts->infeasible) {
+            continue;
+        }
+        for (auto &it : predState->second) {
             Value *var = it.first;
             if (var == dest) continue;
-            if (absState[inst].find(var) != absState[inst].end()) {
-                absState[inst][var] = absState[inst][var].joinInt(absState[inst][var], it.second);
+            Interval range = it.second;
+            if (facts) {
+                auto fact = facts->refined.find(var);
+                if (fact != facts->refined.end()) {
+                    range = fact->second;
+                }
+            }
+            auto cur = state.find(var);
+            if (cur != state.end()) {
+                cur->second = cur->second.joinInt(cur->second, range);
             } else {
-                absState[inst][var] = it.second;
+                state[var] = range;
             }
         }
     }
 }
 
 
-void IntAnalysis::handleOtherInsts(Instruction* inst) {
+void DenseIntervalAnalysis::handleOtherInsts(Instruction* inst) {
     mergeIntervalFromPredInst(inst, inst);
+    if (isa<CallBase>(inst)) {
+        applyCallEffects(inst, FunctionSummary::unknown(nullptr));
+    }
+    if (inst->getType()->isIntegerTy()) {
+        absState[inst][inst] = Interval::top(getIntervalBits(inst));
+    }
+}
+
+
+/*
+ * The result of a call, and the globals it may store to, come from the summary of the callee
+ * for the ranges of the arguments
+ */
+void DenseIntervalAnalysis::handleCallInst(CallInst* callInst) {
+    Value *dest = callInst;
+    FunctionSummary summary = resolver->getCallSummary(callInst, [this, callInst](Value *v) {
+        return getJoinIntervalFromPredInst(callInst, v);
+    });
+
+    mergeIntervalFromPredInst(callInst, dest);
+    applyCallEffects(callInst, summary);
+    if (callInst->getType()->isIntegerTy()) {
+        absState[callInst][dest] = summary.ret;
+    }
 }
 
 
-void IntAnalysis::handleAllocaInst(AllocaInst* allocaInst) {
+/*
+ * A global keeps its value or gets one the callee stores, any value if the callee runs unknown code
+ */
+void DenseIntervalAnalysis::applyCallEffects(Instruction *inst, const FunctionSummary &effects) {
+    NumState &state = absState[inst];
+    for (GlobalVariable *global : modeledGlobals) {
+        auto cur = state.find(global);
+        if (cur == state.end()) {
+            continue;
+        }
+        if (effects.clobbersMemory) {
+            cur->second = Interval::top(getIntervalBits(global));
+            continue;
+        }
+        auto stored = effects.globalStores.find(global);
+        if (stored != effects.globalStores.end()) {
+            cur->second = cur->second.joinInt(cur->second, stored->second);
+        }
+    }
+}
+
+
+void DenseIntervalAnalysis::handleAllocaInst(AllocaInst* allocaInst) {
     Value *dest = allocaInst;
     mergeIntervalFromPredInst(allocaInst, dest);
-    absState[allocaInst][dest] = topInt;
+    absState[allocaInst][dest] = Interval::top(getIntervalBits(allocaInst));
 }
 
 
-void IntAnalysis::handleLoadInst(LoadInst* loadInst) {
+void DenseIntervalAnalysis::handleLoadInst(LoadInst* loadInst) {
     Value *dest = loadInst;
     Value *src = loadInst->getOperand(0);
 
     mergeIntervalFromPredInst(loadInst, dest);
-    Interval srcInterval = getJoinIntervalFromPredInst(loadInst, src);
+    Interval srcInterval = modeledSlots.count(src) ? getJoinIntervalFromPredInst(loadInst, src)
+                                                   : Interval::top(getIntervalBits(loadInst));
 
-    loadInst->print(errs());
-    errs() << "\n";
-    errs() << srcInterval.toStr() << "\n";
+    PASS_TRACE(IntervalLog) << *loadInst << ": " << srcInterval.toStr() << "\n";
 
     absState[loadInst][dest] = srcInterval;
 }
 
 
-void IntAnalysis::handleStoreInst(StoreInst* storeInst) {
+void DenseIntervalAnalysis::handleStoreInst(StoreInst* storeInst) {
     Value *src = storeInst->getOperand(0);
     Value *dest = storeInst->getOperand(1);
 
     if (isa<Constant>(src)) {
-        if (auto *constValue = dyn_cast<ConstantInt>(src)) {
-            Interval compactInterval (constValue->getSExtValue(), constValue->getSExtValue());
-            errs() << "print" << "\n";
-            mergeIntervalFromPredInst(storeInst, dest);
-            absState[storeInst][dest] = compactInterval;
-        }
+        mergeIntervalFromPredInst(storeInst, dest);
+        //any other constant, such as a ptrtoint of a global, has an unknown value
+        auto *constValue = dyn_cast<ConstantInt>(src);
+        absState[storeInst][dest] = constValue ? getConstantInterval(constValue)
+                                               : Interval::top(getIntervalBits(dest));
         return;
     }
 
     mergeIntervalFromPredInst(storeInst, dest);
     Interval srcInterval = getJoinIntervalFromPredInst(storeInst, src);
-    errs() << srcInterval.toStr() << "\n";
-    errs() << "SROURCE" << src->getName().str() << "\n";
+    PASS_TRACE(IntervalLog) << *storeInst << ": " << srcInterval.toStr() << "\n";
     absState[storeInst][dest] = srcInterval;
 }
 
 
-void IntAnalysis::handleBranchInst(BranchInst* branchInst) {
-    if (!branchInst->isConditional()) {
+/*
+ * Both operands of the comparison are refined on each edge, for every predicate
+ * An edge on which an operand has no possible value is never taken
+ */
+void DenseIntervalAnalysis::handleBranchInst(BranchInst* branchInst) {
+    mergeIntervalFromPredInst(branchInst, nullptr);
+    if (!branchInst->isConditional() || branchInst->getSuccessor(0) == branchInst->getSuccessor(1)) {
         return;
     }
 
     if (auto* icmpInst = dyn_cast<ICmpInst>(branchInst->getCondition())) {
         Value* operand1 = icmpInst->getOperand(0);
         Value* operand2 = icmpInst->getOperand(1);
+        Interval interval1 = getJoinIntervalFromPredInst(branchInst, operand1);
+        Interval interval2 = getJoinIntervalFromPredInst(branchInst, operand2);
+        unsigned bits = getIntervalBits(operand1);
+
+        PASS_TRACE(IntervalLog) << *branchInst << "\n";
+
+        for (unsigned i = 0; i < 2; i++) {
+            CmpInst::Predicate pred = i == 0 ? icmpInst->getPredicate() : icmpInst->getInversePredicate();
+            Instruction* head = &(branchInst->getSuccessor(i)->front());
+            EdgeFacts &facts = edgeFacts[getEdge(branchInst, head)];
+            facts = EdgeFacts();
+            //an operand without a value yet, or that is not an integer
+            if (interval1.isBot() || interval2.isBot()) {
+                continue;
+            }
 
-        branchInst->print(errs());
-        errs() << "\n";
-
-        //Assume the second operand is ConstantInt
-        if (icmpInst->getSignedPredicate() == CmpInst::ICMP_SLT) {
-            //ICMP_SLT
-            Interval interval1 = getJoinIntervalFromPredInst(branchInst, operand1);
-            Interval interval2 = getJoinIntervalFromPredInst(branchInst, operand2);
-            Interval ltTResult = interval1.refineLt(interval1, interval2);
-            Interval ltFResult = interval1.refineGe(interval1, interval2);
-
-            errs() << "Interval 1: " << interval1.toStr() << "\n";
-            errs() << "Interval 2: " << interval2.toStr() << "\n";
-            errs() << "less True: " << ltTResult.toStr() << "\n";
-            errs() << "less False: " << ltFResult.toStr() << "\n";
-
+            Interval refined1 = refineByPredicate(pred, interval1, interval2, bits);
+            Interval refined2 = refineByPredicate(CmpInst::getSwappedPredicate(pred), interval2, interval1, bits);
+            PASS_TRACE(IntervalLog) << "  " << interval1.toStr(bits) << " " << CmpInst::getPredicateName(pred)
+                                    << " " << interval2.toStr(bits) << ": " << refined1.toStr(bits) << ", "
+                                    << refined2.toStr(bits) << "\n";
+            addEdgeFact(facts, branchInst, operand1, refined1);
+            addEdgeFact(facts, branchInst, operand2, refined2);
+        }
 
-            Instruction* head1 = &(branchInst->getSuccessor(0)->front());
-            branchState[head1][operand1] = ltTResult;
+        if (PASS_LOG_ENABLED(PASS_LOG_LEVEL_TRACE, IntervalLog)) {
+            printSingleState(branchInst);
+        }
+    }
+}
 
-            errs() << "True branch: ";
-            head1->print(errs());
-            errs() << "\n";
-            mergeIntervalFromPredInst(head1, head1);
-            //absState[head1][operand1] = ltTResult;
 
-            Instruction* head2 = &(branchInst->getSuccessor(1)->front());
-            branchState[head2][operand1] = ltFResult;
+/*
+ * A value loaded from a modeled slot in the block of the branch, and not stored since,
+ * is still the content of the slot, so the slot is refined as well
+ */
+void DenseIntervalAnalysis::addEdgeFact(EdgeFacts &facts, BranchInst *branchInst, Value *v, Interval range) {
+    if (range.isBot()) {
+        facts.infeasible = true;
+        return;
+    }
+    if (isa<Constant>(v)) {
+        return;
+    }
+    facts.refined[v] = range;
 
-            errs() << "False branch: ";
-            head2->print(errs());
-            errs() << "\n";
-            mergeIntervalFromPredInst(head2, head2);
-            //absState[head2][operand1] = ltFResult;
+    auto *loadInst = dyn_cast<LoadInst>(v);
+    if (!loadInst || loadInst->getParent() != branchInst->getParent()) {
+        return;
+    }
+    Value *slot = loadInst->getPointerOperand();
+    if (!modeledSlots.count(slot)) {
+        return;
+    }
+    for (Instruction *inst = loadInst->getNextNode(); inst != branchInst; inst = inst->getNextNode()) {
+        //a call may store to a global
+        auto *storeInst = dyn_cast<StoreInst>(inst);
+        if ((storeInst && storeInst->getPointerOperand() == slot)
+            || (isa<CallBase>(inst) && isa<GlobalVariable>(slot))) {
+            return;
+        }
+    }
+    Interval slotInterval = getJoinIntervalFromPredInst(branchInst, slot);
+    if (!slotInterval.isBot()) {
+        facts.refined[slot] = slotInterval.meetInt(slotInterval, range);
+    }
+}
 
-        } else if (icmpInst->getSignedPredicate() == CmpInst::ICMP_SGT) {
-            //ICMP_SGT
-            Interval interval1 = getJoinIntervalFromPredInst(branchInst, operand1);
-            Interval interval2 = getJoinIntervalFromPredInst(branchInst, operand2);
-            Interval gtTResult = interval1.refineGt(interval1, interval2);
-            Interval gtFResult = interval1.refineLe(interval1, interval2);
 
-            errs() << "Interval 1: " << interval1.toStr() << "\n";
-            errs() << "Interval 2: " << interval2.toStr() << "\n";
-            errs() << "less True: " << gtTResult.toStr() << "\n";
-            errs() << "less False: " << gtFResult.toStr() << "\n";
+void DenseIntervalAnalysis::handleBinaryOperator(BinaryOperator *binaryInst) {
+    Value *dest = binaryInst;
+    Interval interval1 = getJoinIntervalFromPredInst(binaryInst, binaryInst->getOperand(0));
+    Interval interval2 = getJoinIntervalFromPredInst(binaryInst, binaryInst->getOperand(1));
+    Interval result = evaluateBinaryOperator(binaryInst, interval1, interval2);
 
-            Instruction* head1 = &(branchInst->getSuccessor(0)->front());
-            branchState[head1][operand1] = gtTResult;
+    PASS_TRACE(IntervalLog) << *binaryInst << ": " << interval1.toStr() << ", "
+                            << interval2.toStr() << " => " << result.toStr() << "\n";
 
-            mergeIntervalFromPredInst(head1, head1);
-            //absState[head1][operand1] = geTResult;
+    mergeIntervalFromPredInst(binaryInst, dest);
+    absState[binaryInst][dest] = result;
+}
 
-            Instruction* head2 = &(branchInst->getSuccessor(1)->front());
-            branchState[head2][operand1] = gtFResult;
 
-            mergeIntervalFromPredInst(head2, head2);
-            //absState[head2][operand1] = geFResult;
-        }
+void DenseIntervalAnalysis::handleCastInst(CastInst *castInst) {
+    Value *dest = castInst;
+    Interval result = evaluateCastInst(castInst, getJoinIntervalFromPredInst(castInst, castInst->getOperand(0)));
 
-        printSingleState(branchInst);
+    mergeIntervalFromPredInst(castInst, dest);
+    if (castInst->getType()->isIntegerTy()) {
+        absState[castInst][dest] = result;
     }
 }
 
 
-void IntAnalysis::handleBinaryOperator(BinaryOperator *binaryInst) {
-    BasicBlock* bb = binaryInst->getParent();
-    Value *operand1, *operand2;
-    Interval interval1, interval2;
-
-    binaryInst->print(errs());
-    errs() << "\n";
-
-    if (binaryInst->getOpcode() == Instruction::Add || binaryInst->getOpcode() == Instruction::Sub) {
-        Value *operand1 = binaryInst->getOperand(0);
-        Value *operand2 = binaryInst->getOperand(1);
-
-        if (auto *consop1 = dyn_cast<ConstantInt>(operand1)) {
-            interval1 = Interval(consop1->getSExtValue(), consop1->getSExtValue());
-            errs() << "pre interval 1" << interval1.toStr() << "\n";
-        } else {
-            interval1 = getJoinIntervalFromPredInst(binaryInst, operand1);
-        }
-
-        if (auto *consop2 = dyn_cast<ConstantInt>(operand2)) {
-            interval2 = Interval(consop2->getSExtValue(), consop2->getSExtValue());
-            errs() << "pre interval 2" << interval2.toStr() << "\n";
-        } else {
-            interval2 = getJoinIntervalFromPredInst(binaryInst, operand2);
-        }
+void DenseIntervalAnalysis::handleSelectInst(SelectInst *selectInst) {
+    Value *dest = selectInst;
+    Interval result;
+    if (auto *cond = dyn_cast<ConstantInt>(selectInst->getCondition())) {
+        result = getJoinIntervalFromPredInst(selectInst, cond->isOne() ? selectInst->getTrueValue()
+                                                                       : selectInst->getFalseValue());
+    } else {
+        Interval trueInterval = getJoinIntervalFromPredInst(selectInst, selectInst->getTrueValue());
+        Interval falseInterval = getJoinIntervalFromPredInst(selectInst, selectInst->getFalseValue());
+        result = trueInterval.joinInt(trueInterval, falseInterval);
     }
 
-    Value* dest = binaryInst;
-    if (binaryInst->getOpcode() == Instruction::Add) {
-        Interval addResult = interval1.addInt(interval1, interval2);
-
-        errs() << "Interval 1" << interval1.toStr() << "\n";
-        errs() << "Interval 2" << interval2.toStr() << "\n";
-        errs() << "add Result" << addResult.toStr() << "\n";
+    mergeIntervalFromPredInst(selectInst, dest);
+    if (selectInst->getType()->isIntegerTy()) {
+        absState[selectInst][dest] = result;
+    }
+}
 
-        mergeIntervalFromPredInst(binaryInst, dest);
-        absState[binaryInst][dest] = addResult;
-    } else if (binaryInst->getOpcode() == Instruction::Sub) {
-        Interval subResult = interval1.subInt(interval1, interval2);
 
-        errs() << "Interval 1" << interval1.toStr() << "\n";
-        errs() << "Interval 2" << interval2.toStr() << "\n";
-        errs() << "sub Result" << subResult.toStr() << "\n";
+/*
+ * The incoming value of a phi is read at the end of its incoming block
+ */
+void DenseIntervalAnalysis::handlePHINode(PHINode *phiNode) {
+    Value *dest = phiNode;
+    Interval result = botInt;
+    for (unsigned i = 0; i < phiNode->getNumIncomingValues(); i++) {
+        Value *val = phiNode->getIncomingValue(i);
+        Instruction *incoming = phiNode->getIncomingBlock(i)->getTerminator();
+        Interval incomingInterval = getJoinIntervalFromPredInst(incoming, val);
+        result = result.joinInt(result, incomingInterval);
+    }
 
-        mergeIntervalFromPredInst(binaryInst, dest);
-        absState[binaryInst][dest] = subResult;
+    mergeIntervalFromPredInst(phiNode, dest);
+    if (phiNode->getType()->isIntegerTy()) {
+        absState[phiNode][dest] = result;
     }
 }
 
 
-void IntAnalysis::dumpAbstractState(Function& F) {
+void DenseIntervalAnalysis::dumpAbstractState() const {
     auto findInst = [] (const std::vector<Instruction *> &vec) {
         Instruction *res = nullptr;
         for (auto i = vec.rbegin(); i != vec.rend(); ++i) {
@@ -470,10 +691,15 @@ void IntAnalysis::dumpAbstractState(Function& F) {
         return res;
     };
 
-    collectCaredValues();
+    std::set<Value *> caredValues; // all variable appeared in absState
+    for (auto &inst_m : absState) {
+        for (auto &val_itv : inst_m.second) {
+            caredValues.insert(val_itv.first);
+        }
+    }
     std::map<int, std::vector<Instruction *>> lineMap;
 
-    for (auto iter = inst_begin(F); iter != inst_end(F); ++iter) {
+    for (auto iter = inst_begin(func); iter != inst_end(func); ++iter) {
         Instruction *inst = &*iter;
         const llvm::DebugLoc &debugInfo = inst->getDebugLoc();
         if (debugInfo.get()) {
@@ -492,11 +718,15 @@ void IntAnalysis::dumpAbstractState(Function& F) {
 
         llvm::errs() << "Line " << line << ":\n";
 
+        auto state = absState.find(inst);
         for (auto val : caredValues) {
             if (isa<AllocaInst>(val)) {
                 llvm::errs() << cast<AllocaInst>(val)->getName().str() << ": ";
-                auto itv = absState[inst][val];
-                llvm::errs() << itv.toStr() << "; ";
+                Interval itv;
+                if (state != absState.end() && state->second.count(val)) {
+                    itv = state->second.at(val);
+                }
+                llvm::errs() << itv.toStr(getIntervalBits(val)) << "; ";
             }
         }
         llvm::errs() << "\n";
@@ -504,91 +734,541 @@ void IntAnalysis::dumpAbstractState(Function& F) {
 }
 
 
-void IntAnalysis::compute(Function& F) {
-    initArgToTop(F);
-    bool hasChanged = false;
-    do {
-        auto curAbs = absState;
-        for (auto iter = inst_begin(F); iter != inst_end(F); ++iter) {
-            Instruction *inst = &*iter;
-            AbstractTransfer(inst);
+/*
+ * Widen at the targets of the retreating edges of a depth-first traversal
+ * Every cycle of the CFG, reducible or not, contains one of them
+ */
+void DenseIntervalAnalysis::collectWideningPoints() {
+    wideningPoints.clear();
+    wideningPoints.resize(pointGraph.size());
+
+    for (unsigned id = 0; id < pointGraph.size(); id++) {
+        Instruction *inst = pointGraph.points[id];
+        if (!inst->isTerminator()) {
+            continue;
+        }
+        for (Instruction *succ : pointGraph.getSuccs(inst)) {
+            unsigned succId = pointGraph.pointId.lookup(succ);
+            if (succId <= id) {
+                wideningPoints.set(succId);
+            }
+        }
+    }
+}
+
+
+/*
+ * Recompute the state after inst from the states of its predecessors
+ * Return true if the state after inst, or a refinement made by inst, has changed
+ */
+bool DenseIntervalAnalysis::updateProgramPoint(Instruction *inst, bool narrowing) {
+    NumState oldState = std::move(absState[inst]);
+    absState[inst].clear();
+
+    ArrayRef<Instruction *> succs;
+    std::vector<EdgeFacts> oldFacts;
+    if (inst->isTerminator()) {
+        succs = findSucceedingProgramPoints(inst);
+        for (Instruction *succ : succs) {
+            oldFacts.push_back(edgeFacts.lookup(getEdge(inst, succ)));
         }
+    }
 
-        hasChanged = !(curAbs == absState);
+    AbstractTransfer(inst);
 
-    } while (hasChanged);
+    NumState &newState = absState[inst];
+    if (narrowing) {
+        for (auto &val_itv : newState) {
+            auto old = oldState.find(val_itv.first);
+            if (old != oldState.end()) {
+                val_itv.second = val_itv.second.meetInt(old->second, val_itv.second);
+            }
+        }
+    } else if (wideningPoints.test(pointGraph.pointId.lookup(inst))) {
+        for (auto &val_itv : newState) {
+            auto old = oldState.find(val_itv.first);
+            if (old != oldState.end()) {
+                Interval joined = val_itv.second.joinInt(old->second, val_itv.second);
+                val_itv.second = val_itv.second.wideningInt(old->second, joined, getIntervalBits(val_itv.first),
+                                                            thresholds);
+            }
+        }
+    }
 
-    dumpAbstractState(F);
+    bool changed = !(newState == oldState);
+    for (unsigned i = 0; i < succs.size(); i++) {
+        changed |= !(edgeFacts.lookup(getEdge(inst, succs[i])) == oldFacts[i]);
+    }
+    return changed;
 }
 
-void IntAnalysis::printSingleState(Instruction* inst) {
-    for (auto stateIt : absState[inst]) {
+
+/*
+ * Worklist algorithm on program points
+ * Only the successors of a program point whose state has changed are processed again
+ */
+void DenseIntervalAnalysis::compute(const ArgumentRanges &args, SummaryResolver &summaries) {
+    resolver = &summaries;
+    initArgs(args);
+    collectModeledSlots();
+    pointGraph.build(func);
+    collectWideningPoints();
+    thresholds = collectWideningThresholds(func);
+
+    //seed in reverse post order, so that most instructions are processed after their inputs
+    std::deque<unsigned> workList;
+    BitVector inWorkList(pointGraph.size(), true);
+    for (unsigned id = 0; id < pointGraph.size(); id++) {
+        workList.push_back(id);
+    }
+
+    iterNum = 0;
+    while (!workList.empty()) {
+        unsigned id = workList.front();
+        workList.pop_front();
+        inWorkList.reset(id);
+        iterNum++;
+
+        Instruction *inst = pointGraph.points[id];
+        if (!updateProgramPoint(inst)) {
+            continue;
+        }
+        for (Instruction *succ : findSucceedingProgramPoints(inst)) {
+            unsigned succId = pointGraph.pointId.lookup(succ);
+            if (!inWorkList.test(succId)) {
+                workList.push_back(succId);
+                inWorkList.set(succId);
+            }
+        }
+    }
+    PASS_DEBUG(IntervalLog) << func.getName() << ": " << iterNum << " transfers\n";
+
+    //the widened result is a post-fixpoint, so each decreasing pass stays above the least fixpoint
+    //and the passes can stop at any time
+    for (unsigned pass = 0; pass < narrowingPasses; pass++) {
+        bool changed = false;
+        for (Instruction *inst : pointGraph.points) {
+            changed |= updateProgramPoint(inst, true);
+        }
+        PASS_DEBUG(IntervalLog) << func.getName() << ": narrowing pass " << pass + 1 << (changed ? "" : ", stable") << "\n";
+        if (!changed) {
+            break;
+        }
+    }
+    resolver = nullptr;
+}
+
+
+Interval DenseIntervalAnalysis::getIntervalAt(Value *v, Instruction *inst) const {
+    if (!pointGraph.pointId.count(inst)) {
+        return botInt;
+    }
+    if (v != inst) {
+        return getJoinIntervalFromPredInst(inst, v);
+    }
+    auto state = absState.find(inst);
+    if (state == absState.end() || !state->second.count(v)) {
+        return Interval::top(getIntervalBits(v));
+    }
+    return state->second.at(v);
+}
+
+
+void DenseIntervalAnalysis::printSingleState(Instruction* inst) const {
+    auto state = absState.find(inst);
+    if (state == absState.end()) {
+        errs() << "\n";
+        return;
+    }
+    for (auto stateIt : state->second) {
 //        if (isa<AllocaInst>(stateIt.first)) {
 //            llvm::errs() << cast<AllocaInst>(stateIt.first)->getName().str() << ": ";
 //            llvm::errs() << stateIt.second.toStr() << "; ";
 //        }
         errs() << stateIt.first->getName().str() << ": ";
-        errs() << stateIt.second.toStr() << "; ";
+        errs() << stateIt.second.toStr(getIntervalBits(stateIt.first)) << "; ";
     }
     errs() << "\n";
 }
 
 
+//----------------------------------------------------------------------------//
+// The implementation of ProgramPointGraph //
+//----------------------------------------------------------------------------//
+
+/*
+ * The predecessor of the first instruction of a block is the terminator of each reachable
+ * predecessor block, and of any other instruction the instruction before it
+ * The entry point has no predecessor
+ */
+void ProgramPointGraph::build(Function &F) {
+    points.clear();
+    pointId.clear();
+    ReversePostOrderTraversal<Function *> RPOT(&F);
+    for (BasicBlock *bb : RPOT) {
+        for (Instruction &inst : *bb) {
+            pointId[&inst] = points.size();
+            points.push_back(&inst);
+        }
+    }
+
+    predBegin.assign(1, 0);
+    succBegin.assign(1, 0);
+    preds.clear();
+    succs.clear();
+    for (Instruction *inst : points) {
+        BasicBlock *bb = inst->getParent();
+        if (inst != &bb->front()) {
+            preds.push_back(inst->getPrevNode());
+        } else {
+            for (BasicBlock *predBB : predecessors(bb)) {
+                if (pointId.count(predBB->getTerminator())) {
+                    preds.push_back(predBB->getTerminator());
+                }
+            }
+        }
+        predBegin.push_back(preds.size());
+
+        if (!inst->isTerminator()) {
+            succs.push_back(inst->getNextNode());
+        } else {
+            for (BasicBlock *succBB : successors(bb)) {
+                succs.push_back(&succBB->front());
+            }
+        }
+        succBegin.push_back(succs.size());
+    }
+}
+
+
+ArrayRef<Instruction *> ProgramPointGraph::getPreds(const Instruction *inst) const {
+    unsigned id = pointId.lookup(inst);
+    return ArrayRef<Instruction *>(preds).slice(predBegin[id], predBegin[id + 1] - predBegin[id]);
+}
+
+
+ArrayRef<Instruction *> ProgramPointGraph::getSuccs(const Instruction *inst) const {
+    unsigned id = pointId.lookup(inst);
+    return ArrayRef<Instruction *>(succs).slice(succBegin[id], succBegin[id + 1] - succBegin[id]);
+}
+
+
 //Helper function
-std::vector<Instruction *> IntAnalysis::findPrecedingProgramPoints(Instruction *inst) {
-    std::vector<Instruction *> preds;
+ArrayRef<Instruction *> DenseIntervalAnalysis::findPrecedingProgramPoints(Instruction *inst) const {
+    return pointGraph.getPreds(inst);
+}
+
+
+ArrayRef<Instruction *> DenseIntervalAnalysis::findSucceedingProgramPoints(Instruction *inst) const {
+    return pointGraph.getSuccs(inst);
+}
+
+
+//----------------------------------------------------------------------------//
+// The implementation of FunctionIntervals and IntervalResultTable //
+//----------------------------------------------------------------------------//
 
-    BasicBlock *bb = inst->getParent();
-    auto beginInst = &*bb->begin();
+FunctionIntervals::FunctionIntervals() = default;
 
-    if (beginInst == inst) {
-        if (&(bb->getParent()->getEntryBlock()) == bb) {
-            preds.push_back(nullptr);
-            return preds;
+FunctionIntervals::~FunctionIntervals() = default;
+
+FunctionIntervals &FunctionIntervals::operator=(FunctionIntervals &&other) = default;
+
+
+Interval FunctionIntervals::getIntervalAt(Value *v, Instruction *inst) const {
+    if (dense) {
+        return dense->getIntervalAt(v, inst);
+    }
+    if (sparse) {
+        if (!sparse->isFeasible(inst->getParent())) {
+            return botInt;
         }
+        return v == inst ? sparse->getRange(v) : sparse->getRangeAt(v, inst->getParent());
+    }
+    return zone ? zone->getRange(v) : Interval::top(getIntervalBits(v));
+}
+
 
-        for (auto bbIter = pred_begin(bb); bbIter != pred_end(bb); ++bbIter) {
-            BasicBlock *prevBB = *bbIter;
-            preds.push_back(prevBB->getTerminator());
+void FunctionIntervals::dump() const {
+    if (dense) {
+        dense->dumpAbstractState();
+    } else if (sparse) {
+        sparse->dump();
+    } else if (zone) {
+        zone->dump();
+    }
+}
+
+
+void IntervalResultTable::reset(Module &M) {
+    slotIndex.clear();
+    slotFunc.clear();
+    for (Function &F : M) {
+        if (F.isDeclaration()) {
+            continue;
         }
+        slotIndex[&F] = slotFunc.size();
+        slotFunc.push_back(&F);
+    }
+    slots.reset(new Slot[slotFunc.size()]);
+}
+
+
+FunctionIntervals &IntervalResultTable::getSlot(const Function *F) {
+    return slots[slotIndex.lookup(F)].result;
+}
+
+
+void IntervalResultTable::publish(const Function *F) {
+    slots[slotIndex.lookup(F)].ready.store(true, std::memory_order_release);
+}
 
+
+const FunctionIntervals *IntervalResultTable::lookup(const Function *F) const {
+    auto it = slotIndex.find(F);
+    if (it == slotIndex.end() || !slots[it->second].ready.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &slots[it->second].result;
+}
+
+
+//----------------------------------------------------------------------------//
+// The implementation of IntAnalysis //
+//----------------------------------------------------------------------------//
+
+char IntAnalysis::ID = 0;
+
+IntAnalysis::IntAnalysis() : ModulePass(ID), summaryCache(new SummaryCache()) {}
+
+IntAnalysis::~IntAnalysis() = default;
+
+
+/*
+ * Every analysis has its own engine, the final one is moved into the result slot of F
+ */
+FunctionSummary IntAnalysis::analyzeFunction(Function &F, const ArgumentRanges &args, SummaryResolver &resolver,
+                                             FunctionIntervals *result) {
+    FunctionIntervals intervals;
+    intervals.func = &F;
+    FunctionSummary summary;
+
+    if (DomainKind == ZoneKind) {
+        //the zones stay intraprocedural
+        intervals.zone.reset(new ZoneIntervalSolver(F));
+        intervals.zone->narrowingPasses = NarrowingPasses;
+        intervals.zone->solve();
+        summary = FunctionSummary::unknown(&F);
+    } else if (SparseMode) {
+        intervals.sparse.reset(new SparseIntervalSolver(
+                F, args, [&resolver](CallInst *callInst, function_ref<Interval(Value *)> rangeOf) {
+                    return resolver.evaluateCall(callInst, rangeOf);
+                }));
+        intervals.sparse->narrowingPasses = NarrowingPasses;
+        intervals.sparse->solve();
     } else {
-        auto nextIter = bb->begin();
-        for (auto iIter = bb->begin(); iIter != bb->end(); ++iIter) {
-            nextIter = iIter;
-            ++nextIter;
-
-            if (nextIter != bb->end()) {
-                if (inst == &*nextIter) {
-                    preds.push_back(&*iIter);
-                    break;
-                }
-            }
+        intervals.dense.reset(new DenseIntervalAnalysis(F));
+        intervals.dense->narrowingPasses = NarrowingPasses;
+        intervals.dense->compute(args, resolver);
+    }
+
+    auto query = [&intervals](Value *v, Instruction *inst) { return intervals.getIntervalAt(v, inst); };
+    if (!intervals.zone) {
+        summary = resolver.buildSummary(F, query);
+    }
+    if (result) {
+        if (!intervals.zone) {
+            recordCallSites(F, query);
         }
+        *result = std::move(intervals);
     }
+    return summary;
+}
+
+
+void IntAnalysis::recordCallSites(Function &F, function_ref<Interval(Value *, Instruction *)> query) {
+    for (Instruction &inst : instructions(F)) {
+        auto *callInst = dyn_cast<CallInst>(&inst);
+        Function *callee = callInst ? callInst->getCalledFunction() : nullptr;
+        if (!callee || callee->isDeclaration()) {
+            continue;
+        }
 
-    assert(!preds.empty());
-    return preds;
+        ArgumentRanges args;
+        if (!getCallArguments(callInst, callee, [&](Value *v) { return query(v, callInst); }, args)) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(callSiteMutex);
+        auto recorded = callSiteRanges.find(callee);
+        if (recorded == callSiteRanges.end()) {
+            callSiteRanges[callee] = args;
+            continue;
+        }
+        for (unsigned i = 0; i < args.size(); i++) {
+            recorded->second[i] = args[i].joinInt(recorded->second[i], args[i]);
+        }
+    }
+}
+
+
+/*
+ * A function that is only called directly from this module, and not from itself, starts
+ * from the join of the arguments of its calls, its callers have had their final analysis
+ */
+ArgumentRanges IntAnalysis::getEntryArguments(Function &F, const DenseSet<Function *> &recursive) {
+    if (!F.hasLocalLinkage() || F.hasAddressTaken() || recursive.count(&F)) {
+        return getTopArguments(F);
+    }
+    for (User *user : F.users()) {
+        auto *callInst = dyn_cast<CallInst>(user);
+        if (!callInst || callInst->getCalledFunction() != &F) {
+            return getTopArguments(F);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(callSiteMutex);
+    auto recorded = callSiteRanges.find(&F);
+    if (recorded == callSiteRanges.end()) {
+        return getTopArguments(F);
+    }
+    return recorded->second;
+}
+
+
+bool IntAnalysis::annotate(Function &F, function_ref<Interval(Value *, Instruction *)> query) {
+    IntervalAnnotator annotator(query);
+    bool changed = annotator.annotate(F);
+    PASS_DEBUG(IntervalLog) << F.getName() << ": " << annotator.numRanges << " ranges, " << annotator.numFlags
+                            << " no-wrap flags, " << annotator.numFolded << " folded comparisons\n";
+    return changed;
+}
+
+
+const FunctionIntervals *IntAnalysis::getFunctionIntervals(const Function *F) const {
+    return results.lookup(F);
 }
 
 
 static RegisterPass<IntAnalysis> X("intanalysis", "Interval Analysis Pass", true, false);
 
 void IntAnalysis::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
-    AU.setPreservesAll();
+    AU.addRequired<CallGraphWrapperPass>();
+    if (AnnotateMode) {
+        AU.setPreservesCFG();
+        AU.addPreserved<CallGraphWrapperPass>();
+    } else {
+        AU.setPreservesAll();
+    }
 }
 
-bool IntAnalysis::runOnModule(Module &M) {
-    for(auto& f:M) {
-        if (f.isDeclaration()){
+/*
+ * Levels of the strongly connected components of the call graph, bottom-up: the callees
+ * of a component outside of it are all in lower levels, so the components of one level
+ * never call each other and can be analyzed concurrently
+ */
+static std::vector<std::vector<std::vector<Function *>>> getCallGraphLevels(CallGraph &CG,
+                                                                          DenseSet<Function *> &recursive) {
+    std::vector<std::vector<std::vector<Function *>>> levels;
+    DenseMap<const Function *, unsigned> levelOf;
+    for (auto scc = scc_begin(&CG); !scc.isAtEnd(); ++scc) {
+        std::vector<Function *> component;
+        unsigned level = 0;
+        for (CallGraphNode *node : *scc) {
+            Function *f = node->getFunction();
+            if (!f || f->isDeclaration()) {
+                continue;
+            }
+            component.push_back(f);
+            if (scc.hasCycle()) {
+                recursive.insert(f);
+            }
+            for (auto &callRecord : *node) {
+                auto calleeLevel = levelOf.find(callRecord.second->getFunction());
+                if (calleeLevel != levelOf.end()) {
+                    level = std::max(level, calleeLevel->second + 1);
+                }
+            }
+        }
+        if (component.empty()) {
             continue;
         }
-        compute(f);
+        for (Function *f : component) {
+            levelOf[f] = level;
+        }
+        if (levels.size() <= level) {
+            levels.resize(level + 1);
+        }
+        levels[level].push_back(std::move(component));
     }
-    return false;
+    return levels;
 }
 
+/*
+ * Bottom-up over the levels of the call graph, every function gets its summary for
+ * arbitrary arguments, after the summaries of its callees
+ * Then top-down, each function gets its final analysis, after all its callers
+ * The components of a level are analyzed concurrently; the results are printed and
+ * written into the IR in module order, once all the workers have finished
+ */
+bool IntAnalysis::runOnModule(Module &M) {
+    summaryCache->clear();
+    callSiteRanges.clear();
+    results.reset(M);
 
+    SummaryResolver::Analyzer analyzeSummary = [this](Function &F, const ArgumentRanges &args,
+                                                      SummaryResolver &resolver) {
+        return analyzeFunction(F, args, resolver, nullptr);
+    };
+    SummaryResolver::Analyzer analyzeFinal = [this](Function &F, const ArgumentRanges &args,
+                                                    SummaryResolver &resolver) {
+        FunctionSummary summary = analyzeFunction(F, args, resolver, &results.getSlot(&F));
+        results.publish(&F);
+        return summary;
+    };
 
+    if (DomainKind == ZoneKind) {
+        parallelForEach(results.size(), IntervalThreads, [&](unsigned i) {
+            SummaryResolver resolver(*summaryCache, analyzeSummary, ContextDepth);
+            Function *f = results.getFunction(i);
+            analyzeFinal(*f, getTopArguments(*f), resolver);
+        });
+    } else {
+        CallGraph &CG = getAnalysis<CallGraphWrapperPass>().getCallGraph();
+        DenseSet<Function *> recursive;
+        auto levels = getCallGraphLevels(CG, recursive);
+
+        for (auto &level : levels) {
+            parallelForEach(level.size(), IntervalThreads, [&](unsigned i) {
+                SummaryResolver resolver(*summaryCache, analyzeSummary, ContextDepth);
+                for (Function *f : level[i]) {
+                    resolver.getSummary(*f, getTopArguments(*f));
+                }
+            });
+        }
 
+        for (auto &level : llvm::reverse(levels)) {
+            parallelForEach(level.size(), IntervalThreads, [&](unsigned i) {
+                SummaryResolver resolver(*summaryCache, analyzeSummary, ContextDepth);
+                for (Function *f : llvm::reverse(level[i])) {
+                    resolver.analyzeRoot(*f, getEntryArguments(*f, recursive), analyzeFinal);
+                }
+            });
+        }
+        PASS_DEBUG(IntervalLog) << summaryCache->size() << " summaries, " << summaryCache->numHits << " cache hits, "
+                                << summaryCache->numMisses << " misses\n";
+    }
 
+    //report and annotate in module order, after all the workers have finished
+    bool modified = false;
+    for (unsigned i = 0; i < results.size(); i++) {
+        Function *f = results.getFunction(i);
+        const FunctionIntervals *intervals = results.lookup(f);
+        intervals->dump();
+        if (AnnotateMode) {
+            modified |= annotate(*f, [intervals](Value *v, Instruction *inst) {
+                return intervals->getIntervalAt(v, inst);
+            });
+        }
+    }
+    return modified;
+}
@@ -0,0 +1,113 @@
+//========================================================================
+// FILE:
+//    IntervalAnnotation.cpp
+//
+// DESCRIPTION:
+//    Writes the ranges proven by IntAnalysis back into the IR
+//
+// License: MIT
+//========================================================================
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
+#include "pass/IntervalAnnotation.h"
+
+using namespace IntervalNameSpace;
+
+//----------------------------------------------------------
+// Implementation of IntervalAnnotator
+//----------------------------------------------------------
+
+// Wider integers are approximated by 64-bit intervals, which are not exact enough to annotate
+static bool isTrackedWidth(Type *type) {
+    return type->isIntegerTy() && type->getIntegerBitWidth() <= 64;
+}
+
+bool IntervalAnnotator::annotate(Function &F) {
+    bool changed = false;
+    for (BasicBlock &bb : F) {
+        for (Instruction &inst : bb) {
+            if (isa<LoadInst>(inst) || isa<CallInst>(inst)) {
+                changed |= annotateRange(&inst);
+            } else if (auto *binaryInst = dyn_cast<BinaryOperator>(&inst)) {
+                changed |= annotateNoWrap(binaryInst);
+            } else if (auto *icmpInst = dyn_cast<ICmpInst>(&inst)) {
+                changed |= foldICmp(icmpInst);
+            }
+        }
+    }
+    return changed;
+}
+
+/*
+ * !range holds the half-open range [lo, hi + 1), which may wrap around
+ * The full range is not a valid !range, and an existing one is kept
+ */
+bool IntervalAnnotator::annotateRange(Instruction *inst) {
+    Type *type = inst->getType();
+    if (!isTrackedWidth(type) || inst->getMetadata(LLVMContext::MD_range)) {
+        return false;
+    }
+
+    unsigned bits = type->getIntegerBitWidth();
+    Interval range = query(inst, inst);
+    if (range.isBot() || range == Interval::top(bits)) {
+        return false;
+    }
+
+    APInt lo(bits, range.lo, true);
+    APInt hi = APInt(bits, range.hi, true) + 1;
+    inst->setMetadata(LLVMContext::MD_range, MDBuilder(inst->getContext()).createRange(lo, hi));
+    numRanges++;
+    return true;
+}
+
+bool IntervalAnnotator::annotateNoWrap(BinaryOperator *binaryInst) {
+    Instruction::BinaryOps opcode = binaryInst->getOpcode();
+    if ((opcode != Instruction::Add && opcode != Instruction::Sub) || !isTrackedWidth(binaryInst->getType())) {
+        return false;
+    }
+    if (binaryInst->hasNoSignedWrap() && binaryInst->hasNoUnsignedWrap()) {
+        return false;
+    }
+
+    unsigned bits = getIntervalBits(binaryInst);
+    Interval a = query(binaryInst->getOperand(0), binaryInst);
+    Interval b = query(binaryInst->getOperand(1), binaryInst);
+
+    bool changed = false;
+    if (!binaryInst->hasNoSignedWrap() && isSignedOverflowFree(opcode, a, b, bits)) {
+        binaryInst->setHasNoSignedWrap(true);
+        changed = true;
+    }
+    if (!binaryInst->hasNoUnsignedWrap() && isUnsignedOverflowFree(opcode, a, b, bits)) {
+        binaryInst->setHasNoUnsignedWrap(true);
+        changed = true;
+    }
+    numFlags += changed;
+    return changed;
+}
+
+/*
+ * The uses of a decided comparison are replaced by the constant, the dead
+ * comparison itself is left to DCE, as the analysis state still refers to it
+ */
+bool IntervalAnnotator::foldICmp(ICmpInst *icmpInst) {
+    Value *operand1 = icmpInst->getOperand(0);
+    Value *operand2 = icmpInst->getOperand(1);
+    if (!isTrackedWidth(operand1->getType()) || icmpInst->use_empty()) {
+        return false;
+    }
+
+    unsigned bits = getIntervalBits(operand1);
+    Optional<bool> result = evaluateICmp(icmpInst->getPredicate(), query(operand1, icmpInst),
+                                         query(operand2, icmpInst), bits);
+    if (!result.hasValue()) {
+        return false;
+    }
+
+    icmpInst->replaceAllUsesWith(ConstantInt::get(icmpInst->getType(), result.getValue()));
+    numFolded++;
+    return true;
+}
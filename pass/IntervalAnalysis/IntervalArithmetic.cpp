@@ -0,0 +1,458 @@
+//========================================================================
+// FILE:
+//    IntervalArithmetic.cpp
+//
+// DESCRIPTION:
+//    Transfer functions of the interval domain for the integer instructions
+//    A value of type iN is the signed range [-2^(N-1), 2^(N-1)-1], so there
+//    is no infinity: the limits of the type play that role. Results are
+//    computed on 128 bits and then fitted back to the type; a result that
+//    leaves the type wraps around (top), unless the instruction has nsw,
+//    then the out-of-range part is poison and the range saturates.
+//
+// License: MIT
+//========================================================================
+
+#include "pass/IntervalAnalysis.h"
+#include <llvm/IR/InstrTypes.h>
+#include <llvm/IR/Operator.h>
+
+using namespace IntervalNameSpace;
+
+typedef __int128 WideInt;
+
+static WideInt signedMin(unsigned bits) {
+    return -(WideInt(1) << (bits - 1));
+}
+
+static WideInt signedMax(unsigned bits) {
+    return (WideInt(1) << (bits - 1)) - 1;
+}
+
+// Fit an exact result back to a bits-wide integer
+static Interval fitResult(WideInt lo, WideInt hi, unsigned bits, bool noWrap) {
+    WideInt min = signedMin(bits), max = signedMax(bits);
+    if (lo >= min && hi <= max)
+        return Interval(int64_t(lo), int64_t(hi));
+    if (!noWrap)
+        return Interval::top(bits);
+    // all the values overflow, so the result is always poison
+    if (hi < min || lo > max)
+        return botInt;
+    return Interval(int64_t(std::max(lo, min)), int64_t(std::min(hi, max)));
+}
+
+static Interval fitCorners(WideInt c1, WideInt c2, WideInt c3, WideInt c4, unsigned bits, bool noWrap) {
+    WideInt lo = std::min(std::min(c1, c2), std::min(c3, c4));
+    WideInt hi = std::max(std::max(c1, c2), std::max(c3, c4));
+    return fitResult(lo, hi, bits, noWrap);
+}
+
+// Smallest 2^k-1 that is not less than the non-negative v
+static int64_t fillLowBits(int64_t v) {
+    uint64_t m = uint64_t(v);
+    m |= m >> 1;
+    m |= m >> 2;
+    m |= m >> 4;
+    m |= m >> 8;
+    m |= m >> 16;
+    m |= m >> 32;
+    return int64_t(m);
+}
+
+// A shift amount not less than the width gives poison, so only [0, bits-1] is kept
+static Interval clampShiftAmount(Interval b, unsigned bits) {
+    return b.meetInt(b, Interval(0, bits - 1));
+}
+
+
+Interval IntervalNameSpace::addInterval(Interval a, Interval b, unsigned bits, bool noSignedWrap) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+
+    // common case: the 64-bit bounds do not overflow, no need to go wide
+    int64_t lo, hi;
+    if (bits == 64 && !__builtin_add_overflow(a.lo, b.lo, &lo) && !__builtin_add_overflow(a.hi, b.hi, &hi))
+        return Interval(lo, hi);
+    return fitResult(WideInt(a.lo) + b.lo, WideInt(a.hi) + b.hi, bits, noSignedWrap);
+}
+
+Interval IntervalNameSpace::subInterval(Interval a, Interval b, unsigned bits, bool noSignedWrap) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+
+    int64_t lo, hi;
+    if (bits == 64 && !__builtin_sub_overflow(a.lo, b.hi, &lo) && !__builtin_sub_overflow(a.hi, b.lo, &hi))
+        return Interval(lo, hi);
+    return fitResult(WideInt(a.lo) - b.hi, WideInt(a.hi) - b.lo, bits, noSignedWrap);
+}
+
+Interval IntervalNameSpace::mulInterval(Interval a, Interval b, unsigned bits, bool noSignedWrap) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+
+    return fitCorners(WideInt(a.lo) * b.lo, WideInt(a.lo) * b.hi,
+                      WideInt(a.hi) * b.lo, WideInt(a.hi) * b.hi, bits, noSignedWrap);
+}
+
+// The quotient is monotone in both operands on each side of 0, so the
+// divisor is split into its negative and positive parts; dividing by 0 and
+// INT_MIN / -1 are undefined, so they do not contribute to the result
+Interval IntervalNameSpace::sdivInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+
+    Interval result = botInt;
+    Interval parts[2] = {b.meetInt(b, Interval(b.lo, -1)), b.meetInt(b, Interval(1, b.hi))};
+    for (Interval d : parts) {
+        if (d.isBot())
+            continue;
+        Interval q = fitCorners(WideInt(a.lo) / d.lo, WideInt(a.lo) / d.hi,
+                                WideInt(a.hi) / d.lo, WideInt(a.hi) / d.hi, bits, true);
+        result = result.joinInt(result, q);
+    }
+    return result;
+}
+
+// Exact only when both operands are non-negative, as unsigned and signed agree there
+Interval IntervalNameSpace::udivInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+    if (b.lo >= 0 && b.hi == 0)
+        return botInt;
+    if (a.lo < 0 || b.lo < 0)
+        return Interval::top(bits);
+
+    return Interval(a.lo / b.hi, a.hi / std::max<int64_t>(b.lo, 1));
+}
+
+// |a srem b| < max |b|, and the remainder has the sign of the dividend
+Interval IntervalNameSpace::sremInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+    if (b.lo == 0 && b.hi == 0)
+        return botInt;
+
+    WideInt maxAbs = std::max(-WideInt(b.lo), WideInt(b.hi)) - 1;
+    WideInt lo = a.lo >= 0 ? 0 : std::max(WideInt(a.lo), -maxAbs);
+    WideInt hi = a.hi <= 0 ? 0 : std::min(WideInt(a.hi), maxAbs);
+    return fitResult(lo, hi, bits, true);
+}
+
+Interval IntervalNameSpace::uremInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+    if (b.lo >= 0 && b.hi == 0)
+        return botInt;
+    if (b.lo < 0)
+        return Interval::top(bits);
+
+    // the remainder is below the divisor, and also below the dividend if it is non-negative
+    int64_t hi = b.hi - 1;
+    if (a.lo >= 0)
+        hi = std::min(hi, a.hi);
+    return Interval(0, hi);
+}
+
+Interval IntervalNameSpace::shlInterval(Interval a, Interval b, unsigned bits, bool noSignedWrap) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+    b = clampShiftAmount(b, bits);
+    if (b.isBot())
+        return botInt;
+
+    // a << s == a * 2^s, |a| < 2^63 and s < 64 fit in 128 bits
+    WideInt minFactor = WideInt(1) << b.lo, maxFactor = WideInt(1) << b.hi;
+    return fitCorners(a.lo * minFactor, a.lo * maxFactor,
+                      a.hi * minFactor, a.hi * maxFactor, bits, noSignedWrap);
+}
+
+Interval IntervalNameSpace::lshrInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+    b = clampShiftAmount(b, bits);
+    if (b.isBot())
+        return botInt;
+
+    if (a.lo >= 0)
+        return Interval(a.lo >> b.hi, a.hi >> b.lo);
+    // a negative value is a large unsigned one, shifting by at least 1 clears the sign bit
+    if (b.lo >= 1)
+        return fitResult(0, ((WideInt(1) << bits) - 1) >> b.lo, bits, false);
+    return Interval::top(bits);
+}
+
+Interval IntervalNameSpace::ashrInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+    b = clampShiftAmount(b, bits);
+    if (b.isBot())
+        return botInt;
+
+    return fitCorners(WideInt(a.lo) >> b.lo, WideInt(a.lo) >> b.hi,
+                      WideInt(a.hi) >> b.lo, WideInt(a.hi) >> b.hi, bits, false);
+}
+
+Interval IntervalNameSpace::andInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+
+    // masking with a non-negative value keeps the result in [0, mask]
+    if (a.lo >= 0 && b.lo >= 0)
+        return Interval(0, std::min(a.hi, b.hi));
+    if (a.lo >= 0)
+        return Interval(0, a.hi);
+    if (b.lo >= 0)
+        return Interval(0, b.hi);
+    // both negative: the sign bit stays and no bit is added
+    if (a.hi < 0 && b.hi < 0)
+        return Interval(signedMin(bits), std::min(a.hi, b.hi));
+    return Interval::top(bits);
+}
+
+Interval IntervalNameSpace::orInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+
+    if (a.lo >= 0 && b.lo >= 0)
+        return Interval(std::max(a.lo, b.lo), fillLowBits(std::max(a.hi, b.hi)));
+    // setting bits of a negative value keeps it negative and does not decrease it
+    if (a.hi < 0 && b.hi < 0)
+        return Interval(std::max(a.lo, b.lo), -1);
+    if (a.hi < 0)
+        return Interval(a.lo, -1);
+    if (b.hi < 0)
+        return Interval(b.lo, -1);
+    return Interval::top(bits);
+}
+
+Interval IntervalNameSpace::xorInterval(Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return botInt;
+
+    if (a.lo >= 0 && b.lo >= 0)
+        return Interval(0, fillLowBits(std::max(a.hi, b.hi)));
+    return Interval::top(bits);
+}
+
+// A negative srcBits-wide value becomes value + 2^srcBits
+Interval IntervalNameSpace::zextInterval(Interval a, unsigned srcBits, unsigned dstBits) {
+    if (a.isBot())
+        return botInt;
+    if (a.lo >= 0)
+        return a;
+    if (srcBits >= 64 || srcBits >= dstBits)
+        return Interval::top(dstBits);
+
+    WideInt offset = WideInt(1) << srcBits;
+    if (a.hi < 0)
+        return fitResult(a.lo + offset, a.hi + offset, dstBits, false);
+    return fitResult(0, offset - 1, dstBits, false);
+}
+
+Interval IntervalNameSpace::truncInterval(Interval a, unsigned dstBits) {
+    if (a.isBot())
+        return botInt;
+    return fitResult(a.lo, a.hi, dstBits, false);
+}
+
+
+// Unsigned range of a bits-wide value, false if a contains both -1 and 0,
+// which are the two ends of the unsigned range
+static bool toUnsignedRange(Interval a, unsigned bits, WideInt &lo, WideInt &hi) {
+    WideInt offset = a.lo >= 0 ? 0 : (WideInt(1) << bits);
+    if (a.lo < 0 && a.hi >= 0)
+        return false;
+    lo = a.lo + offset;
+    hi = a.hi + offset;
+    return true;
+}
+
+bool IntervalNameSpace::isSignedOverflowFree(Instruction::BinaryOps opcode, Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return false;
+
+    WideInt lo, hi;
+    if (opcode == Instruction::Add) {
+        lo = WideInt(a.lo) + b.lo;
+        hi = WideInt(a.hi) + b.hi;
+    } else if (opcode == Instruction::Sub) {
+        lo = WideInt(a.lo) - b.hi;
+        hi = WideInt(a.hi) - b.lo;
+    } else {
+        return false;
+    }
+    return lo >= signedMin(bits) && hi <= signedMax(bits);
+}
+
+bool IntervalNameSpace::isUnsignedOverflowFree(Instruction::BinaryOps opcode, Interval a, Interval b, unsigned bits) {
+    WideInt aLo, aHi, bLo, bHi;
+    if (a.isBot() || b.isBot() || !toUnsignedRange(a, bits, aLo, aHi) || !toUnsignedRange(b, bits, bLo, bHi))
+        return false;
+
+    if (opcode == Instruction::Add)
+        return aHi + bHi < (WideInt(1) << bits);
+    if (opcode == Instruction::Sub)
+        return aLo >= bHi;
+    return false;
+}
+
+Optional<bool> IntervalNameSpace::evaluateICmp(CmpInst::Predicate pred, Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return None;
+
+    // an unsigned comparison is the signed one on the unsigned ranges
+    WideInt aLo = a.lo, aHi = a.hi, bLo = b.lo, bHi = b.hi;
+    if (CmpInst::isUnsigned(pred)) {
+        if (!toUnsignedRange(a, bits, aLo, aHi) || !toUnsignedRange(b, bits, bLo, bHi))
+            return None;
+        pred = ICmpInst::getSignedPredicate(pred);
+    }
+
+    switch (pred) {
+        case CmpInst::ICMP_EQ:
+        case CmpInst::ICMP_NE: {
+            bool isNe = pred == CmpInst::ICMP_NE;
+            if (aLo == aHi && bLo == bHi && aLo == bLo)
+                return !isNe;
+            if (aHi < bLo || bHi < aLo)
+                return isNe;
+            return None;
+        }
+        case CmpInst::ICMP_SLT:
+            if (aHi < bLo) return true;
+            if (aLo >= bHi) return false;
+            return None;
+        case CmpInst::ICMP_SLE:
+            if (aHi <= bLo) return true;
+            if (aLo > bHi) return false;
+            return None;
+        case CmpInst::ICMP_SGT:
+            if (aLo > bHi) return true;
+            if (aHi <= bLo) return false;
+            return None;
+        case CmpInst::ICMP_SGE:
+            if (aLo >= bHi) return true;
+            if (aHi < bLo) return false;
+            return None;
+        default:
+            return None;
+    }
+}
+
+
+// Values of a whose unsigned value lies in [lo, hi]: the non-negative ones are
+// [lo, hi] itself, the negative ones [lo - 2^bits, hi - 2^bits]
+static Interval meetUnsignedRange(Interval a, WideInt lo, WideInt hi, unsigned bits) {
+    WideInt span = WideInt(1) << bits;
+    Interval result = botInt;
+    if (lo <= signedMax(bits)) {
+        Interval nonNegative(int64_t(lo), int64_t(std::min(hi, signedMax(bits))));
+        result = a.meetInt(a, nonNegative);
+    }
+    if (hi > signedMax(bits)) {
+        Interval negative(int64_t(std::max(lo, signedMax(bits) + 1) - span), int64_t(hi - span));
+        Interval part = a.meetInt(a, negative);
+        result = result.joinInt(result, part);
+    }
+    return result;
+}
+
+Interval IntervalNameSpace::refineByPredicate(CmpInst::Predicate pred, Interval a, Interval b, unsigned bits) {
+    if (a.isBot() || b.isBot())
+        return a;
+
+    if (CmpInst::isUnsigned(pred)) {
+        // a range of b holding both -1 and 0 spans the whole unsigned range
+        WideInt bLo = 0, bHi = (WideInt(1) << bits) - 1;
+        toUnsignedRange(b, bits, bLo, bHi);
+        WideInt max = (WideInt(1) << bits) - 1;
+        switch (pred) {
+            case CmpInst::ICMP_ULT:
+                return bHi == 0 ? botInt : meetUnsignedRange(a, 0, bHi - 1, bits);
+            case CmpInst::ICMP_ULE:
+                return meetUnsignedRange(a, 0, bHi, bits);
+            case CmpInst::ICMP_UGT:
+                return bLo == max ? botInt : meetUnsignedRange(a, bLo + 1, max, bits);
+            case CmpInst::ICMP_UGE:
+                return meetUnsignedRange(a, bLo, max, bits);
+            default:
+                return a;
+        }
+    }
+
+    switch (pred) {
+        case CmpInst::ICMP_EQ:
+            return a.meetInt(a, b);
+        case CmpInst::ICMP_NE:
+            // only a constant at one end of a can be cut off
+            if (b.lo != b.hi)
+                return a;
+            if (a.lo == b.lo)
+                return a.lo == a.hi ? botInt : Interval(a.lo + 1, a.hi);
+            if (a.hi == b.lo)
+                return Interval(a.lo, a.hi - 1);
+            return a;
+        case CmpInst::ICMP_SLT:
+            return a.refineLt(a, b);
+        case CmpInst::ICMP_SLE:
+            return a.refineLe(a, b);
+        case CmpInst::ICMP_SGT:
+            return a.refineGt(a, b);
+        case CmpInst::ICMP_SGE:
+            return a.refineGe(a, b);
+        default:
+            return a;
+    }
+}
+
+
+Interval IntervalNameSpace::evaluateBinaryOperator(const BinaryOperator *inst, Interval a, Interval b) {
+    unsigned bits = getIntervalBits(inst);
+    switch (inst->getOpcode()) {
+        case Instruction::Add:
+            return addInterval(a, b, bits, inst->hasNoSignedWrap());
+        case Instruction::Sub:
+            return subInterval(a, b, bits, inst->hasNoSignedWrap());
+        case Instruction::Mul:
+            return mulInterval(a, b, bits, inst->hasNoSignedWrap());
+        case Instruction::SDiv:
+            return sdivInterval(a, b, bits);
+        case Instruction::UDiv:
+            return udivInterval(a, b, bits);
+        case Instruction::SRem:
+            return sremInterval(a, b, bits);
+        case Instruction::URem:
+            return uremInterval(a, b, bits);
+        case Instruction::Shl:
+            return shlInterval(a, b, bits, inst->hasNoSignedWrap());
+        case Instruction::LShr:
+            return lshrInterval(a, b, bits);
+        case Instruction::AShr:
+            return ashrInterval(a, b, bits);
+        case Instruction::And:
+            return andInterval(a, b, bits);
+        case Instruction::Or:
+            return orInterval(a, b, bits);
+        case Instruction::Xor:
+            return xorInterval(a, b, bits);
+        default:
+            return Interval::top(bits);
+    }
+}
+
+Interval IntervalNameSpace::evaluateCastInst(const CastInst *inst, Interval a) {
+    unsigned srcBits = getIntervalBits(inst->getOperand(0));
+    unsigned dstBits = getIntervalBits(inst);
+    switch (inst->getOpcode()) {
+        case Instruction::ZExt:
+            return zextInterval(a, srcBits, dstBits);
+        case Instruction::SExt:
+            // the signed range of the source is already a range of the destination
+            return a;
+        case Instruction::Trunc:
+            return truncInterval(a, dstBits);
+        default:
+            return Interval::top(dstBits);
+    }
+}
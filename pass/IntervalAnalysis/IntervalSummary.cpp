@@ -0,0 +1,245 @@
+//========================================================================
+// FILE:
+//    IntervalSummary.cpp
+//
+// DESCRIPTION:
+//    Function summaries of the interprocedural interval analysis
+//
+// License: MIT
+//========================================================================
+
+#include <algorithm>
+#include "llvm/IR/InstIterator.h"
+#include "pass/IntervalSummary.h"
+#include "util/Log.h"
+
+using namespace IntervalNameSpace;
+
+ArgumentRanges IntervalNameSpace::getTopArguments(const Function &F) {
+    ArgumentRanges args;
+    for (const Argument &arg : F.args()) {
+        if (arg.getType()->isIntegerTy()) {
+            args.push_back(Interval::top(getIntervalBits(&arg)));
+        }
+    }
+    return args;
+}
+
+//----------------------------------------------------------
+// Implementation of FunctionSummary
+//----------------------------------------------------------
+
+FunctionSummary FunctionSummary::unknown(const Function *F) {
+    FunctionSummary summary;
+    Type *retType = F ? F->getReturnType() : nullptr;
+    if (retType && retType->isIntegerTy()) {
+        summary.ret = Interval::top(std::min(retType->getIntegerBitWidth(), 64u));
+    }
+    summary.clobbersMemory = true;
+    return summary;
+}
+
+void FunctionSummary::joinSideEffects(const FunctionSummary &callee) {
+    for (auto &global_itv : callee.globalStores) {
+        Interval &range = globalStores[global_itv.first];
+        range = range.joinInt(range, global_itv.second);
+    }
+    clobbersMemory |= callee.clobbersMemory;
+}
+
+void FunctionSummary::print(raw_ostream &os, const Function &F) const {
+    Type *retType = F.getReturnType();
+    os << "ret " << ret.toStr(retType->isIntegerTy() ? std::min(retType->getIntegerBitWidth(), 64u) : 64);
+    for (auto &global_itv : globalStores) {
+        os << ", " << global_itv.first->getName() << ": "
+           << global_itv.second.toStr(getIntervalBits(global_itv.first));
+    }
+    if (clobbersMemory) {
+        os << ", clobbers memory";
+    }
+}
+
+//----------------------------------------------------------
+// Implementation of SummaryCache
+//----------------------------------------------------------
+
+bool SummaryCache::KeyLess::operator()(const std::pair<const Function *, ArgumentRanges> &a,
+                                       const std::pair<const Function *, ArgumentRanges> &b) const {
+    if (a.first != b.first) {
+        return a.first < b.first;
+    }
+    return std::lexicographical_compare(a.second.begin(), a.second.end(), b.second.begin(), b.second.end(),
+                                        [](const Interval &x, const Interval &y) {
+                                            return x.lo != y.lo ? x.lo < y.lo : x.hi < y.hi;
+                                        });
+}
+
+const FunctionSummary *SummaryCache::lookup(const Function *F, const ArgumentRanges &args) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = summaries.find(std::make_pair(F, args));
+    if (it == summaries.end()) {
+        numMisses++;
+        return nullptr;
+    }
+    numHits++;
+    return &it->second;
+}
+
+const FunctionSummary &SummaryCache::insert(const Function *F, const ArgumentRanges &args, FunctionSummary summary) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return summaries.emplace(std::make_pair(F, args), std::move(summary)).first->second;
+}
+
+unsigned SummaryCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return summaries.size();
+}
+
+void SummaryCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    summaries.clear();
+    numHits = 0;
+    numMisses = 0;
+}
+
+//----------------------------------------------------------
+// Implementation of SummaryResolver
+//----------------------------------------------------------
+
+SummaryResolver::SummaryResolver(SummaryCache &cache, Analyzer analyze, unsigned maxDepth)
+        : cache(cache), analyze(std::move(analyze)), maxDepth(maxDepth) {}
+
+/*
+ * A callee is analyzed in a nested context, by a new analysis on the same thread
+ * A recursive call, or a call nested too deep, uses the summary for arbitrary arguments
+ * if there is already one, and the unknown summary otherwise
+ */
+FunctionSummary SummaryResolver::getSummary(Function &F, const ArgumentRanges &args) {
+    if (const FunctionSummary *cached = cache.lookup(&F, args)) {
+        return *cached;
+    }
+    //computed below a fallback, so the caller depends on the chain as well
+    SummaryCache &chainCache = chainSummaries[activeFunctions];
+    if (const FunctionSummary *cached = chainCache.lookup(&F, args)) {
+        numFallbacks++;
+        return *cached;
+    }
+    if (is_contained(activeFunctions, &F) || activeFunctions.size() > maxDepth) {
+        numFallbacks++;
+        const FunctionSummary *general = cache.lookup(&F, getTopArguments(F));
+        return general ? *general : FunctionSummary::unknown(&F);
+    }
+
+    bool isRoot = activeFunctions.empty();
+    unsigned fallbacks = numFallbacks;
+    activeFunctions.push_back(&F);
+    FunctionSummary summary = analyze(F, args, *this);
+    activeFunctions.pop_back();
+    if (isRoot) {
+        chainSummaries.clear();
+    }
+
+    if (PASS_LOG_ENABLED(PASS_LOG_LEVEL_DEBUG, IntervalLog)) {
+        PASS_DEBUG(IntervalLog) << "summary of " << F.getName() << "(";
+        unsigned numArgs = 0;
+        for (Argument &arg : F.args()) {
+            if (arg.getType()->isIntegerTy()) {
+                errs() << (numArgs ? ", " : "") << args[numArgs].toStr(getIntervalBits(&arg));
+                numArgs++;
+            }
+        }
+        errs() << "): ";
+        summary.print(errs(), F);
+        errs() << "\n";
+    }
+    if (!isRoot && numFallbacks != fallbacks) {
+        return chainSummaries[activeFunctions].insert(&F, args, std::move(summary));
+    }
+    return cache.insert(&F, args, std::move(summary));
+}
+
+FunctionSummary SummaryResolver::analyzeRoot(Function &F, const ArgumentRanges &args, const Analyzer &analyzeRoot) {
+    activeFunctions.push_back(&F);
+    FunctionSummary summary = analyzeRoot(F, args, *this);
+    activeFunctions.pop_back();
+    chainSummaries.clear();
+    return cache.insert(&F, args, std::move(summary));
+}
+
+bool IntervalNameSpace::getCallArguments(CallInst *callInst, Function *callee, function_ref<Interval(Value *)> rangeOf,
+                                         ArgumentRanges &args) {
+    for (Argument &arg : callee->args()) {
+        if (!arg.getType()->isIntegerTy()) {
+            continue;
+        }
+        Interval range = rangeOf(callInst->getArgOperand(arg.getArgNo()));
+        if (range.isBot()) {
+            return false;
+        }
+        args.push_back(range);
+    }
+    return true;
+}
+
+/*
+ * A call of a function that is not analyzed returns any value, and runs unknown code unless
+ * it only reads memory. A call that is not reached has no effect.
+ */
+FunctionSummary SummaryResolver::getCallSummary(CallInst *callInst, function_ref<Interval(Value *)> rangeOf) {
+    Function *callee = callInst->getCalledFunction();
+    if (!callee || callee->isDeclaration()) {
+        FunctionSummary summary;
+        if (callInst->getType()->isIntegerTy()) {
+            summary.ret = Interval::top(getIntervalBits(callInst));
+        }
+        summary.clobbersMemory = !callInst->onlyReadsMemory();
+        return summary;
+    }
+
+    ArgumentRanges args;
+    if (!getCallArguments(callInst, callee, rangeOf, args)) {
+        return FunctionSummary();
+    }
+    return getSummary(*callee, args);
+}
+
+Interval SummaryResolver::evaluateCall(CallInst *callInst, function_ref<Interval(Value *)> rangeOf) {
+    if (!callInst->getType()->isIntegerTy()) {
+        return botInt;
+    }
+    return getCallSummary(callInst, rangeOf).ret;
+}
+
+/*
+ * The return range joins the returned values, the side effects are the integer stores to
+ * globals and the side effects of the callees in the contexts of the calls
+ */
+FunctionSummary SummaryResolver::buildSummary(Function &F, function_ref<Interval(Value *, Instruction *)> query) {
+    FunctionSummary summary;
+    for (Instruction &inst : instructions(F)) {
+        if (auto *retInst = dyn_cast<ReturnInst>(&inst)) {
+            Value *retVal = retInst->getReturnValue();
+            if (retVal && retVal->getType()->isIntegerTy()) {
+                summary.ret = summary.ret.joinInt(summary.ret, query(retVal, retInst));
+            }
+        } else if (auto *storeInst = dyn_cast<StoreInst>(&inst)) {
+            Value *val = storeInst->getValueOperand();
+            Value *ptr = storeInst->getPointerOperand();
+            auto *global = dyn_cast<GlobalVariable>(ptr);
+            if (global && val->getType()->isIntegerTy()) {
+                Interval range = query(val, storeInst);
+                if (!range.isBot()) {
+                    Interval &stored = summary.globalStores[global];
+                    stored = stored.joinInt(stored, range);
+                }
+            } else if (!isa<AllocaInst>(ptr->stripInBoundsOffsets())) {
+                summary.clobbersMemory = true;
+            }
+        } else if (auto *callInst = dyn_cast<CallInst>(&inst)) {
+            summary.joinSideEffects(getCallSummary(callInst, [&](Value *v) { return query(v, callInst); }));
+        } else if (inst.mayWriteToMemory()) {
+            summary.clobbersMemory = true;
+        }
+    }
+    return summary;
+}
@@ -0,0 +1,318 @@
+//========================================================================
+// FILE:
+//    LoopTripCount.cpp
+//
+// DESCRIPTION:
+//    Trip count bounds from the sparse intervals
+//    The trip count is the number of times the header runs, so a loop
+//    whose exit test fails in the header on entry has a trip count of 1.
+//    The lower bound only assumes the loop leaves through its exit test;
+//    a loop with several exiting blocks only gets the upper bound.
+//
+// License: MIT
+//========================================================================
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Metadata.h"
+#include "llvm/Support/CommandLine.h"
+#include "pass/LoopTripCount.h"
+#include "util/Log.h"
+
+using namespace IntervalNameSpace;
+
+typedef __int128 WideInt;
+
+static cl::opt<bool> MetadataMode("trip-count-metadata", cl::init(false),
+                                  cl::desc("Write the trip count bounds into the llvm.loop metadata"));
+
+static const char *const MinMetadataName = "interval.trip_count.min";
+static const char *const MaxMetadataName = "interval.trip_count.max";
+
+char LoopTripCount::ID = 0;
+
+string TripCount::toStr() const {
+    return "[" + std::to_string(min) + "," + (hasMax() ? std::to_string(max) : "inf") + "]";
+}
+
+//----------------------------------------------------------
+// Implementation of LoopTripCount
+//----------------------------------------------------------
+
+void LoopTripCount::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
+    AU.addRequired<LoopInfoWrapperPass>();
+    if (MetadataMode) {
+        AU.setPreservesCFG();
+        AU.addPreserved<LoopInfoWrapperPass>();
+    } else {
+        AU.setPreservesAll();
+    }
+}
+
+bool LoopTripCount::getInductionVariable(Loop *L, PHINode *phi, InductionVariable &iv) {
+    BasicBlock *preheader = L->getLoopPreheader(), *latch = L->getLoopLatch();
+    if (!preheader || !latch || !phi->getType()->isIntegerTy() || phi->getNumIncomingValues() != 2) {
+        return false;
+    }
+    auto *next = dyn_cast<BinaryOperator>(phi->getIncomingValueForBlock(latch));
+    if (!next || (next->getOpcode() != Instruction::Add && next->getOpcode() != Instruction::Sub)) {
+        return false;
+    }
+    //i + step, step + i or i - step
+    bool phiFirst = next->getOperand(0) == phi;
+    if (!phiFirst && (next->getOperand(1) != phi || next->getOpcode() == Instruction::Sub)) {
+        return false;
+    }
+    auto *step = dyn_cast<ConstantInt>(next->getOperand(phiFirst ? 1 : 0));
+    if (!step || step->getBitWidth() > 64) {
+        return false;
+    }
+    int64_t value = step->getSExtValue();
+    if (value == 0 || value == INT64_MIN) {
+        return false;
+    }
+    iv = {phi, phi->getIncomingValueForBlock(preheader), next,
+          next->getOpcode() == Instruction::Sub ? -value : value};
+    return true;
+}
+
+bool LoopTripCount::mayWrap(const InductionVariable &iv, const SparseIntervalSolver &solver, bool trustFlags) {
+    if (trustFlags && iv.next->hasNoSignedWrap()) {
+        return false;
+    }
+    Interval typeRange = Interval::top(getIntervalBits(iv.phi));
+    Interval before = solver.getRangeAt(iv.phi, iv.next->getParent());
+    return before.isBot() || WideInt(before.lo) + iv.step < typeRange.lo ||
+           WideInt(before.hi) + iv.step > typeRange.hi;
+}
+
+/*
+ * Header runs until v < limit fails, for v = start + j * step with step > 0, j from 0 for
+ * the phi and from 1 for the next value
+ */
+static WideInt countIterations(WideInt start, WideInt limit, WideInt step, bool testsNext) {
+    WideInt distance = limit - start;
+    WideInt passing = distance <= 0 ? 0 : (distance + step - 1) / step;
+    return testsNext ? std::max(passing, WideInt(1)) : passing + 1;
+}
+
+/*
+ * The test is turned into v < limit on an increasing v, negating everything for a
+ * decreasing iv. The fewest iterations come from the largest start and the smallest limit,
+ * the most from the smallest start and the largest limit, if the test runs in every
+ * iteration (in the header or the latch) and v does not wrap around before reaching it.
+ */
+TripCount LoopTripCount::getExitTestBounds(Loop *L, const InductionVariable &iv, const SparseIntervalSolver &solver) {
+    TripCount count;
+    BasicBlock *exiting = L->getExitingBlock();
+    auto *branchInst = exiting ? dyn_cast<BranchInst>(exiting->getTerminator()) : nullptr;
+    auto *icmpInst = branchInst && branchInst->isConditional() ? dyn_cast<ICmpInst>(branchInst->getCondition())
+                                                               : nullptr;
+    if (!icmpInst) {
+        return count;
+    }
+    //the predicate under which the loop goes on
+    CmpInst::Predicate pred = L->contains(branchInst->getSuccessor(0)) ? icmpInst->getPredicate()
+                                                                       : icmpInst->getInversePredicate();
+    Value *tested = icmpInst->getOperand(0), *bound = icmpInst->getOperand(1);
+    if (!L->isLoopInvariant(bound)) {
+        std::swap(tested, bound);
+        pred = CmpInst::getSwappedPredicate(pred);
+    }
+    if (!L->isLoopInvariant(bound) || (tested != iv.phi && tested != iv.next)) {
+        return count;
+    }
+
+    BasicBlock *preheader = L->getLoopPreheader();
+    Interval start = solver.getRangeAt(iv.start, preheader);
+    Interval limit = isa<ConstantInt>(bound) ? getConstantInterval(cast<ConstantInt>(bound))
+                                             : solver.getRangeAt(bound, preheader);
+    if (start.isBot() || limit.isBot()) {
+        return count;
+    }
+
+    bool increasing = iv.step > 0;
+    WideInt step = increasing ? WideInt(iv.step) : -WideInt(iv.step);
+    WideInt startMin = increasing ? WideInt(start.lo) : -WideInt(start.hi);
+    WideInt startMax = increasing ? WideInt(start.hi) : -WideInt(start.lo);
+    WideInt limitMin = increasing ? WideInt(limit.lo) : -WideInt(limit.hi);
+    WideInt limitMax = increasing ? WideInt(limit.hi) : -WideInt(limit.lo);
+    bool nonNegative = start.lo >= 0 && limit.lo >= 0;
+    //an unsigned test on a decreasing iv goes on when v drops below zero
+    bool boundsMax = true;
+    switch (pred) {
+        case CmpInst::ICMP_ULT:
+        case CmpInst::ICMP_ULE:
+        case CmpInst::ICMP_SLT:
+        case CmpInst::ICMP_SLE:
+            if (!increasing || (CmpInst::isUnsigned(pred) && !nonNegative)) return count;
+            break;
+        case CmpInst::ICMP_UGT:
+        case CmpInst::ICMP_UGE:
+        case CmpInst::ICMP_SGT:
+        case CmpInst::ICMP_SGE:
+            //v >u limit holds whenever v >s limit >= 0
+            if (increasing || (CmpInst::isUnsigned(pred) && limit.lo < 0)) return count;
+            boundsMax = CmpInst::isSigned(pred);
+            break;
+        case CmpInst::ICMP_NE:
+            //a unit step cannot jump over the limit once it starts below it
+            if (step != 1 || startMax > limitMin) return count;
+            break;
+        default:
+            return count;
+    }
+    if (pred == CmpInst::ICMP_ULE || pred == CmpInst::ICMP_SLE ||
+        pred == CmpInst::ICMP_UGE || pred == CmpInst::ICMP_SGE) {
+        limitMin += 1;
+        limitMax += 1;
+    }
+
+    bool testsNext = tested == iv.next;
+    WideInt fewest = countIterations(startMax, limitMin, step, testsNext);
+    count.min = fewest > WideInt(UINT64_MAX) ? UINT64_MAX : uint64_t(fewest);
+    if (boundsMax && (exiting == L->getHeader() || exiting == L->getLoopLatch()) && !mayWrap(iv, solver)) {
+        WideInt most = countIterations(startMin, limitMax, step, testsNext);
+        count.max = most > WideInt(UINT64_MAX) ? 0 : uint64_t(most);
+    }
+    return count;
+}
+
+bool LoopTripCount::controlsExit(Loop *L, const InductionVariable &iv) {
+    BasicBlock *exiting = L->getExitingBlock();
+    if (!exiting || (exiting != L->getHeader() && exiting != L->getLoopLatch())) {
+        return false;
+    }
+    auto *branchInst = dyn_cast<BranchInst>(exiting->getTerminator());
+    auto *icmpInst = branchInst && branchInst->isConditional() ? dyn_cast<ICmpInst>(branchInst->getCondition())
+                                                               : nullptr;
+    if (!icmpInst) {
+        return false;
+    }
+    for (Value *operand : icmpInst->operands()) {
+        if (operand == iv.phi || operand == iv.next) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Without wrapping, the iv takes a new value in the header each time, all of them in its
+ * range and step apart. A signed overflow under nsw only makes a poison value, so the loop
+ * goes on unless the exit test branches on it: nsw only counts for the iv of the exit test.
+ */
+uint64_t LoopTripCount::getRangeBound(Loop *L, const InductionVariable &iv, const SparseIntervalSolver &solver) {
+    Interval range = solver.getRange(iv.phi);
+    if (range.isBot() || mayWrap(iv, solver, controlsExit(L, iv))) {
+        return 0;
+    }
+    WideInt step = iv.step > 0 ? WideInt(iv.step) : -WideInt(iv.step);
+    WideInt count = (WideInt(range.hi) - range.lo) / step + 1;
+    return count > WideInt(UINT64_MAX) ? 0 : uint64_t(count);
+}
+
+/*
+ * The tightest bounds over the induction variables of the header
+ */
+TripCount LoopTripCount::computeTripCount(Loop *L, const SparseIntervalSolver &solver) {
+    TripCount count;
+    auto tightenMax = [&count](uint64_t max) {
+        if (max != 0 && (!count.hasMax() || max < count.max)) {
+            count.max = max;
+        }
+    };
+    for (PHINode &phi : L->getHeader()->phis()) {
+        InductionVariable iv;
+        if (!getInductionVariable(L, &phi, iv)) {
+            continue;
+        }
+        TripCount exitTest = getExitTestBounds(L, iv, solver);
+        count.min = std::max(count.min, exitTest.min);
+        tightenMax(exitTest.max);
+        tightenMax(getRangeBound(L, iv, solver));
+        PASS_DEBUG(IntervalLog) << phi << ": step " << iv.step << ", trip count " << count.toStr() << "\n";
+    }
+    //both bounds hold for every run of the loop, so they cannot cross unless one of them is wrong
+    if (count.hasMax() && count.min > count.max) {
+        BasicBlock *header = L->getHeader();
+        PASS_ERROR(IntervalLog) << header->getParent()->getName() << ": loop " << header->getName()
+                                << " has the inconsistent trip count " << count.toStr() << ", dropped\n";
+        return TripCount();
+    }
+    return count;
+}
+
+/*
+ * The loop ID is a distinct node whose first operand is itself; the other properties of
+ * the loop are kept, an older trip count is replaced
+ */
+void LoopTripCount::attachMetadata(Loop *L, const TripCount &count) {
+    LLVMContext &ctx = L->getHeader()->getContext();
+    SmallVector<Metadata *, 4> ops;
+    ops.push_back(nullptr);
+    if (MDNode *loopID = L->getLoopID()) {
+        for (unsigned i = 1; i < loopID->getNumOperands(); i++) {
+            auto *node = dyn_cast<MDNode>(loopID->getOperand(i));
+            auto *name = node && node->getNumOperands() > 0 ? dyn_cast<MDString>(node->getOperand(0)) : nullptr;
+            if (name && (name->getString() == MinMetadataName || name->getString() == MaxMetadataName)) {
+                continue;
+            }
+            ops.push_back(loopID->getOperand(i));
+        }
+    }
+    Type *int64Ty = Type::getInt64Ty(ctx);
+    ops.push_back(MDNode::get(ctx, {MDString::get(ctx, MinMetadataName),
+                                    ConstantAsMetadata::get(ConstantInt::get(int64Ty, count.min))}));
+    if (count.hasMax()) {
+        ops.push_back(MDNode::get(ctx, {MDString::get(ctx, MaxMetadataName),
+                                        ConstantAsMetadata::get(ConstantInt::get(int64Ty, count.max))}));
+    }
+    MDNode *loopID = MDNode::getDistinct(ctx, ops);
+    loopID->replaceOperandWith(0, loopID);
+    L->setLoopID(loopID);
+}
+
+bool LoopTripCount::runOnFunction(Function &F) {
+    LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    tripCounts.clear();
+    if (LI.empty()) {
+        return false;
+    }
+
+    SparseIntervalSolver solver(F);
+    solver.solve();
+    bool changed = false;
+    for (Loop *L : LI.getLoopsInPreorder()) {
+        TripCount count = computeTripCount(L, solver);
+        tripCounts[L] = count;
+        if (MetadataMode && (count.min > 1 || count.hasMax())) {
+            attachMetadata(L, count);
+            changed = true;
+        }
+    }
+
+    printTripCountResult(F, LI);
+    return changed;
+}
+
+TripCount LoopTripCount::getTripCount(const Loop *L) const {
+    auto count = tripCounts.find(L);
+    return count == tripCounts.end() ? TripCount() : count->second;
+}
+
+void LoopTripCount::printTripCountResult(Function &F, LoopInfo &LI) {
+    errs() << "=================================================" << "\n";
+    errs() << "LLVM-TUTOR: Trip count results for `" << F.getName() << "`\n";
+    errs() << "=================================================" << "\n";
+    for (Loop *L : LI.getLoopsInPreorder()) {
+        errs() << "loop " << L->getHeader()->getName() << " (depth " << L->getLoopDepth() << "): "
+               << getTripCount(L).toStr() << "\n";
+    }
+    errs() << "-------------------------------------------------" << "\n\n";
+}
+
+static RegisterPass<LoopTripCount> X("interval-trip-count", "Interval Loop Trip Count Pass",
+                                     true, // This pass doesn't modify the CFG => true
+                                     false // This pass writes loop metadata under -trip-count-metadata => false
+);
@@ -0,0 +1,408 @@
+//========================================================================
+// FILE:
+//    SparseIntervalAnalysis.cpp
+//
+// DESCRIPTION:
+//    Sparse interval analysis on SSA form
+//
+// License: MIT
+//========================================================================
+
+#include <deque>
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Instructions.h"
+#include "pass/SparseIntervalAnalysis.h"
+#include "util/Log.h"
+
+using namespace IntervalNameSpace;
+
+//----------------------------------------------------------
+// Implementation of SparseIntervalSolver
+//----------------------------------------------------------
+
+SparseIntervalSolver::SparseIntervalSolver(Function &F, ArgumentRanges args, CallEvaluator evaluateCall)
+        : func(F), domTree(F), argRanges(std::move(args)), callEvaluator(std::move(evaluateCall)) {
+    numberValues();
+    collectWideningBlocks();
+    thresholds = collectWideningThresholds(F);
+}
+
+/*
+ * Number the integer arguments and the integer instructions in reverse post order
+ */
+void SparseIntervalSolver::numberValues() {
+    for (Argument &arg : func.args()) {
+        if (arg.getType()->isIntegerTy()) {
+            valueIndex[&arg] = values.size();
+            values.push_back(&arg);
+        }
+    }
+    ReversePostOrderTraversal<Function *> RPOT(&func);
+    for (BasicBlock *bb : RPOT) {
+        for (Instruction &inst : *bb) {
+            if (inst.getType()->isIntegerTy()) {
+                valueIndex[&inst] = values.size();
+                values.push_back(&inst);
+            }
+        }
+    }
+    ranges.assign(values.size(), botInt);
+}
+
+/*
+ * The targets of the retreating edges cut every cycle, their phis are widened
+ */
+void SparseIntervalSolver::collectWideningBlocks() {
+    DenseMap<const BasicBlock *, unsigned> rpoIndex;
+    ReversePostOrderTraversal<Function *> RPOT(&func);
+    for (BasicBlock *bb : RPOT) {
+        unsigned index = rpoIndex.size();
+        rpoIndex[bb] = index;
+    }
+    for (BasicBlock *bb : RPOT) {
+        for (BasicBlock *succ : successors(bb)) {
+            if (rpoIndex[succ] <= rpoIndex[bb]) {
+                wideningBlocks.insert(succ);
+            }
+        }
+    }
+}
+
+Interval SparseIntervalSolver::getRange(const Value *v) const {
+    if (auto *c = dyn_cast<ConstantInt>(v)) {
+        return getConstantInterval(c);
+    }
+    auto it = valueIndex.find(v);
+    if (it == valueIndex.end()) {
+        return Interval::top(getIntervalBits(v));
+    }
+    return ranges[it->second];
+}
+
+/*
+ * Refine the range of v with the condition of the branch from -> to
+ */
+Interval SparseIntervalSolver::applyEdgeFact(const Value *v, const BasicBlock *from, const BasicBlock *to,
+                                             Interval range) const {
+    auto *branchInst = dyn_cast<BranchInst>(from->getTerminator());
+    if (!branchInst || !branchInst->isConditional()) {
+        return range;
+    }
+    //both edges lead to the same block, the condition says nothing there
+    if (branchInst->getSuccessor(0) == branchInst->getSuccessor(1)) {
+        return range;
+    }
+    auto *icmpInst = dyn_cast<ICmpInst>(branchInst->getCondition());
+    if (!icmpInst) {
+        return range;
+    }
+
+    CmpInst::Predicate pred = branchInst->getSuccessor(0) == to ? icmpInst->getPredicate()
+                                                                : icmpInst->getInversePredicate();
+    unsigned bits = getIntervalBits(icmpInst->getOperand(0));
+    if (icmpInst->getOperand(0) == v) {
+        range = refineByPredicate(pred, range, getRange(icmpInst->getOperand(1)), bits);
+    }
+    if (icmpInst->getOperand(1) == v) {
+        range = refineByPredicate(CmpInst::getSwappedPredicate(pred), range, getRange(icmpInst->getOperand(0)), bits);
+    }
+    return range;
+}
+
+/*
+ * Walk up the dominator tree from bb to the definition of v
+ * An edge into a block with a single predecessor dominates everything that block dominates
+ */
+Interval SparseIntervalSolver::getRangeAt(const Value *v, const BasicBlock *bb) const {
+    Interval range = getRange(v);
+    if (isa<Constant>(v)) {
+        return range;
+    }
+
+    const BasicBlock *defBB = &func.getEntryBlock();
+    if (auto *inst = dyn_cast<Instruction>(v)) {
+        defBB = inst->getParent();
+    }
+    for (DomTreeNode *node = domTree.getNode(bb); node && node->getBlock() != defBB; node = node->getIDom()) {
+        const BasicBlock *block = node->getBlock();
+        if (const BasicBlock *pred = block->getSinglePredecessor()) {
+            range = applyEdgeFact(v, pred, block, range);
+        }
+    }
+    return range;
+}
+
+bool SparseIntervalSolver::isFeasible(const BasicBlock *bb) const {
+    for (DomTreeNode *node = domTree.getNode(bb); node; node = node->getIDom()) {
+        const BasicBlock *block = node->getBlock();
+        const BasicBlock *pred = block->getSinglePredecessor();
+        auto *branchInst = pred ? dyn_cast<BranchInst>(pred->getTerminator()) : nullptr;
+        if (!branchInst || !branchInst->isConditional()) {
+            continue;
+        }
+        auto *icmpInst = dyn_cast<ICmpInst>(branchInst->getCondition());
+        if (!icmpInst || branchInst->getSuccessor(0) == branchInst->getSuccessor(1)) {
+            continue;
+        }
+
+        CmpInst::Predicate pred0 = branchInst->getSuccessor(0) == block ? icmpInst->getPredicate()
+                                                                        : icmpInst->getInversePredicate();
+        Optional<bool> holds = evaluateICmp(pred0, getRangeAt(icmpInst->getOperand(0), pred),
+                                            getRangeAt(icmpInst->getOperand(1), pred),
+                                            getIntervalBits(icmpInst->getOperand(0)));
+        if (holds.hasValue() && !holds.getValue()) {
+            return false;
+        }
+    }
+    return domTree.getNode(bb) != nullptr;
+}
+
+/*
+ * Rewrite a > b and a >= b as b < a and b <= a, false for eq and ne
+ */
+static bool normalizeToLess(CmpInst::Predicate &pred, const Value *&a, const Value *&b) {
+    switch (pred) {
+        case CmpInst::ICMP_SLT:
+        case CmpInst::ICMP_SLE:
+        case CmpInst::ICMP_ULT:
+        case CmpInst::ICMP_ULE:
+            return true;
+        case CmpInst::ICMP_SGT:
+        case CmpInst::ICMP_SGE:
+        case CmpInst::ICMP_UGT:
+        case CmpInst::ICMP_UGE:
+            std::swap(a, b);
+            pred = CmpInst::getSwappedPredicate(pred);
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+ * Whether the fact "a pred b" implies the goal "a goal b", both < or <=
+ * A signed fact gives the unsigned goal once a >= 0, an unsigned fact the signed goal once b >= 0
+ */
+static bool impliesRelation(CmpInst::Predicate fact, CmpInst::Predicate goal, bool aNonNegative, bool bNonNegative) {
+    if (CmpInst::isSigned(fact) != CmpInst::isSigned(goal)) {
+        if (CmpInst::isSigned(fact) ? !aNonNegative : !bNonNegative) {
+            return false;
+        }
+    }
+    bool strictFact = fact == CmpInst::ICMP_SLT || fact == CmpInst::ICMP_ULT;
+    bool strictGoal = goal == CmpInst::ICMP_SLT || goal == CmpInst::ICMP_ULT;
+    return strictFact || !strictGoal;
+}
+
+/*
+ * Whether the condition of the branch from -> to, when the edge is taken, implies "a goal b"
+ */
+bool SparseIntervalSolver::edgeImpliesRelation(const BasicBlock *from, const BasicBlock *to, CmpInst::Predicate goal,
+                                               const Value *a, const Value *b, const BasicBlock *bb) const {
+    auto *branchInst = dyn_cast<BranchInst>(from->getTerminator());
+    if (!branchInst || !branchInst->isConditional() || branchInst->getSuccessor(0) == branchInst->getSuccessor(1)) {
+        return false;
+    }
+    auto *icmpInst = dyn_cast<ICmpInst>(branchInst->getCondition());
+    if (!icmpInst) {
+        return false;
+    }
+
+    CmpInst::Predicate fact = branchInst->getSuccessor(0) == to ? icmpInst->getPredicate()
+                                                                : icmpInst->getInversePredicate();
+    const Value *factA = icmpInst->getOperand(0);
+    const Value *factB = icmpInst->getOperand(1);
+    if (!normalizeToLess(fact, factA, factB) || factA != a || factB != b) {
+        return false;
+    }
+    return impliesRelation(fact, goal, getRangeAt(a, bb).lo >= 0, getRangeAt(b, bb).lo >= 0);
+}
+
+bool SparseIntervalSolver::provesRelation(CmpInst::Predicate pred, const Value *a, const Value *b,
+                                          const BasicBlock *bb) const {
+    return provesRelation(pred, a, b, bb, 1);
+}
+
+bool SparseIntervalSolver::provesRelation(CmpInst::Predicate pred, const Value *a, const Value *b,
+                                          const BasicBlock *bb, unsigned phiDepth) const {
+    Optional<bool> decided = evaluateICmp(pred, getRangeAt(a, bb), getRangeAt(b, bb), getIntervalBits(a));
+    if (decided.hasValue()) {
+        return decided.getValue();
+    }
+
+    CmpInst::Predicate goal = pred;
+    if (!normalizeToLess(goal, a, b)) {
+        return false;
+    }
+
+    for (DomTreeNode *node = domTree.getNode(bb); node; node = node->getIDom()) {
+        const BasicBlock *block = node->getBlock();
+        const BasicBlock *predBB = block->getSinglePredecessor();
+        if (predBB && edgeImpliesRelation(predBB, block, goal, a, b, bb)) {
+            return true;
+        }
+    }
+
+    // a phi is below b if every incoming value is, on its edge or at the end of its block
+    // b must be defined before the phi, so that it is the same value on every edge
+    auto *phi = dyn_cast<PHINode>(a);
+    auto *boundInst = dyn_cast<Instruction>(b);
+    if (phi && phiDepth > 0 &&
+        (!boundInst || (boundInst->getParent() != phi->getParent() && domTree.dominates(boundInst, phi)))) {
+        bool provenOnAllEdges = true;
+        for (unsigned i = 0; i < phi->getNumIncomingValues() && provenOnAllEdges; i++) {
+            const BasicBlock *incoming = phi->getIncomingBlock(i);
+            const Value *val = phi->getIncomingValue(i);
+            provenOnAllEdges = edgeImpliesRelation(incoming, phi->getParent(), goal, val, b, incoming) ||
+                               provesRelation(goal, val, b, incoming, phiDepth - 1);
+        }
+        if (provenOnAllEdges) {
+            return true;
+        }
+    }
+
+    // sext keeps both orders, zext keeps the unsigned one and makes the signed one equal to it
+    auto *extA = dyn_cast<CastInst>(a);
+    auto *extB = dyn_cast<CastInst>(b);
+    if (extA && extB && extA->getOpcode() == extB->getOpcode() &&
+        extA->getSrcTy() == extB->getSrcTy() && (isa<SExtInst>(extA) || isa<ZExtInst>(extA))) {
+        CmpInst::Predicate inner = isa<SExtInst>(extA) ? goal : ICmpInst::getUnsignedPredicate(goal);
+        return provesRelation(inner, extA->getOperand(0), extB->getOperand(0), bb, phiDepth);
+    }
+    return false;
+}
+
+Interval SparseIntervalSolver::evaluate(Instruction *inst) const {
+    BasicBlock *bb = inst->getParent();
+
+    if (auto *phi = dyn_cast<PHINode>(inst)) {
+        Interval result = botInt;
+        for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+            BasicBlock *incoming = phi->getIncomingBlock(i);
+            Value *val = phi->getIncomingValue(i);
+            Interval range = applyEdgeFact(val, incoming, bb, getRangeAt(val, incoming));
+            result = result.joinInt(result, range);
+        }
+        return result;
+    }
+
+    if (auto *binaryInst = dyn_cast<BinaryOperator>(inst)) {
+        Interval interval1 = getRangeAt(binaryInst->getOperand(0), bb);
+        Interval interval2 = getRangeAt(binaryInst->getOperand(1), bb);
+        return evaluateBinaryOperator(binaryInst, interval1, interval2);
+    }
+
+    if (auto *castInst = dyn_cast<CastInst>(inst)) {
+        return evaluateCastInst(castInst, getRangeAt(castInst->getOperand(0), bb));
+    }
+
+    if (auto *selectInst = dyn_cast<SelectInst>(inst)) {
+        Interval trueInterval = getRangeAt(selectInst->getTrueValue(), bb);
+        Interval falseInterval = getRangeAt(selectInst->getFalseValue(), bb);
+        return trueInterval.joinInt(trueInterval, falseInterval);
+    }
+
+    if (auto *callInst = dyn_cast<CallInst>(inst)) {
+        if (callEvaluator) {
+            return callEvaluator(callInst, [this, bb](Value *v) { return getRangeAt(v, bb); });
+        }
+    }
+    return Interval::top(getIntervalBits(inst));
+}
+
+/*
+ * Worklist algorithm on the def-use graph
+ * A value is evaluated again only when one of its operands, or a value it is compared with, has changed
+ */
+void SparseIntervalSolver::solve() {
+    std::deque<unsigned> workList;
+    BitVector inWorkList(values.size(), false);
+    unsigned numArgs = 0;
+    for (unsigned i = 0; i < values.size(); i++) {
+        if (isa<Argument>(values[i])) {
+            ranges[i] = argRanges.empty() ? Interval::top(getIntervalBits(values[i])) : argRanges[numArgs++];
+        } else {
+            workList.push_back(i);
+            inWorkList.set(i);
+        }
+    }
+
+    auto pushUsers = [&](Value *v) {
+        if (isa<Constant>(v)) {
+            return;
+        }
+        for (User *user : v->users()) {
+            auto it = valueIndex.find(user);
+            if (it != valueIndex.end() && !inWorkList.test(it->second)) {
+                workList.push_back(it->second);
+                inWorkList.set(it->second);
+            }
+        }
+    };
+
+    iterNum = 0;
+    while (!workList.empty()) {
+        unsigned i = workList.front();
+        workList.pop_front();
+        inWorkList.reset(i);
+        iterNum++;
+
+        auto *inst = cast<Instruction>(values[i]);
+        Interval newRange = evaluate(inst);
+        if (isa<PHINode>(inst) && wideningBlocks.count(inst->getParent())) {
+            newRange = newRange.wideningInt(ranges[i], newRange.joinInt(ranges[i], newRange),
+                                            getIntervalBits(inst), thresholds);
+        }
+        if (newRange == ranges[i]) {
+            continue;
+        }
+        ranges[i] = newRange;
+        PASS_TRACE(IntervalLog) << *inst << ": " << newRange.toStr(getIntervalBits(inst)) << "\n";
+
+        //the refinements of the values compared with inst depend on it as well
+        for (User *user : inst->users()) {
+            if (auto *icmpInst = dyn_cast<ICmpInst>(user)) {
+                pushUsers(icmpInst->getOperand(0));
+                pushUsers(icmpInst->getOperand(1));
+            }
+        }
+        pushUsers(inst);
+    }
+    PASS_DEBUG(IntervalLog) << func.getName() << ": " << iterNum << " sparse transfers\n";
+
+    //decreasing passes in reverse post order, from the post-fixpoint reached by the widening
+    for (unsigned pass = 0; pass < narrowingPasses; pass++) {
+        bool changed = false;
+        for (unsigned i = 0; i < values.size(); i++) {
+            if (isa<Argument>(values[i])) {
+                continue;
+            }
+            Interval narrowed = ranges[i].meetInt(ranges[i], evaluate(cast<Instruction>(values[i])));
+            if (!(narrowed == ranges[i])) {
+                ranges[i] = narrowed;
+                changed = true;
+            }
+        }
+        if (!changed) {
+            break;
+        }
+    }
+}
+
+void SparseIntervalSolver::dump() const {
+    errs() << "Function " << func.getName() << ":\n";
+    for (unsigned i = 0; i < values.size(); i++) {
+        if (!values[i]->hasName()) {
+            continue;
+        }
+        errs() << "  " << values[i]->getName();
+        if (auto *inst = dyn_cast<Instruction>(values[i])) {
+            if (inst->getDebugLoc() && inst->getDebugLoc().getLine() != 0) {
+                errs() << " (line " << inst->getDebugLoc().getLine() << ")";
+            }
+        }
+        errs() << ": " << ranges[i].toStr(getIntervalBits(values[i])) << "\n";
+    }
+}
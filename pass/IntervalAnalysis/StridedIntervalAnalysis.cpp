@@ -0,0 +1,253 @@
+//========================================================================
+// FILE:
+//    StridedIntervalAnalysis.cpp
+//
+// DESCRIPTION:
+//    Strided interval analysis on SSA form
+//    The congruences only grow during the iteration (the new value is
+//    joined with the old one), and a chain of congruences is at most as
+//    long as the number of factors of the first modulus, so there is no
+//    need to widen.
+//
+// License: MIT
+//========================================================================
+
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/GetElementPtrTypeIterator.h"
+#include "llvm/IR/Operator.h"
+#include "pass/StridedIntervalAnalysis.h"
+#include "util/Log.h"
+
+using namespace IntervalNameSpace;
+
+static bool isTrackedType(const Type *type) {
+    return (type->isIntegerTy() && type->getIntegerBitWidth() <= 64) || type->isPointerTy();
+}
+
+//----------------------------------------------------------
+// Implementation of StridedIntervalSolver
+//----------------------------------------------------------
+
+StridedIntervalSolver::StridedIntervalSolver(Function &F, const SparseIntervalSolver &ranges)
+        : func(F), DL(F.getParent()->getDataLayout()), ranges(ranges) {
+    ReversePostOrderTraversal<Function *> RPOT(&F);
+    for (BasicBlock *bb : RPOT) {
+        for (Instruction &inst : *bb) {
+            if (isTrackedType(inst.getType())) {
+                insts.push_back(&inst);
+            }
+        }
+    }
+}
+
+/*
+ * Round robin in reverse post order, until no congruence changes
+ */
+void StridedIntervalSolver::solve() {
+    congruences.clear();
+    iterNum = 0;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (Instruction *inst : insts) {
+            iterNum++;
+            Congruence cong = evaluate(inst);
+            if (inst->getType()->isIntegerTy()) {
+                cong = StridedInterval(ranges.getRange(inst), cong).cong;
+            }
+
+            auto old = congruences.find(inst);
+            if (old == congruences.end()) {
+                if (!cong.isBot()) {
+                    congruences[inst] = cong;
+                    changed = true;
+                }
+                continue;
+            }
+            cong = joinCongruence(old->second, cong);
+            if (!(cong == old->second)) {
+                old->second = cong;
+                changed = true;
+            }
+        }
+    }
+    PASS_DEBUG(IntervalLog) << func.getName() << ": " << iterNum << " congruence transfers\n";
+}
+
+Congruence StridedIntervalSolver::getCongruence(const Value *v) const {
+    if (auto *c = dyn_cast<ConstantInt>(v)) {
+        return c->getBitWidth() <= 64 ? Congruence::constant(c->getSExtValue()) : Congruence::top();
+    }
+    if (isa<ConstantPointerNull>(v)) {
+        return Congruence::constant(0);
+    }
+    if (auto *inst = dyn_cast<Instruction>(v)) {
+        if (!isTrackedType(inst->getType())) {
+            return Congruence::top();
+        }
+        auto cong = congruences.find(inst);
+        return cong == congruences.end() ? Congruence::bottom() : cong->second;
+    }
+    if (auto *arg = dyn_cast<Argument>(v)) {
+        if (arg->getType()->isPointerTy()) {
+            return getBaseCongruence(arg);
+        }
+        Interval range = ranges.getRange(arg);
+        return range.lo == range.hi ? Congruence::constant(range.lo) : Congruence::top();
+    }
+    //constant expressions on globals
+    if (auto *gepOp = dyn_cast<GEPOperator>(v)) {
+        APInt offset(DL.getIndexSizeInBits(gepOp->getPointerAddressSpace()), 0);
+        if (gepOp->accumulateConstantOffset(DL, offset)) {
+            return addCongruence(getCongruence(gepOp->getPointerOperand()),
+                                 Congruence::constant(offset.getSExtValue()));
+        }
+        return Congruence::top();
+    }
+    if (auto *op = dyn_cast<Operator>(v)) {
+        if (op->getOpcode() == Instruction::BitCast || op->getOpcode() == Instruction::AddrSpaceCast) {
+            return getCongruence(op->getOperand(0));
+        }
+    }
+    return getBaseCongruence(v);
+}
+
+/*
+ * An alloca, a global or an argument with the align attribute starts at a multiple of
+ * its alignment; the address of any other object is unknown, as is the one of a global
+ * of opaque type without an explicit alignment
+ */
+Congruence StridedIntervalSolver::getBaseCongruence(const Value *ptr) const {
+    uint64_t align = 0;
+    if (auto *allocaInst = dyn_cast<AllocaInst>(ptr)) {
+        align = allocaInst->getAlignment();
+        if (align == 0) {
+            align = DL.getABITypeAlignment(allocaInst->getAllocatedType());
+        }
+    } else if (auto *global = dyn_cast<GlobalVariable>(ptr)) {
+        align = global->getAlignment();
+        if (align == 0 && global->getValueType()->isSized()) {
+            align = DL.getABITypeAlignment(global->getValueType());
+        }
+    } else if (auto *arg = dyn_cast<Argument>(ptr)) {
+        align = arg->getType()->isPointerTy() ? arg->getParamAlignment() : 0;
+    }
+    return align > 1 ? Congruence(align, 0) : Congruence::top();
+}
+
+/*
+ * address + the offset of each index: a field offset for a struct, index * element size otherwise
+ */
+Congruence StridedIntervalSolver::evaluateGEP(const GetElementPtrInst *gepInst) const {
+    Congruence addr = getCongruence(gepInst->getPointerOperand());
+    for (auto it = gep_type_begin(gepInst), end = gep_type_end(gepInst); it != end; ++it) {
+        const Value *index = it.getOperand();
+        if (StructType *structType = it.getStructTypeOrNull()) {
+            unsigned field = cast<ConstantInt>(index)->getZExtValue();
+            int64_t offset = DL.getStructLayout(structType)->getElementOffset(field);
+            addr = addCongruence(addr, Congruence::constant(offset));
+        } else {
+            int64_t size = DL.getTypeAllocSize(it.getIndexedType());
+            addr = addCongruence(addr, mulCongruence(getCongruence(index), Congruence::constant(size)));
+        }
+    }
+    return gepInst->isInBounds() ? addr : addr.truncate(DL.getPointerSizeInBits());
+}
+
+/*
+ * The arithmetic is exact, a result that may wrap around is truncated to the width of the
+ * type, which only keeps the power of two part of its modulus
+ */
+Congruence StridedIntervalSolver::evaluate(const Instruction *inst) const {
+    unsigned bits = inst->getType()->isIntegerTy() ? inst->getType()->getIntegerBitWidth() : 64;
+
+    if (auto *phi = dyn_cast<PHINode>(inst)) {
+        Congruence result = Congruence::bottom();
+        for (unsigned i = 0; i < phi->getNumIncomingValues(); i++) {
+            if (ranges.isFeasible(phi->getIncomingBlock(i))) {
+                result = joinCongruence(result, getCongruence(phi->getIncomingValue(i)));
+            }
+        }
+        return result;
+    }
+    if (auto *selectInst = dyn_cast<SelectInst>(inst)) {
+        return joinCongruence(getCongruence(selectInst->getTrueValue()), getCongruence(selectInst->getFalseValue()));
+    }
+    if (auto *gepInst = dyn_cast<GetElementPtrInst>(inst)) {
+        return evaluateGEP(gepInst);
+    }
+    if (isa<AllocaInst>(inst)) {
+        return getBaseCongruence(inst);
+    }
+
+    if (auto *binaryInst = dyn_cast<BinaryOperator>(inst)) {
+        Congruence a = getCongruence(binaryInst->getOperand(0));
+        Congruence b = getCongruence(binaryInst->getOperand(1));
+        Congruence result;
+        switch (binaryInst->getOpcode()) {
+            case Instruction::Add: result = addCongruence(a, b); break;
+            case Instruction::Sub: result = subCongruence(a, b); break;
+            case Instruction::Mul: result = mulCongruence(a, b); break;
+            case Instruction::Shl:
+                if (b.isConstant() && b.residue >= 0 && b.residue < bits) {
+                    result = mulCongruence(a, Congruence::constant(int64_t(uint64_t(1) << b.residue)));
+                } else if (a.isBot() || b.isBot()) {
+                    result = Congruence::bottom();
+                }
+                break;
+            case Instruction::And: return andCongruence(a, b);
+            case Instruction::Or: return orCongruence(a, b);
+            default:
+                return a.isBot() || b.isBot() ? Congruence::bottom() : Congruence::top();
+        }
+        return binaryInst->hasNoSignedWrap() ? result : result.truncate(bits);
+    }
+
+    if (auto *castInst = dyn_cast<CastInst>(inst)) {
+        Congruence a = getCongruence(castInst->getOperand(0));
+        switch (castInst->getOpcode()) {
+            case Instruction::SExt:
+            case Instruction::BitCast:
+            case Instruction::AddrSpaceCast:
+            case Instruction::IntToPtr:
+                return a;
+            case Instruction::ZExt:
+                //a negative value gains 2^srcBits
+                if (ranges.getRange(castInst->getOperand(0)).lo >= 0) {
+                    return a;
+                }
+                return a.truncate(castInst->getSrcTy()->getIntegerBitWidth());
+            case Instruction::Trunc:
+            case Instruction::PtrToInt:
+                return a.truncate(bits);
+            default:
+                return a.isBot() ? a : Congruence::top();
+        }
+    }
+    return Congruence::top();
+}
+
+StridedInterval StridedIntervalSolver::getStridedInterval(const Value *v) const {
+    Interval range = isa<ConstantInt>(v) ? getConstantInterval(cast<ConstantInt>(v)) : ranges.getRange(v);
+    return StridedInterval(range, getCongruence(v));
+}
+
+uint64_t StridedIntervalSolver::getAlignment(const Value *ptr) const {
+    Congruence cong = getCongruence(ptr);
+    return cong.isBot() ? 1 : cong.getAlignment();
+}
+
+void StridedIntervalSolver::dump() const {
+    errs() << "Function " << func.getName() << ":\n";
+    for (Instruction *inst : insts) {
+        if (!inst->hasName()) {
+            continue;
+        }
+        errs() << "  " << inst->getName() << ": ";
+        if (inst->getType()->isPointerTy()) {
+            errs() << "address " << getCongruence(inst).toStr() << ", align " << getAlignment(inst) << "\n";
+        } else {
+            errs() << getStridedInterval(inst).toStr(getIntervalBits(inst)) << "\n";
+        }
+    }
+}
@@ -0,0 +1,274 @@
+//========================================================================
+// FILE:
+//    ZoneDomain.cpp
+//
+// DESCRIPTION:
+//    Zone abstract domain on difference-bound matrices
+//    The closure kernels work on whole rows with a branch-free min, so
+//    the compiler can vectorize the inner loop, and the blocked closure
+//    works on tiles that stay in the L1 cache.
+//
+// License: MIT
+//========================================================================
+
+#include <algorithm>
+#include "pass/ZoneDomain.h"
+
+using namespace IntervalNameSpace;
+
+const int64_t DBM::INF;
+
+//----------------------------------------------------------
+// Implementation of DBM
+//----------------------------------------------------------
+
+DBM::DBM(unsigned numVars) : dim(numVars + 1) {
+    stride = (dim + RowAlign - 1) / RowAlign * RowAlign;
+    m.assign(dim * stride, INF);
+    for (unsigned i = 0; i < dim; i++) {
+        m[i * stride + i] = 0;
+    }
+}
+
+void DBM::setBottom() {
+    bottom = true;
+    closed = true;
+}
+
+/*
+ * m[i][j] = min(m[i][j], m[i][k] + m[k][j]) for i, j, k in the given ranges, k outermost
+ * INF is absorbing: no bound plus a negative bound is still no bound
+ * Row i == k is skipped: with m[k][k] = 0 it does not change, and skipping it means
+ * the updated row never aliases the row it reads
+ */
+static void relaxTile(int64_t *m, unsigned stride, unsigned iBegin, unsigned iEnd,
+                      unsigned jBegin, unsigned jEnd, unsigned kBegin, unsigned kEnd) {
+    for (unsigned k = kBegin; k < kEnd; k++) {
+        const int64_t *__restrict rowK = m + k * stride;
+        for (unsigned i = iBegin; i < iEnd; i++) {
+            int64_t mik = m[i * stride + k];
+            if (i == k || mik >= DBM::INF) {
+                continue;
+            }
+            int64_t *__restrict rowI = m + i * stride;
+            for (unsigned j = jBegin; j < jEnd; j++) {
+                int64_t path = rowK[j] >= DBM::INF ? DBM::INF : mik + rowK[j];
+                path = path < -DBM::INF ? -DBM::INF : path;
+                rowI[j] = path < rowI[j] ? path : rowI[j];
+            }
+        }
+    }
+}
+
+/*
+ * Blocked Floyd-Warshall: for each diagonal tile K, close K itself, then the tiles
+ * of row K and column K, which only read K, then all the other tiles, which only
+ * read row K and column K
+ */
+void DBM::close() {
+    if (closed) {
+        return;
+    }
+
+    int64_t *data = m.data();
+    if (dim <= Tile) {
+        relaxTile(data, stride, 0, dim, 0, dim, 0, dim);
+    } else {
+        for (unsigned k0 = 0; k0 < dim; k0 += Tile) {
+            unsigned k1 = std::min(k0 + Tile, dim);
+            relaxTile(data, stride, k0, k1, k0, k1, k0, k1);
+            for (unsigned t0 = 0; t0 < dim; t0 += Tile) {
+                if (t0 == k0) continue;
+                unsigned t1 = std::min(t0 + Tile, dim);
+                relaxTile(data, stride, k0, k1, t0, t1, k0, k1);
+                relaxTile(data, stride, t0, t1, k0, k1, k0, k1);
+            }
+            for (unsigned i0 = 0; i0 < dim; i0 += Tile) {
+                if (i0 == k0) continue;
+                unsigned i1 = std::min(i0 + Tile, dim);
+                for (unsigned j0 = 0; j0 < dim; j0 += Tile) {
+                    if (j0 == k0) continue;
+                    relaxTile(data, stride, i0, i1, j0, std::min(j0 + Tile, dim), k0, k1);
+                }
+            }
+        }
+    }
+
+    closed = true;
+    for (unsigned i = 0; i < dim; i++) {
+        if (m[i * stride + i] < 0) {
+            setBottom();
+            return;
+        }
+    }
+}
+
+/*
+ * Every shortest path that gets shorter goes through the new edge i -> j:
+ * m[a][b] = min(m[a][b], m[a][i] + c + m[j][b])
+ * Row j and column i do not change, as m[j][i] + c >= 0 once the matrix is consistent
+ */
+void DBM::addConstraint(unsigned i, unsigned j, int64_t c) {
+    if (bottom || c >= INF || c < -INF || c >= get(i, j)) {
+        return;
+    }
+    if (!closed) {
+        m[i * stride + j] = c;
+        return;
+    }
+    if (get(j, i) < INF && get(j, i) + c < 0) {
+        setBottom();
+        return;
+    }
+
+    const int64_t *__restrict rowJ = m.data() + j * stride;
+    for (unsigned a = 0; a < dim; a++) {
+        int64_t mai = get(a, i);
+        if (a == j || mai >= INF) {
+            continue;
+        }
+        int64_t viaEdge = mai + c;
+        int64_t *__restrict rowA = m.data() + a * stride;
+        for (unsigned b = 0; b < dim; b++) {
+            int64_t path = rowJ[b] >= INF ? INF : viaEdge + rowJ[b];
+            path = path < -INF ? -INF : path;
+            rowA[b] = path < rowA[b] ? path : rowA[b];
+        }
+    }
+
+    //the clamping at -INF can weaken the argument above, check the cycles anyway
+    for (unsigned a = 0; a < dim; a++) {
+        if (get(a, a) < 0) {
+            setBottom();
+            return;
+        }
+    }
+}
+
+void DBM::forget(unsigned v) {
+    if (bottom) {
+        return;
+    }
+    close();
+    for (unsigned i = 0; i < dim; i++) {
+        m[i * stride + v] = INF;
+        m[v * stride + i] = INF;
+    }
+    m[v * stride + v] = 0;
+}
+
+/*
+ * v - 0 <= m[0][v] and 0 - v <= m[v][0]
+ */
+Interval DBM::getInterval(unsigned v, unsigned bits) const {
+    if (bottom) {
+        return botInt;
+    }
+    Interval range = Interval::top(bits);
+    if (get(0, v) < INF) {
+        range.hi = std::min(range.hi, get(0, v));
+    }
+    if (get(v, 0) < INF) {
+        range.lo = std::max(range.lo, -get(v, 0));
+    }
+    return range.isBot() ? botInt : range;
+}
+
+void DBM::meetInterval(unsigned v, Interval range) {
+    if (range.isBot()) {
+        setBottom();
+        return;
+    }
+    //no bound beyond +-INF, which also keeps -range.lo from overflowing
+    if (range.hi < INF) {
+        addConstraint(0, v, range.hi);
+    }
+    if (range.lo > -INF) {
+        addConstraint(v, 0, -range.lo);
+    }
+}
+
+void DBM::joinWith(const DBM &other) {
+    if (other.bottom) {
+        return;
+    }
+    if (bottom) {
+        *this = other;
+        return;
+    }
+    for (unsigned k = 0; k < m.size(); k++) {
+        m[k] = std::max(m[k], other.m[k]);
+    }
+    closed = closed && other.closed;
+}
+
+void DBM::widenWith(const DBM &newer, ArrayRef<int64_t> thresholds) {
+    if (newer.bottom) {
+        return;
+    }
+    if (bottom) {
+        *this = newer;
+        return;
+    }
+    for (unsigned k = 0; k < m.size(); k++) {
+        if (newer.m[k] <= m[k]) {
+            continue;
+        }
+        auto above = std::lower_bound(thresholds.begin(), thresholds.end(), newer.m[k]);
+        m[k] = (above != thresholds.end() && *above < INF) ? *above : INF;
+    }
+    closed = false;
+}
+
+bool DBM::operator==(const DBM &rhs) const {
+    if (bottom || rhs.bottom) {
+        return bottom == rhs.bottom;
+    }
+    return m == rhs.m;
+}
+
+//----------------------------------------------------------
+// Implementation of VariablePacking
+//----------------------------------------------------------
+
+void VariablePacking::reset(unsigned numVars) {
+    parent.resize(numVars);
+    for (unsigned v = 0; v < numVars; v++) {
+        parent[v] = v;
+    }
+    packOf.clear();
+    indexInPack.clear();
+    packSize.clear();
+}
+
+unsigned VariablePacking::find(unsigned v) {
+    while (parent[v] != v) {
+        parent[v] = parent[parent[v]];
+        v = parent[v];
+    }
+    return v;
+}
+
+void VariablePacking::unite(unsigned v, unsigned w) {
+    v = find(v);
+    w = find(w);
+    if (v != w) {
+        parent[std::max(v, w)] = std::min(v, w);
+    }
+}
+
+void VariablePacking::finalize() {
+    unsigned numVars = parent.size();
+    std::vector<unsigned> rootPack(numVars, ~0u);
+    packOf.resize(numVars);
+    indexInPack.resize(numVars);
+    for (unsigned v = 0; v < numVars; v++) {
+        unsigned root = find(v);
+        if (rootPack[root] == ~0u) {
+            rootPack[root] = packSize.size();
+            packSize.push_back(0);
+        }
+        packOf[v] = rootPack[root];
+        indexInPack[v] = ++packSize[packOf[v]];
+    }
+}
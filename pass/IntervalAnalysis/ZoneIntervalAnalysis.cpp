@@ -0,0 +1,544 @@
+//========================================================================
+// FILE:
+//    ZoneIntervalAnalysis.cpp
+//
+// DESCRIPTION:
+//    Relational range analysis on SSA form with the zone domain
+//
+// License: MIT
+//========================================================================
+
+#include <algorithm>
+#include <deque>
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CFG.h"
+#include "pass/ZoneIntervalAnalysis.h"
+#include "util/Log.h"
+
+using namespace IntervalNameSpace;
+
+//----------------------------------------------------------
+// Implementation of ZoneState
+//----------------------------------------------------------
+
+void ZoneState::joinWith(const ZoneState &other) {
+    if (!other.isReachable()) {
+        return;
+    }
+    if (!isReachable()) {
+        *this = other;
+        return;
+    }
+    for (unsigned p = 0; p < packs.size(); p++) {
+        packs[p].joinWith(other.packs[p]);
+    }
+}
+
+void ZoneState::widenWith(const ZoneState &newer, ArrayRef<int64_t> thresholds) {
+    if (!newer.isReachable()) {
+        return;
+    }
+    if (!isReachable()) {
+        *this = newer;
+        return;
+    }
+    for (unsigned p = 0; p < packs.size(); p++) {
+        packs[p].widenWith(newer.packs[p], thresholds);
+    }
+}
+
+bool ZoneState::operator==(const ZoneState &rhs) const {
+    return packs == rhs.packs;
+}
+
+//----------------------------------------------------------
+// Implementation of ZoneIntervalSolver
+//----------------------------------------------------------
+
+static bool isTrackedType(const Type *type) {
+    return type->isIntegerTy() && type->getIntegerBitWidth() <= 64;
+}
+
+ZoneIntervalSolver::ZoneIntervalSolver(Function &F) : func(F) {
+    numberValues();
+    buildPacks();
+    collectWideningBlocks();
+
+    //a bound of the DBM is an upper bound of v - 0 or of 0 - v, the lower bounds are negated
+    for (int64_t c : collectWideningThresholds(F)) {
+        thresholds.push_back(c);
+        if (c != INT64_MIN) thresholds.push_back(-c);
+    }
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+}
+
+/*
+ * Number the integer arguments, the blocks in reverse post order, and their integer instructions
+ */
+void ZoneIntervalSolver::numberValues() {
+    for (Argument &arg : func.args()) {
+        if (isTrackedType(arg.getType())) {
+            valueIndex[&arg] = values.size();
+            values.push_back(&arg);
+        }
+    }
+    ReversePostOrderTraversal<Function *> RPOT(&func);
+    for (BasicBlock *bb : RPOT) {
+        blockIndex[bb] = blocks.size();
+        blocks.push_back(bb);
+        for (Instruction &inst : *bb) {
+            if (isTrackedType(inst.getType())) {
+                valueIndex[&inst] = values.size();
+                values.push_back(&inst);
+            }
+        }
+    }
+}
+
+/*
+ * Two values share a pack if a difference between them can ever be recorded:
+ * x = y + c, x = ext y, x = phi(.., y, ..) and icmp x, y
+ */
+void ZoneIntervalSolver::buildPacks() {
+    packing.reset(values.size());
+    auto unite = [this](const Value *x, const Value *y) {
+        auto itX = valueIndex.find(x), itY = valueIndex.find(y);
+        if (itX != valueIndex.end() && itY != valueIndex.end()) {
+            packing.unite(itX->second, itY->second);
+        }
+    };
+
+    for (BasicBlock *bb : blocks) {
+        for (Instruction &inst : *bb) {
+            if (auto *binaryInst = dyn_cast<BinaryOperator>(&inst)) {
+                Value *op0 = binaryInst->getOperand(0), *op1 = binaryInst->getOperand(1);
+                if (binaryInst->getOpcode() == Instruction::Add || binaryInst->getOpcode() == Instruction::Sub) {
+                    if (isa<ConstantInt>(op1)) unite(&inst, op0);
+                    if (isa<ConstantInt>(op0) && binaryInst->getOpcode() == Instruction::Add) unite(&inst, op1);
+                }
+            } else if (isa<SExtInst>(inst) || isa<ZExtInst>(inst)) {
+                unite(&inst, inst.getOperand(0));
+            } else if (auto *phi = dyn_cast<PHINode>(&inst)) {
+                for (Value *incoming : phi->incoming_values()) {
+                    unite(phi, incoming);
+                }
+            } else if (auto *icmpInst = dyn_cast<ICmpInst>(&inst)) {
+                unite(icmpInst->getOperand(0), icmpInst->getOperand(1));
+            }
+        }
+    }
+    packing.finalize();
+    PASS_DEBUG(IntervalLog) << func.getName() << ": " << values.size() << " values in "
+                            << packing.getNumPacks() << " packs\n";
+}
+
+/*
+ * The targets of the retreating edges cut every cycle, their states are widened
+ */
+void ZoneIntervalSolver::collectWideningBlocks() {
+    wideningBlocks.resize(blocks.size());
+    for (unsigned b = 0; b < blocks.size(); b++) {
+        for (BasicBlock *succ : successors(blocks[b])) {
+            if (blockIndex.lookup(succ) <= b) {
+                wideningBlocks.set(blockIndex.lookup(succ));
+            }
+        }
+    }
+}
+
+ZoneState ZoneIntervalSolver::getEntryState() const {
+    ZoneState state;
+    for (unsigned p = 0; p < packing.getNumPacks(); p++) {
+        state.packs.emplace_back(packing.getPackSize(p));
+    }
+    for (Argument &arg : func.args()) {
+        meetInterval(state, &arg, Interval::top(getIntervalBits(&arg)));
+    }
+    return state;
+}
+
+bool ZoneIntervalSolver::isSamePack(const Value *a, const Value *b) const {
+    auto itA = valueIndex.find(a), itB = valueIndex.find(b);
+    return itA != valueIndex.end() && itB != valueIndex.end() &&
+           packing.getPack(itA->second) == packing.getPack(itB->second);
+}
+
+Interval ZoneIntervalSolver::getInterval(const ZoneState &state, const Value *v) const {
+    if (auto *c = dyn_cast<ConstantInt>(v)) {
+        return getConstantInterval(c);
+    }
+    if (!state.isReachable()) {
+        return botInt;
+    }
+    auto it = valueIndex.find(v);
+    if (it == valueIndex.end()) {
+        return Interval::top(getIntervalBits(v));
+    }
+    unsigned var = it->second;
+    return state.packs[packing.getPack(var)].getInterval(packing.getIndex(var), getIntervalBits(v));
+}
+
+void ZoneIntervalSolver::meetInterval(ZoneState &state, const Value *v, Interval range) const {
+    if (!state.isReachable()) {
+        return;
+    }
+    if (range.isBot()) {
+        state.packs.clear();
+        return;
+    }
+    auto it = valueIndex.find(v);
+    if (it == valueIndex.end()) {
+        return;
+    }
+    DBM &dbm = state.packs[packing.getPack(it->second)];
+    dbm.meetInterval(packing.getIndex(it->second), range);
+    if (dbm.isBottom()) {
+        state.packs.clear();
+    }
+}
+
+void ZoneIntervalSolver::assignInterval(ZoneState &state, const Value *v, Interval range) const {
+    auto it = valueIndex.find(v);
+    if (!state.isReachable() || it == valueIndex.end()) {
+        return;
+    }
+    state.packs[packing.getPack(it->second)].forget(packing.getIndex(it->second));
+    meetInterval(state, v, range);
+}
+
+bool ZoneIntervalSolver::assignOffset(ZoneState &state, const Value *x, const Value *y, int64_t c) const {
+    if (!state.isReachable() || !isSamePack(x, y)) {
+        return false;
+    }
+    unsigned varX = valueIndex.lookup(x), varY = valueIndex.lookup(y);
+    DBM &dbm = state.packs[packing.getPack(varX)];
+    unsigned ix = packing.getIndex(varX), iy = packing.getIndex(varY);
+    dbm.forget(ix);
+    dbm.addConstraint(iy, ix, c);     // x - y <= c
+    dbm.addConstraint(ix, iy, -c);    // y - x <= -c
+    if (dbm.isBottom()) {
+        state.packs.clear();
+    }
+    return true;
+}
+
+bool ZoneIntervalSolver::addDifference(ZoneState &state, const Value *a, const Value *b, int64_t c) const {
+    if (!state.isReachable() || !isSamePack(a, b)) {
+        return false;
+    }
+    unsigned varA = valueIndex.lookup(a), varB = valueIndex.lookup(b);
+    DBM &dbm = state.packs[packing.getPack(varA)];
+    dbm.addConstraint(packing.getIndex(varB), packing.getIndex(varA), c);
+    if (dbm.isBottom()) {
+        state.packs.clear();
+    }
+    return true;
+}
+
+/*
+ * x = y + c and x = ext y are kept as differences when they cannot wrap,
+ * everything else goes through the interval transfer functions
+ */
+void ZoneIntervalSolver::transferInstruction(const Instruction *inst, ZoneState &state) const {
+    if (!state.isReachable() || !valueIndex.count(inst) || isa<PHINode>(inst)) {
+        return;
+    }
+
+    if (auto *binaryInst = dyn_cast<BinaryOperator>(inst)) {
+        Value *op0 = binaryInst->getOperand(0), *op1 = binaryInst->getOperand(1);
+        Interval a = getInterval(state, op0), b = getInterval(state, op1);
+        Interval result = evaluateBinaryOperator(binaryInst, a, b);
+
+        const Value *base = nullptr;
+        int64_t offset = 0;
+        auto *c0 = dyn_cast<ConstantInt>(op0), *c1 = dyn_cast<ConstantInt>(op1);
+        if (binaryInst->getOpcode() == Instruction::Add && c1 && !c0) {
+            base = op0;
+            offset = c1->getSExtValue();
+        } else if (binaryInst->getOpcode() == Instruction::Add && c0 && !c1) {
+            base = op1;
+            offset = c0->getSExtValue();
+        } else if (binaryInst->getOpcode() == Instruction::Sub && c1 && !c0 && !c1->isMinValue(true)) {
+            base = op0;
+            offset = -c1->getSExtValue();
+        }
+
+        bool noWrap = binaryInst->hasNoSignedWrap() ||
+                      isSignedOverflowFree(binaryInst->getOpcode(), a, b, getIntervalBits(inst));
+        if (base && noWrap && assignOffset(state, inst, base, offset)) {
+            meetInterval(state, inst, result);
+        } else {
+            assignInterval(state, inst, result);
+        }
+        return;
+    }
+
+    if (auto *castInst = dyn_cast<CastInst>(inst)) {
+        Value *src = castInst->getOperand(0);
+        Interval result = evaluateCastInst(castInst, getInterval(state, src));
+        // sext keeps the value, and so does zext of a non-negative value
+        bool sameValue = isa<SExtInst>(castInst) || (isa<ZExtInst>(castInst) && getInterval(state, src).lo >= 0);
+        if (sameValue && assignOffset(state, inst, src, 0)) {
+            meetInterval(state, inst, result);
+        } else {
+            assignInterval(state, inst, result);
+        }
+        return;
+    }
+
+    if (auto *selectInst = dyn_cast<SelectInst>(inst)) {
+        Interval trueInterval = getInterval(state, selectInst->getTrueValue());
+        Interval falseInterval = getInterval(state, selectInst->getFalseValue());
+        assignInterval(state, inst, trueInterval.joinInt(trueInterval, falseInterval));
+        return;
+    }
+
+    assignInterval(state, inst, Interval::top(getIntervalBits(inst)));
+}
+
+/*
+ * a < b is recorded as a - b <= -1 when a and b share a pack, and refines both intervals
+ * An unsigned comparison is only used when both sides are known to be non-negative
+ */
+bool ZoneIntervalSolver::refineByCondition(ICmpInst *icmpInst, bool taken, ZoneState &state) const {
+    CmpInst::Predicate pred = taken ? icmpInst->getPredicate() : icmpInst->getInversePredicate();
+    Value *a = icmpInst->getOperand(0), *b = icmpInst->getOperand(1);
+    if (!isTrackedType(a->getType())) {
+        return true;
+    }
+
+    Interval rangeA = getInterval(state, a), rangeB = getInterval(state, b);
+    if (CmpInst::isUnsigned(pred)) {
+        if (rangeA.lo < 0 || rangeB.lo < 0) {
+            return true;
+        }
+        pred = ICmpInst::getSignedPredicate(pred);
+    }
+
+    switch (pred) {
+        case CmpInst::ICMP_SLT: addDifference(state, a, b, -1); break;
+        case CmpInst::ICMP_SLE: addDifference(state, a, b, 0); break;
+        case CmpInst::ICMP_SGT: addDifference(state, b, a, -1); break;
+        case CmpInst::ICMP_SGE: addDifference(state, b, a, 0); break;
+        case CmpInst::ICMP_EQ:
+            addDifference(state, a, b, 0);
+            addDifference(state, b, a, 0);
+            break;
+        default:
+            break;
+    }
+
+    if (pred == CmpInst::ICMP_EQ) {
+        Interval both = rangeA.meetInt(rangeA, rangeB);
+        meetInterval(state, a, both);
+        meetInterval(state, b, both);
+    } else {
+        unsigned bits = getIntervalBits(a);
+        meetInterval(state, a, refineByPredicate(pred, rangeA, rangeB, bits));
+        meetInterval(state, b, refineByPredicate(CmpInst::getSwappedPredicate(pred), rangeB, rangeA, bits));
+    }
+    return state.isReachable();
+}
+
+/*
+ * The phis of the edge are a parallel assignment: a phi reading another phi of the same
+ * block reads it before any of them is assigned, so it only gets its interval
+ */
+bool ZoneIntervalSolver::transferEdge(const BasicBlock *from, const BasicBlock *to, ZoneState &state) const {
+    auto *branchInst = dyn_cast<BranchInst>(from->getTerminator());
+    if (branchInst && branchInst->isConditional() && branchInst->getSuccessor(0) != branchInst->getSuccessor(1)) {
+        if (auto *icmpInst = dyn_cast<ICmpInst>(branchInst->getCondition())) {
+            if (!refineByCondition(icmpInst, branchInst->getSuccessor(0) == to, state)) {
+                return false;
+            }
+        }
+    }
+
+    SmallVector<std::pair<const PHINode *, Interval>, 8> byInterval;
+    SmallVector<std::pair<const PHINode *, const Value *>, 8> byOffset;
+    for (const PHINode &phi : to->phis()) {
+        if (!valueIndex.count(&phi)) {
+            continue;
+        }
+        const Value *val = phi.getIncomingValueForBlock(from);
+        if (val == &phi) {
+            continue;
+        }
+        auto *valPhi = dyn_cast<PHINode>(val);
+        if (isSamePack(&phi, val) && !(valPhi && valPhi->getParent() == to)) {
+            byOffset.push_back({&phi, val});
+        } else {
+            byInterval.push_back({&phi, getInterval(state, val)});
+        }
+    }
+    for (auto &assign : byInterval) {
+        assignInterval(state, assign.first, assign.second);
+    }
+    for (auto &assign : byOffset) {
+        assignOffset(state, assign.first, assign.second, 0);
+    }
+    return state.isReachable();
+}
+
+/*
+ * Worklist algorithm on basic blocks, seeded with the entry block
+ */
+void ZoneIntervalSolver::solve() {
+    blockIn.assign(blocks.size(), ZoneState());
+    if (blocks.empty()) {
+        return;
+    }
+    blockIn[0] = getEntryState();
+
+    std::deque<unsigned> workList;
+    BitVector inWorkList(blocks.size(), false);
+    workList.push_back(0);
+    inWorkList.set(0);
+
+    iterNum = 0;
+    while (!workList.empty()) {
+        unsigned b = workList.front();
+        workList.pop_front();
+        inWorkList.reset(b);
+        iterNum++;
+
+        ZoneState state = blockIn[b];
+        if (!transferBlock(b, state)) {
+            continue;
+        }
+
+        for (BasicBlock *succ : successors(blocks[b])) {
+            ZoneState edgeState = state;
+            if (!transferEdge(blocks[b], succ, edgeState)) {
+                continue;
+            }
+            unsigned s = blockIndex.lookup(succ);
+            ZoneState newIn = blockIn[s];
+            newIn.joinWith(edgeState);
+            if (wideningBlocks.test(s) && blockIn[s].isReachable()) {
+                ZoneState widened = blockIn[s];
+                widened.widenWith(newIn, thresholds);
+                newIn = std::move(widened);
+            }
+            if (newIn == blockIn[s]) {
+                continue;
+            }
+            blockIn[s] = std::move(newIn);
+            if (!inWorkList.test(s)) {
+                workList.push_back(s);
+                inWorkList.set(s);
+            }
+        }
+    }
+    PASS_DEBUG(IntervalLog) << func.getName() << ": " << iterNum << " zone transfers\n";
+
+    narrow();
+    collectRanges();
+}
+
+/*
+ * Close the packs and run the instructions of block b, false if the end of b is unreachable
+ */
+bool ZoneIntervalSolver::transferBlock(unsigned b, ZoneState &state) const {
+    for (DBM &dbm : state.packs) {
+        dbm.close();
+        if (dbm.isBottom()) {
+            state.packs.clear();
+            break;
+        }
+    }
+    for (Instruction &inst : *blocks[b]) {
+        transferInstruction(&inst, state);
+    }
+    return state.isReachable();
+}
+
+/*
+ * Decreasing passes: every entry state is recomputed from the states of the last pass,
+ * without widening. The states reached by the widening are a post-fixpoint, so the
+ * passes stay above the least fixpoint and can stop at any time.
+ */
+void ZoneIntervalSolver::narrow() {
+    for (unsigned pass = 0; pass < narrowingPasses; pass++) {
+        std::vector<ZoneState> newIn(blocks.size());
+        newIn[0] = getEntryState();
+        for (unsigned b = 0; b < blocks.size(); b++) {
+            ZoneState state = blockIn[b];
+            if (!transferBlock(b, state)) {
+                continue;
+            }
+            for (BasicBlock *succ : successors(blocks[b])) {
+                ZoneState edgeState = state;
+                if (transferEdge(blocks[b], succ, edgeState)) {
+                    newIn[blockIndex.lookup(succ)].joinWith(edgeState);
+                }
+            }
+        }
+        if (newIn == blockIn) {
+            break;
+        }
+        blockIn = std::move(newIn);
+    }
+}
+
+/*
+ * Replay each block once from its converged entry state, the range of a value is
+ * read right after its definition
+ */
+void ZoneIntervalSolver::collectRanges() {
+    ranges.assign(values.size(), botInt);
+    for (unsigned b = 0; b < blocks.size(); b++) {
+        ZoneState state = blockIn[b];
+        for (DBM &dbm : state.packs) {
+            dbm.close();
+            if (dbm.isBottom()) {
+                state.packs.clear();
+                break;
+            }
+        }
+        if (b == 0) {
+            for (Argument &arg : func.args()) {
+                if (valueIndex.count(&arg)) {
+                    ranges[valueIndex.lookup(&arg)] = getInterval(state, &arg);
+                }
+            }
+        }
+        for (Instruction &inst : *blocks[b]) {
+            transferInstruction(&inst, state);
+            auto it = valueIndex.find(&inst);
+            if (it != valueIndex.end()) {
+                Interval range = getInterval(state, &inst);
+                ranges[it->second] = range.joinInt(ranges[it->second], range);
+            }
+        }
+    }
+}
+
+Interval ZoneIntervalSolver::getRange(const Value *v) const {
+    if (auto *c = dyn_cast<ConstantInt>(v)) {
+        return getConstantInterval(c);
+    }
+    auto it = valueIndex.find(v);
+    if (it == valueIndex.end() || ranges.empty()) {
+        return Interval::top(getIntervalBits(v));
+    }
+    return ranges[it->second];
+}
+
+void ZoneIntervalSolver::dump() const {
+    errs() << "Function " << func.getName() << ":\n";
+    for (unsigned i = 0; i < values.size(); i++) {
+        if (!values[i]->hasName()) {
+            continue;
+        }
+        errs() << "  " << values[i]->getName();
+        if (auto *inst = dyn_cast<Instruction>(values[i])) {
+            if (inst->getDebugLoc() && inst->getDebugLoc().getLine() != 0) {
+                errs() << " (line " << inst->getDebugLoc().getLine() << ")";
+            }
+        }
+        errs() << ": " << getRange(values[i]).toStr(getIntervalBits(values[i])) << "\n";
+    }
+}
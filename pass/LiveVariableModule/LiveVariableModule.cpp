@@ -0,0 +1,107 @@
+//========================================================================
+// FILE:
+//    LiveVariableModule.cpp
+//
+// DESCRIPTION:
+//    Module-level live variable analysis
+//    Every defined function gets a slot in the result table before the
+//    workers start. A worker analyzes the functions it claims with a fresh
+//    FunctionLiveness, so nothing is shared between functions.
+//
+// License: MIT
+//========================================================================
+
+#include "llvm/Support/CommandLine.h"
+#include "pass/LiveVariableModule.h"
+#include "util/Parallel.h"
+
+using namespace llvm;
+using namespace PassUtilSpace;
+
+static cl::opt<unsigned> LivenessThreads("live-var-threads", cl::init(0),
+                                         cl::desc("Number of worker threads of live-var-module (0: one per hardware thread)"));
+static cl::opt<string> ResultPath("live-var-module-output", cl::init(""),
+                                  cl::desc("File the live-var-module results are appended to (empty: none)"));
+
+char LiveVariableModule::ID = 0;
+
+//----------------------------------------------------------
+// Implementation of LiveVariableModule
+//----------------------------------------------------------
+
+/*
+ * This method tells LLVM which other passes we need to execute properly
+ */
+void LiveVariableModule::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
+    AU.setPreservesAll();
+}
+
+/*
+ * Analyze all the functions of the module concurrently
+ */
+bool LiveVariableModule::runOnModule(llvm::Module &M) {
+    results.reset(M);
+    sink.open(ResultPath);
+    parallelForEach(results.size(), LivenessThreads, [this, &M](unsigned i) {
+        results.computeSlot(i);
+        if (sink.isEnabled()) {
+            sink.getWriter().write(getLivenessRecord(M, *results.lookup(results.getFunction(i))));
+        }
+    });
+    sink.flush();
+
+    //report in module order, after all the workers have finished
+    for (unsigned i = 0; i < results.size(); i++) {
+        printLiveVariableModuleResult(*results.lookup(results.getFunction(i)));
+    }
+    return false;
+}
+
+const FunctionLiveness* LiveVariableModule::getFunctionLiveness(const Function* F) const {
+    return results.lookup(F);
+}
+
+json::Value LiveVariableModule::getLivenessRecord(const Module &M, const FunctionLiveness &liveness) const {
+    json::Array blocks;
+    for (const BasicBlock* bb : liveness.blocks) {
+        json::Array in, out;
+        for (auto &name : liveness.getVarNames(liveness.getLiveIn(bb))) in.push_back(name);
+        for (auto &name : liveness.getVarNames(liveness.getLiveOut(bb))) out.push_back(name);
+        blocks.push_back(json::Object{{"block", bb->getName().str()}, {"in", std::move(in)}, {"out", std::move(out)}});
+    }
+    return json::Object{{"pass", "live-var-module"},
+                        {"module", M.getModuleIdentifier()},
+                        {"function", liveness.func->getName().str()},
+                        {"blocks", std::move(blocks)}};
+}
+
+/*
+ * Print the live variables at the entry and the exit of each basic block
+ */
+void LiveVariableModule::printLiveVariableModuleResult(const FunctionLiveness &liveness) {
+    errs() << "================================================="
+           << "\n";
+    errs() << "LLVM-TUTOR: Live Variable results for `" << liveness.func->getName()
+           << "`\n";
+    errs() << "=================================================\n";
+
+    for (const BasicBlock* bb : liveness.blocks) {
+        errs() << bb->getName() << ": in {";
+        for (auto &name : liveness.getVarNames(liveness.getLiveIn(bb))) {
+            errs() << name << " ";
+        }
+        errs() << "} out {";
+        for (auto &name : liveness.getVarNames(liveness.getLiveOut(bb))) {
+            errs() << name << " ";
+        }
+        errs() << "}" << "\n";
+    }
+
+    errs() << "The iteration number of worklist is " << liveness.iterNum << "\n";
+    errs() << "-------------------------------------------------" << "\n\n";
+}
+
+static RegisterPass<LiveVariableModule> X("live-var-module", "LiveVariableModule Pass",
+                                          true, // This pass doesn't modify the CFG => true
+                                          true  // This pass is a pure analysis pass => true
+);
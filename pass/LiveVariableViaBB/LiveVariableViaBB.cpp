@@ -4,7 +4,6 @@
 //
 
 #include <iostream>
-#include <fstream>
 #include <set>
 #include <stack>
 #include <map>
@@ -15,13 +14,18 @@
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/Support/CommandLine.h"
 #include "pass/LiveVariableViaBB.h"
 #include "pass/VariableInBB.h"
+#include "util/Log.h"
 
 
 using namespace std;
 using namespace llvm;
 
+static cl::opt<string> ResultPath("live-var-bb-output", cl::init("testoutput.txt"),
+                                  cl::desc("File the live-var-via-bb results are appended to (empty: none)"));
+
 char LiveVariableViaBB::ID = 0;
 
 //----------------------------------------------------------
@@ -160,6 +164,11 @@ bool BasicBlockWorkList::BasicBlockWorkList::isEmpty() {
 bool LiveVariableViaBB::runOnFunction(llvm::Function &F) {
     set<string> varSet = getAnalysis<VariableInBB>().getVarSet();
 
+    //the pass instance is reused for every function, drop the state of the previous one
+    vectorBase.clear();
+    BasicBlockLivenessInfo.clear();
+    lineInfo.clear();
+
     //construct the BitVectorBase
     for (set<string>::iterator it = varSet.begin(); it != varSet.end(); ++it) {
         vectorBase.push_back(*it);
@@ -184,9 +193,9 @@ bool LiveVariableViaBB::runOnFunction(llvm::Function &F) {
     int iterNum = 0;
     while (not BBWorkList.isEmpty()) {
         iterNum++;
-        errs() << "Basic Block Num: " << iterNum << "\n";
+        PASS_DEBUG(LivenessLog) << "Basic Block Num: " << iterNum << "\n";
         BasicBlock* bb = BBWorkList.BasicBlockList.front();
-        errs() << "Basic Block Name: " << bb->getName() << "\n";
+        PASS_DEBUG(LivenessLog) << "Basic Block Name: " << bb->getName() << "\n";
         BitVectorMap connectBV = getLivenessInSingleBB(bb, BBWorkList.tailBVMap[bb]);
 
         for (auto it = pred_begin(bb), et = pred_end(bb); it != et; ++it) {
@@ -264,27 +273,21 @@ BitVectorMap LiveVariableViaBB::getLivenessInSingleBB(BasicBlock *bb, BitVectorM
 
         if (llvm::isa<llvm::StoreInst>(*inst)) {
             //Store
-            errs() << "-----------------------------" << "\n";
-            errs() << "Store instruction" << "\n";
-            errs() << (*inst) << "\n";
+            PASS_TRACE(LivenessLog) << "Store instruction: " << (*inst) << "\n";
             auto op = inst->op_begin();
-            errs() << "Gen:" << op->get()->getName() << "\n";
+            PASS_TRACE(LivenessLog) << "Gen:" << op->get()->getName() << "\n";
             GenBase.push_back(op->get()->getName());
             op++;
-            errs() << "Kill:" << op->get()->getName() << "\n";
+            PASS_TRACE(LivenessLog) << "Kill:" << op->get()->getName() << "\n";
             KillBase.push_back(op->get()->getName());
-            errs() << "-----------------------------" << "\n";
         } else if (llvm::isa<llvm::LoadInst>(*inst)) {
             //Load
-            errs() << "-----------------------------" << "\n";
-            errs() << "Load instruction" << "\n";
-            errs() << (*inst) << "\n";
+            PASS_TRACE(LivenessLog) << "Load instruction: " << (*inst) << "\n";
             auto op = inst->op_begin();
-            errs() << "Kill:" << inst->getName() << "\n";
+            PASS_TRACE(LivenessLog) << "Kill:" << inst->getName() << "\n";
             KillBase.push_back(inst->getName());
-            errs() << "Gen:" << op->get()->getName() << "\n";
+            PASS_TRACE(LivenessLog) << "Gen:" << op->get()->getName() << "\n";
             GenBase.push_back(op->get()->getName());
-            errs() << "-----------------------------" << "\n";
         } else continue;
 
         BitVectorMap headBv = info.getBasicHeadLiveInfo();
@@ -293,7 +296,7 @@ BitVectorMap LiveVariableViaBB::getLivenessInSingleBB(BasicBlock *bb, BitVectorM
         GenBase.clear();
 
         info.pushBitVector(newBv);
-        errs() << "line number: " << inst->getDebugLoc().getLine();
+        PASS_TRACE(LivenessLog) << "line number: " << inst->getDebugLoc().getLine() << "\n";
         lineInfo[inst->getDebugLoc().getLine()] = newBv;
     }
 
@@ -349,11 +352,11 @@ BitVectorMap LiveVariableViaBB::transferFunction(BitVectorMap &bv, BitVectorBase
         }
     }
 
-    errs() << "--------------------------------" << "\n";
-    for (map<string, int>::iterator it = bv.begin(); it != bv.end(); it++) {
-        errs() << it->first << ":" << it->second << "\n";
+    if (PASS_LOG_ENABLED(PASS_LOG_LEVEL_TRACE, LivenessLog)) {
+        for (map<string, int>::iterator it = bv.begin(); it != bv.end(); it++) {
+            errs() << it->first << ":" << it->second << "\n";
+        }
     }
-    errs() << "--------------------------------" << "\n";
 
     return bv;
 }
@@ -370,24 +373,39 @@ void LiveVariableViaBB::printLiveVariableInBranchResult(StringRef FuncName) {
 
     auto line_it = lineInfo.begin();
     line_it++;
-    ofstream fout("testoutput.txt");
+    json::Array lines;
     for ( ; line_it != lineInfo.end(); line_it++) {
         errs() << "line: " << line_it->first << " {";
-        fout << "line:" << line_it->first << " {";
+        json::Array live;
         for (auto bit_it = line_it->second.begin(); bit_it != line_it->second.end(); bit_it++) {
             if (bit_it->second == 1) {
                 errs() << bit_it->first << " ";
-                fout << bit_it->first << " ";
+                live.push_back(bit_it->first);
             }
         }
         errs() << "}" << "\n";
-        fout << "}" << "\n";
+        lines.push_back(json::Object{{"line", line_it->first}, {"live", std::move(live)}});
     }
+    results.write(json::Object{{"pass", "live-var-via-bb"},
+                               {"module", moduleId},
+                               {"function", FuncName},
+                               {"lines", std::move(lines)}});
 
     errs() << "------------------------------" << "\n";
     errs() << "-------------------------------------------------" << "\n\n";
 }
 
+bool LiveVariableViaBB::doInitialization(Module &M) {
+    moduleId = M.getModuleIdentifier();
+    results.open(ResultPath);
+    return false;
+}
+
+bool LiveVariableViaBB::doFinalization(Module &M) {
+    results.flush();
+    return false;
+}
+
 /*
  * This method tells LLVM which other passes we need to execute properly
  */
@@ -3,7 +3,6 @@
 //
 
 #include <iostream>
-#include <fstream>
 #include <set>
 #include <stack>
 #include <map>
@@ -14,6 +13,7 @@
 #include "llvm/Passes/PassPlugin.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
 #include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/Support/CommandLine.h"
 #include "pass/LiveVariableViaInst.h"
 #include "pass/VariableInBB.h"
 
@@ -21,6 +21,9 @@ using namespace std;
 using namespace llvm;
 using namespace PassUtilSpace;
 
+static cl::opt<string> ResultPath("live-var-inst-output", cl::init("testoutput.txt"),
+                                  cl::desc("File the live-var-via-inst results are appended to (empty: none)"));
+
 char LiveVariableViaInst::ID = 0;
 
 //----------------------------------------------------------
@@ -33,6 +36,10 @@ char LiveVariableViaInst::ID = 0;
 bool LiveVariableViaInst::runOnFunction(llvm::Function &F) {
     set<string> varSet = getAnalysis<VariableInBB>().getVarSet();
 
+    //the pass instance is reused for every function, drop the state of the previous one
+    varIndex.clear();
+    lineInfo.clear();
+
     //construct the BitVectorBase
     int index = 0;
     for (auto it = varSet.begin(); it != varSet.end(); it++) {
@@ -180,7 +187,7 @@ void LiveVariableViaInst::getLineLivenessInfo() {
 }
 
 /*
- * Print the result to the console and testoutput.txt
+ * Print the result to the console and the result file
  */
 void LiveVariableViaInst::printLiveVariableInLoopResult(StringRef FuncName) {
     errs() << "================================================="
@@ -189,28 +196,32 @@ void LiveVariableViaInst::printLiveVariableInLoopResult(StringRef FuncName) {
            << "`\n";
     errs() << "=================================================\n";
 
-    ofstream fout("testoutput.txt");
     map<int, string> bvIndex2varName;
 
     for (auto it = varIndex.begin(); it != varIndex.end(); it++) {
         bvIndex2varName[it->second] = it->first;
     }
 
+    json::Array lines;
     for (auto line_it = lineInfo.begin(); line_it != lineInfo.end(); line_it++) {
         errs() << "line " << line_it->first << ": {";
-        fout << "line " << line_it->first << ": {";
 
+        json::Array live;
         BitVector bv = line_it->second;
         for (int i = 0; i < bv.size(); i++) {
             if (bv.test(i)) {                          //i-th bit is 1
                 string valueName = bvIndex2varName[i];
                 errs() << valueName << " ";
-                fout << valueName << " ";
+                live.push_back(valueName);
             }
         }
         errs() << "}" << "\n";
-        fout << "}" << "\n";
+        lines.push_back(json::Object{{"line", line_it->first}, {"live", std::move(live)}});
     }
+    results.write(json::Object{{"pass", "live-var-via-inst"},
+                               {"module", moduleId},
+                               {"function", FuncName},
+                               {"lines", std::move(lines)}});
 
     errs() << "-------------------------------------------------" << "\n\n";
 }
@@ -254,6 +265,17 @@ void LiveVariableViaInst::printBV(BitVector& bv) {
     errs() << "\n";
 }
 
+bool LiveVariableViaInst::doInitialization(Module &M) {
+    moduleId = M.getModuleIdentifier();
+    results.open(ResultPath);
+    return false;
+}
+
+bool LiveVariableViaInst::doFinalization(Module &M) {
+    results.flush();
+    return false;
+}
+
 /*
  * This method tells LLVM which other passes we need to execute properly
  */
@@ -2,10 +2,10 @@
 // Created by Sunshine on 13/4/2020.
 //
 
-#include <fstream>
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/IR/Type.h"
@@ -15,6 +15,9 @@
 using namespace llvm;
 using namespace std;
 
+static cl::opt<string> ResultPath("parameter-counter-output", cl::init("output.txt"),
+                                  cl::desc("File the parameter-counter results are appended to (empty: none)"));
+
 char ParameterCounter::ID = 0;
 
 //----------------------------------------------------------
@@ -58,20 +61,25 @@ bool ParameterCounter::runOnModule(llvm::Module &M) {
         if (F.isDeclaration()) continue;
         parseFunctionPara(F);
     }
-    printParameterCounterResult();
+    printParameterCounterResult(M);
 
     return false;
 }
 
 /*
- * Print the result of parameter counter of module to the file
+ * Print the result of parameter counter of module to the console and the result file
  */
-void ParameterCounter::printParameterCounterResult() {
-    ofstream fout("output.txt");
+void ParameterCounter::printParameterCounterResult(llvm::Module &M) {
+    results.open(ResultPath);
     for (auto it = paraNum.begin(); it != paraNum.end(); it++) {
         errs() << it->first.str() << "\t" << it->second << "\t" << floatParaNum[it->first] << "\n";
-        fout << it->first.str() << "\t" << it->second << "\t" << floatParaNum[it->first] << "\n";
+        results.write(json::Object{{"pass", "parameter-counter"},
+                                   {"module", M.getModuleIdentifier()},
+                                   {"function", it->first},
+                                   {"params", it->second},
+                                   {"float_params", floatParaNum[it->first]}});
     }
+    results.flush();
 }
 
 static RegisterPass<ParameterCounter> X("parameter-counter", "ParameterCounter Pass",
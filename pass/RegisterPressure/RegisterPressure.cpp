@@ -0,0 +1,346 @@
+//========================================================================
+// FILE:
+//    RegisterPressure.cpp
+//
+// DESCRIPTION:
+//    Register pressure estimator built on SSA liveness.
+//    The liveness of SSA values is solved by the backward DataFlow framework,
+//    then every block is walked backward from its live-out set to find the
+//    maximum live set. Points inside loops are weighted by the loop depth
+//    from LoopInfo, and the functions and loops with the largest weighted
+//    register excess are reported as spill hot spots.
+//
+// License: MIT
+//========================================================================
+
+#include <algorithm>
+#include <cmath>
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "pass/RegisterPressure.h"
+
+using namespace std;
+using namespace llvm;
+
+// Register budgets default to the allocatable registers of x86-64
+static cl::opt<unsigned> GPRBudget("rp-gpr-regs", cl::init(14),
+                                   cl::desc("Number of allocatable integer registers"));
+static cl::opt<unsigned> FPRBudget("rp-fpr-regs", cl::init(16),
+                                   cl::desc("Number of allocatable floating-point/vector registers"));
+static cl::opt<unsigned> LoopDepthWeight("rp-loop-weight", cl::init(10),
+                                         cl::desc("Weight factor applied per level of loop nesting"));
+static cl::opt<unsigned> ReportTop("rp-report-top", cl::init(10),
+                                   cl::desc("Number of hot spots in the ranked report"));
+
+char RegisterPressure::ID = 0;
+
+static RegClass getRegClass(const Value* v) {
+    Type* ty = v->getType();
+    if (ty->isFloatingPointTy() || ty->isVectorTy()) {
+        return FPR;
+    }
+    return GPR;
+}
+
+static string getBlockLabel(const BasicBlock* bb) {
+    if (bb->hasName()) {
+        return bb->getName().str();
+    }
+    string label;
+    raw_string_ostream os(label);
+    bb->printAsOperand(os, false);
+    return os.str();
+}
+
+//----------------------------------------------------------
+// Implementation of SSALiveness
+//----------------------------------------------------------
+
+SSALiveness::~SSALiveness() {
+    for (auto it = in->begin(); it != in->end(); ++it) delete it->second;
+    for (auto it = out->begin(); it != out->end(); ++it) delete it->second;
+    for (auto it = neighbourSpecificValues->begin(); it != neighbourSpecificValues->end(); ++it) delete it->second;
+}
+
+/*
+ * Only values held in a register are tracked: arguments and value-producing
+ * instructions. Allocas are frame addresses and never occupy a register.
+ */
+bool SSALiveness::isTracked(const Value* v) const {
+    return valueIndex.count(v) > 0;
+}
+
+unsigned SSALiveness::getIndex(const Value* v) const {
+    return valueIndex.lookup(v);
+}
+
+void SSALiveness::collectValues(Function &F) {
+    for (auto &arg : F.args()) {
+        valueIndex[&arg] = indexValue.size();
+        indexValue.push_back(&arg);
+    }
+    for (auto &bb : F) {
+        for (auto &inst : bb) {
+            if (inst.getType()->isVoidTy() || isa<AllocaInst>(inst)) {
+                continue;
+            }
+            valueIndex[&inst] = indexValue.size();
+            indexValue.push_back(&inst);
+        }
+    }
+
+    for (auto &mask : classMask) {
+        mask.resize(indexValue.size());
+    }
+    for (unsigned i = 0; i < indexValue.size(); i++) {
+        classMask[getRegClass(indexValue[i])].set(i);
+    }
+
+    //A phi operand is live at the end of its incoming block, not at the entry of the phi block
+    for (auto &bb : F) {
+        for (auto &phi : bb.phis()) {
+            for (unsigned i = 0; i < phi.getNumIncomingValues(); i++) {
+                Value* incoming = phi.getIncomingValue(i);
+                if (!isTracked(incoming)) continue;
+                const BasicBlock* predBB = phi.getIncomingBlock(i);
+                if (neighbourSpecificValues->find(predBB) == neighbourSpecificValues->end()) {
+                    (*neighbourSpecificValues)[predBB] = new BitVector(indexValue.size(), false);
+                }
+                (*neighbourSpecificValues)[predBB]->set(getIndex(incoming));
+            }
+        }
+    }
+}
+
+void SSALiveness::addUses(const Instruction* inst, BitVector &live) const {
+    for (const Use &op : inst->operands()) {
+        if (isTracked(op.get())) {
+            live.set(getIndex(op.get()));
+        }
+    }
+}
+
+/*
+ * Nothing is live after the exit block
+ */
+void SSALiveness::setBoundaryCondition(BitVector *bv) {
+    bv->reset();
+}
+
+/*
+ * May analysis: a value is live if it is live on any successor
+ */
+void SSALiveness::meetOp(BitVector *lhs, const BitVector *rhs) {
+    *lhs |= *rhs;
+}
+
+BitVector *SSALiveness::initFlowValue(BasicBlock &, SetType) {
+    return new BitVector(indexValue.size(), false);
+}
+
+/*
+ * in = use ∪ (out − def), with the phi uses excluded (they belong to the predecessors)
+ */
+BitVector *SSALiveness::transferFunc(BasicBlock &b) {
+    //the framework copies the returned value, so a single scratch vector is reused
+    scratch = *(*out)[&b];
+    for (auto inst = b.rbegin(); inst != b.rend(); inst++) {
+        if (isTracked(&*inst)) {
+            scratch.reset(getIndex(&*inst));
+        }
+        if (!isa<PHINode>(*inst)) {
+            addUses(&*inst, scratch);
+        }
+    }
+    return &scratch;
+}
+
+//----------------------------------------------------------
+// Implementation of RegisterPressure
+//----------------------------------------------------------
+
+/*
+ * This method tells LLVM which other passes we need to execute properly
+ */
+void RegisterPressure::getAnalysisUsage(llvm::AnalysisUsage &AU) const {
+    AU.addRequired<LoopInfoWrapperPass>();
+    AU.setPreservesAll();
+}
+
+/*
+ * Main function of the register pressure estimator
+ */
+bool RegisterPressure::runOnFunction(llvm::Function &F) {
+    LoopInfo &LI = getAnalysis<LoopInfoWrapperPass>().getLoopInfo();
+    blockPressure.clear();
+
+    SSALiveness liveness;
+    liveness.collectValues(F);
+    liveness.runOnFunction(F);
+
+    for (auto &bb : F) {
+        blockPressure[&bb] = computeBlockPressure(bb, liveness, LI.getLoopDepth(&bb));
+    }
+
+    hotSpots.push_back(summarize(F, nullptr));
+    for (Loop* L : LI.getLoopsInPreorder()) {
+        hotSpots.push_back(summarize(F, L));
+    }
+
+    printRegisterPressureResult(F, LI);
+    return false;
+}
+
+/*
+ * Walk the block backward from its live-out set. The live set after each step is
+ * the live set of a program point; the last one also holds the phi results.
+ */
+BlockPressure RegisterPressure::computeBlockPressure(BasicBlock &BB, SSALiveness &liveness, unsigned loopDepth) {
+    BlockPressure pressure;
+    pressure.loopDepth = loopDepth;
+
+    auto recordPoint = [&](const BitVector &live) {
+        for (unsigned c = 0; c < NumRegClasses; c++) {
+            BitVector classLive = live;
+            classLive &= liveness.classMask[c];
+            pressure.maxLive[c] = max(pressure.maxLive[c], (unsigned) classLive.count());
+        }
+    };
+
+    BitVector live = *(*liveness.out)[&BB];
+    recordPoint(live);
+    for (auto inst = BB.rbegin(); inst != BB.rend(); inst++) {
+        if (isa<PHINode>(*inst)) {
+            break;
+        }
+        if (liveness.isTracked(&*inst)) {
+            live.reset(liveness.getIndex(&*inst));
+        }
+        liveness.addUses(&*inst, live);
+        recordPoint(live);
+    }
+
+    unsigned budget[NumRegClasses] = {GPRBudget, FPRBudget};
+    double excess = 0;
+    for (unsigned c = 0; c < NumRegClasses; c++) {
+        if (pressure.maxLive[c] > budget[c]) {
+            excess += pressure.maxLive[c] - budget[c];
+        }
+    }
+    pressure.spillScore = excess * getDepthWeight(loopDepth);
+    return pressure;
+}
+
+double RegisterPressure::getDepthWeight(unsigned loopDepth) {
+    return pow((double) LoopDepthWeight, (double) loopDepth);
+}
+
+/*
+ * Summarize the blocks of a loop, or of the whole function if L is null
+ */
+PressureHotSpot RegisterPressure::summarize(Function &F, Loop *L) {
+    PressureHotSpot spot;
+    spot.funcName = F.getName().str();
+
+    vector<const BasicBlock*> blocks;
+    if (L) {
+        spot.loopHeader = getBlockLabel(L->getHeader());
+        spot.loopDepth = L->getLoopDepth();
+        if (DebugLoc loc = L->getStartLoc()) {
+            spot.line = loc.getLine();
+        }
+        blocks.assign(L->block_begin(), L->block_end());
+    } else {
+        if (DISubprogram* SP = F.getSubprogram()) {
+            spot.line = SP->getLine();
+        }
+        for (auto &bb : F) {
+            blocks.push_back(&bb);
+        }
+    }
+
+    for (const BasicBlock* bb : blocks) {
+        BlockPressure &pressure = blockPressure[bb];
+        for (unsigned c = 0; c < NumRegClasses; c++) {
+            spot.maxLive[c] = max(spot.maxLive[c], pressure.maxLive[c]);
+        }
+        spot.spillScore += pressure.spillScore;
+        double weighted = (pressure.maxLive[GPR] + pressure.maxLive[FPR]) * getDepthWeight(pressure.loopDepth);
+        spot.weightedPressure = max(spot.weightedPressure, weighted);
+    }
+    return spot;
+}
+
+/*
+ * Print the pressure of each block and loop of the function
+ */
+void RegisterPressure::printRegisterPressureResult(Function &F, LoopInfo &LI) {
+    errs() << "================================================="
+           << "\n";
+    errs() << "LLVM-TUTOR: Register Pressure results for `" << F.getName()
+           << "`\n";
+    errs() << "=================================================\n";
+
+    for (auto &bb : F) {
+        BlockPressure &pressure = blockPressure[&bb];
+        errs() << getBlockLabel(&bb) << ": GPR " << pressure.maxLive[GPR]
+               << ", FPR " << pressure.maxLive[FPR]
+               << ", depth " << pressure.loopDepth << "\n";
+    }
+
+    for (Loop* L : LI.getLoopsInPreorder()) {
+        PressureHotSpot spot = summarize(F, L);
+        errs() << "Loop " << spot.loopHeader << " (depth " << spot.loopDepth << "): GPR "
+               << spot.maxLive[GPR] << ", FPR " << spot.maxLive[FPR]
+               << ", spill score " << format("%.1f", spot.spillScore) << "\n";
+    }
+    errs() << "-------------------------------------------------" << "\n\n";
+}
+
+/*
+ * Rank the functions and loops of the module by their weighted register excess
+ */
+void RegisterPressure::printHotSpotRanking() {
+    stable_sort(hotSpots.begin(), hotSpots.end(), [](const PressureHotSpot &a, const PressureHotSpot &b) {
+        if (a.spillScore != b.spillScore) {
+            return a.spillScore > b.spillScore;
+        }
+        return a.weightedPressure > b.weightedPressure;
+    });
+
+    errs() << "================================================="
+           << "\n";
+    errs() << "LLVM-TUTOR: Register Pressure hot spots (GPR budget " << GPRBudget
+           << ", FPR budget " << FPRBudget << ")\n";
+    errs() << "=================================================\n";
+
+    unsigned rank = 0;
+    for (auto &spot : hotSpots) {
+        if (rank == ReportTop) break;
+        rank++;
+        errs() << rank << ". " << spot.funcName;
+        if (!spot.loopHeader.empty()) {
+            errs() << " loop " << spot.loopHeader << " (depth " << spot.loopDepth << ")";
+        }
+        if (spot.line) {
+            errs() << " line " << spot.line;
+        }
+        errs() << ": GPR " << spot.maxLive[GPR] << ", FPR " << spot.maxLive[FPR]
+               << ", spill score " << format("%.1f", spot.spillScore) << "\n";
+    }
+    errs() << "-------------------------------------------------" << "\n\n";
+}
+
+bool RegisterPressure::doFinalization(llvm::Module &) {
+    printHotSpotRanking();
+    hotSpots.clear();
+    return false;
+}
+
+static RegisterPass<RegisterPressure> X("reg-pressure", "RegisterPressure Pass",
+                                        true, // This pass doesn't modify the CFG => true
+                                        true  // This pass is a pure analysis pass => true
+);
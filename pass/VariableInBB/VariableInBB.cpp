@@ -19,6 +19,7 @@ char VariableInBB::ID = 0;
 
 //collect the defined variable which can be accessed in each basic block
 bool VariableInBB::runOnFunction(Function &F) {
+    varSet.clear();
     for (const BasicBlock &BB : F){
         for (const Instruction &AI : BB) {
             if (llvm::isa<llvm::AllocaInst>(AI)) {
@@ -0,0 +1,222 @@
+//========================================================================
+// FILE:
+//    Liveness.cpp
+//
+// DESCRIPTION:
+//    Block-level live variable analysis with isolated per-function state
+//
+// License: MIT
+//========================================================================
+
+#include <deque>
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Instructions.h"
+#include "util/Liveness.h"
+
+using namespace PassUtilSpace;
+
+//----------------------------------------------------------
+// Implementation of FunctionLiveness
+//----------------------------------------------------------
+
+/*
+ * Number the stack slots and the basic blocks of F
+ */
+void FunctionLiveness::collectVariables(const Function &F) {
+    for (auto &bb : F) {
+        blockIndex[&bb] = blocks.size();
+        blocks.push_back(&bb);
+        for (auto &inst : bb) {
+            if (isa<AllocaInst>(inst)) {
+                varIndex[&inst] = varNames.size();
+                varNames.push_back(inst.getName().str());
+            }
+        }
+    }
+}
+
+bool FunctionLiveness::isVariable(const Value* v) const {
+    return varIndex.count(v) > 0;
+}
+
+/*
+ * Kill and Gen of a single instruction, -1 for none
+ *   Load: Gen the loaded variable
+ *   Store: Kill the stored variable, Gen the stored value if it is a variable
+ */
+void FunctionLiveness::getKillGen(const Instruction &inst, int &kill, int &gen) const {
+    kill = gen = -1;
+    if (auto* storeInst = dyn_cast<StoreInst>(&inst)) {
+        const Value* ptr = storeInst->getPointerOperand();
+        const Value* val = storeInst->getValueOperand();
+        if (isVariable(ptr)) kill = varIndex.lookup(ptr);
+        if (isVariable(val)) gen = varIndex.lookup(val);
+    } else if (auto* loadInst = dyn_cast<LoadInst>(&inst)) {
+        const Value* ptr = loadInst->getPointerOperand();
+        if (isVariable(ptr)) gen = varIndex.lookup(ptr);
+    }
+}
+
+void FunctionLiveness::transferInstruction(const Instruction &inst, BitVector &live) const {
+    int kill, gen;
+    getKillGen(inst, kill, gen);
+    if (kill >= 0) live.reset(kill);
+    if (gen >= 0) live.set(gen);
+}
+
+/*
+ * Worklist algorithm on basic blocks
+ * The Gen/Kill summary of each block is computed once, so each visit costs O(#variables / word size)
+ */
+void FunctionLiveness::compute(const Function &F) {
+    func = &F;
+    collectVariables(F);
+
+    unsigned numVars = varNames.size();
+    unsigned numBlocks = blocks.size();
+    liveIn.assign(numBlocks, BitVector(numVars, false));
+    liveOut.assign(numBlocks, BitVector(numVars, false));
+
+    //Summarize each block as in = Gen \cup (out - Kill)
+    vector<BitVector> genSet(numBlocks, BitVector(numVars, false));
+    vector<BitVector> killSet(numBlocks, BitVector(numVars, false));
+    for (unsigned b = 0; b < numBlocks; b++) {
+        for (auto inst = blocks[b]->rbegin(); inst != blocks[b]->rend(); inst++) {
+            int kill, gen;
+            getKillGen(*inst, kill, gen);
+            if (kill >= 0) {
+                genSet[b].reset(kill);
+                killSet[b].set(kill);
+            }
+            if (gen >= 0) genSet[b].set(gen);
+        }
+    }
+
+    //Backward analysis converges fastest in post order
+    deque<unsigned> workList;
+    BitVector inWorkList(numBlocks, false);
+    for (const BasicBlock* bb : post_order(&F)) {
+        workList.push_back(blockIndex[bb]);
+        inWorkList.set(blockIndex[bb]);
+    }
+    for (unsigned b = 0; b < numBlocks; b++) {
+        if (!inWorkList.test(b)) {
+            workList.push_back(b);
+            inWorkList.set(b);
+        }
+    }
+
+    BitVector newIn(numVars, false);
+    while (!workList.empty()) {
+        unsigned b = workList.front();
+        workList.pop_front();
+        inWorkList.reset(b);
+        iterNum++;
+
+        const BasicBlock* bb = blocks[b];
+        for (const BasicBlock* succ : successors(bb)) {
+            liveOut[b] |= liveIn[blockIndex[succ]];
+        }
+
+        newIn = liveOut[b];
+        newIn.reset(killSet[b]);
+        newIn |= genSet[b];
+        if (newIn == liveIn[b]) {
+            continue;
+        }
+        liveIn[b] = newIn;
+
+        for (const BasicBlock* pred : predecessors(bb)) {
+            unsigned p = blockIndex[pred];
+            if (!inWorkList.test(p)) {
+                workList.push_back(p);
+                inWorkList.set(p);
+            }
+        }
+    }
+}
+
+/*
+ * Walk each block backward once from its converged exit value
+ * The live set at the first instruction of a run of instructions on the same line is the
+ * live set at the entry of that line. Instructions without a location (line 0) are not reported.
+ */
+map<unsigned, BitVector> FunctionLiveness::getLineLiveness() const {
+    map<unsigned, BitVector> lineLive;
+    BitVector live;
+    for (unsigned b = 0; b < blocks.size(); b++) {
+        live = liveOut[b];
+        unsigned curLine = 0;
+        for (auto inst = blocks[b]->rbegin(); inst != blocks[b]->rend(); inst++) {
+            unsigned line = inst->getDebugLoc() ? inst->getDebugLoc().getLine() : 0;
+            if (line != curLine && curLine != 0) {
+                auto it = lineLive.emplace(curLine, BitVector(varNames.size(), false)).first;
+                it->second |= live;
+            }
+            curLine = line;
+            transferInstruction(*inst, live);
+        }
+        if (curLine != 0) {
+            auto it = lineLive.emplace(curLine, BitVector(varNames.size(), false)).first;
+            it->second |= live;
+        }
+    }
+    return lineLive;
+}
+
+const BitVector &FunctionLiveness::getLiveIn(const BasicBlock* bb) const {
+    return liveIn[blockIndex.lookup(bb)];
+}
+
+const BitVector &FunctionLiveness::getLiveOut(const BasicBlock* bb) const {
+    return liveOut[blockIndex.lookup(bb)];
+}
+
+vector<string> FunctionLiveness::getVarNames(const BitVector &bv) const {
+    vector<string> names;
+    for (int i = bv.find_first(); i != -1; i = bv.find_next(i)) {
+        names.push_back(varNames[i]);
+    }
+    return names;
+}
+
+//----------------------------------------------------------
+// Implementation of LivenessResultTable
+//----------------------------------------------------------
+
+void LivenessResultTable::reset(Module &M) {
+    slotIndex.clear();
+    slotFunc.clear();
+    for (auto &F : M) {
+        if (F.isDeclaration()) continue;
+        slotIndex[&F] = slotFunc.size();
+        slotFunc.push_back(&F);
+    }
+    slots.reset(new Slot[slotFunc.size()]);
+}
+
+unsigned LivenessResultTable::size() const {
+    return slotFunc.size();
+}
+
+const Function* LivenessResultTable::getFunction(unsigned i) const {
+    return slotFunc[i];
+}
+
+void LivenessResultTable::computeSlot(unsigned i) {
+    slots[i].result.compute(*slotFunc[i]);
+    slots[i].ready.store(true, memory_order_release);
+}
+
+const FunctionLiveness* LivenessResultTable::lookup(const Function* F) const {
+    auto it = slotIndex.find(F);
+    if (it == slotIndex.end()) {
+        return nullptr;
+    }
+    const Slot &slot = slots[it->second];
+    if (!slot.ready.load(memory_order_acquire)) {
+        return nullptr;
+    }
+    return &slot.result;
+}
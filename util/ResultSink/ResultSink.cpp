@@ -0,0 +1,90 @@
+//========================================================================
+// FILE:
+//    ResultSink.cpp
+//
+// DESCRIPTION:
+//    Append-only result writer of the passes
+//
+// License: MIT
+//========================================================================
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/raw_ostream.h"
+#include "util/ResultSink.h"
+
+using namespace PassUtilSpace;
+
+//----------------------------------------------------------
+// Implementation of ResultSink
+//----------------------------------------------------------
+
+void ResultSink::Writer::write(const json::Value &record) {
+    raw_string_ostream out(buffer);
+    out << record << "\n";
+}
+
+ResultSink::~ResultSink() {
+    flush();
+}
+
+void ResultSink::open(StringRef path) {
+    flush();
+    this->path = path.str();
+}
+
+bool ResultSink::isEnabled() const {
+    return !path.empty();
+}
+
+ResultSink::Writer &ResultSink::getWriter() {
+    thread::id self = this_thread::get_id();
+    lock_guard<mutex> guard(writersLock);
+    for (auto &entry : writers) {
+        if (entry.first == self) {
+            return *entry.second;
+        }
+    }
+    writers.emplace_back(self, unique_ptr<Writer>(new Writer()));
+    return *writers.back().second;
+}
+
+void ResultSink::write(const json::Value &record) {
+    if (isEnabled()) {
+        getWriter().write(record);
+    }
+}
+
+/*
+ * Merge the buffers of all the writers and append them to the file
+ * The file is opened in append mode and written unbuffered with one call, so the
+ * records of one flush are not interleaved with the records of other processes
+ */
+bool ResultSink::flush() {
+    string merged;
+    {
+        lock_guard<mutex> guard(writersLock);
+        for (auto &entry : writers) {
+            merged += entry.second->buffer;
+            entry.second->buffer.clear();
+        }
+    }
+    if (merged.empty() || !isEnabled()) {
+        return true;
+    }
+
+    error_code EC;
+    raw_fd_ostream out(path, EC, sys::fs::OF_Append);
+    if (EC) {
+        errs() << "Cannot open result file " << path << ": " << EC.message() << "\n";
+        return false;
+    }
+    out.SetUnbuffered();
+    out << merged;
+    out.close();
+    if (out.has_error()) {
+        errs() << "Cannot write result file " << path << "\n";
+        out.clear_error();
+        return false;
+    }
+    return true;
+}